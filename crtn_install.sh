@@ -26,7 +26,7 @@ BUILD_DIR=${BUILD_DIR_DEFAULT}
 BUILD_DIR_TAG=.${SW_NAME}
 
 PLIST="RPM|DEB|TGZ|STGZ"
-OPTLIST="MBX|SEM"
+OPTLIST="MBX|SEM|IO|ASM_CTX|MT"
 
 cleanup_exit()
 {
@@ -33,14 +33,22 @@
 #include <assert.h>
 #include <errno.h>
 #include <stdio.h>
-#include <ucontext.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
 #include <assert.h>
 #include <unistd.h>
+#include <signal.h>
 
 #include "crtn.h"
 #include "crtn_ccb.h"
 #include "crtn_list.h"
+#include "crtn_ctx.h"
+#include "crtn_stack.h"
+#include "crtn_timer.h"
+#ifdef HAVE_CRTN_IO
+#include "crtn_io.h"
+#endif // HAVE_CRTN_IO
 
 
 
@@ -51,42 +59,201 @@ static crtn_ccb_attr_t crtn_default_attr = {
 
   CRTN_TYPE_STANDALONE | CRTN_TYPE_STACKFUL,
 
+  0,
+
+  CRTN_PRIO_DEFAULT,
+
+  CRTN_STACK_MALLOC,
+
   0
 
 };
 
 /*
-  Runnable list
+  Run queue
+
+  The runnable lists (one per priority level): the bitmap flags the
+  levels which may not be empty. It is lazily updated: a bit is set
+  when a coroutine is queued and cleared when the scheduler finds the
+  corresponding list empty, as the coroutines leave the lists from
+  everywhere (CRTN_LIST_DEL()).
+
+  Deadline scheduling class: the runnable coroutines with a deadline
+  are also referenced in a binary min-heap ordered by deadline: they
+  are scheduled before the runnable lists. A coroutine which leaves the
+  runnable state stays in the heap until it reaches the top where it
+  is lazily removed.
+
+  In multithreaded mode, each thread has its own run queue.
+*/
+typedef struct crtn_rq
+{
+#ifdef HAVE_CRTN_MT
+  crtn_lock_t   lock;
+  unsigned int  nb;         // Number of queued coroutines
+#endif // HAVE_CRTN_MT
+  crtn_link_t   list[CRTN_PRIO_NB];
+  unsigned int  map;
+  crtn_ccb_t  **edf_heap;
+  unsigned int  edf_nb;     // Number of coroutines in the heap
+} crtn_rq_t;
+
+
+/*
+  The heaps are sized upon crtn_set_deadline() for all the coroutines
+  with a deadline so that the insertions never fail
 */
-static crtn_link_t crtn_runnable_list;
+static unsigned int crtn_edf_users;  // Number of coroutines with a deadline
+static unsigned int crtn_edf_sz;     // Number of entries in the heaps
 
 
 /*
   Table of CCB
+
+  The free entries are chained through their "next_free" field
+  (stack of free identifiers) to allocate an identifier in constant time
+
+  The table grows on demand up to "crtn_max" entries. It is made of
+  segments which never move once allocated. The first segment contains
+  CRTN_TAB_SEG0_SZ entries and segment 'n' (n > 0) contains the
+  identifiers [CRTN_TAB_SEG0_SZ << (n - 1), CRTN_TAB_SEG0_SZ << n[. Hence,
+  the size of the table doubles upon each new segment.
 */
+#define CRTN_TAB_SEG0_SHIFT 4
+#define CRTN_TAB_SEG0_SZ    (1 << CRTN_TAB_SEG0_SHIFT)
+#define CRTN_TAB_SEGS       28   // CRTN_TAB_SEG0_SZ << 27 = 2^31 identifiers
+
 static size_t crtn_max;
-static crtn_ccb_t **crtn_tab;
+static struct crtn_slot_t
+{
+  crtn_ccb_t   *ccb;
+  int           next_free;
+  unsigned int  gen;
+} *crtn_tab[CRTN_TAB_SEGS];
+
+/*
+  A coroutine identifier is made of the index of its entry in the table
+  (low 32 bits) and of the generation of the entry (high bits). The
+  generation is incremented each time the entry is freed. So, a stale
+  identifier does not designate the new coroutine using the same entry.
+*/
+#define CRTN_CID_SLOT(cid)    ((unsigned int)((cid) & 0xFFFFFFFF))
+#define CRTN_CID_GEN(cid)     ((unsigned int)((cid) >> 32))
+#define CRTN_CID(gen, slot)   ((((crtn_t)(gen)) << 32) | (crtn_t)(slot))
+#define CRTN_CID_GEN_MASK     0x7FFFFFFF   // Identifiers are positive
+
+/*
+  Number of allocated segments/entries in the table
+*/
+static int crtn_tab_segs;
+static size_t crtn_tab_sz;
 
 /*
-  Number of active CCB
+  Number of active CCB and first free identifier
 */
 static int crtn_nb;
-static int crtn_next_free_id;
+static int crtn_free_ids = -1;
 
 
 
+#ifndef HAVE_CRTN_MT
 /*
   Running CCB
 */
 crtn_ccb_t *crtn_current;
+#endif // HAVE_CRTN_MT
 
 
 static crtn_ccb_t crtn_ccb_main;
 
 
-#define CRTN_EXIST(id) (((id) >= 0)       &&         \
-                        ((size_t)(id) < crtn_max) && \
-                        crtn_tab[(id)])
+#ifdef HAVE_CRTN_MT
+/*
+  Multithreaded mode
+
+  "crtn_workers" threads (the main thread included) run the coroutines.
+  The additional threads are started upon the first call to
+  crtn_spawn().
+
+  A coroutine is queued into the run queue of the last thread which
+  ran it. When its run queue is empty, a thread steals the first
+  coroutine of the other run queues. Otherwise, it switches to its idle
+  context as the suspended coroutine may be resumed by another thread
+  in the meantime. The idle threads sleep on a condition variable
+  until coroutines become runnable or the earliest timer expires.
+
+  No lock is held across the context switches: a thread resuming a
+  coroutine waits until the thread which suspended it left its
+  context ("on_cpu" field cleared by crtn_switch_finish()).
+*/
+static crtn_rq_t *crtn_rqs;
+static size_t crtn_workers;
+static size_t crtn_workers_nb = 1;
+
+static crtn_lock_t crtn_idle_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t crtn_idle_cond;
+static unsigned int crtn_idle_nb;
+
+/*
+  Lock of the table of coroutines: the lookups share it and the
+  allocation/release of the identifiers are exclusive. A CCB found
+  in the table can't be freed until the lock is released.
+*/
+static pthread_rwlock_t crtn_tab_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+#define CRTN_TAB_RDLOCK() pthread_rwlock_rdlock(&crtn_tab_lock)
+#define CRTN_TAB_WRLOCK() pthread_rwlock_wrlock(&crtn_tab_lock)
+#define CRTN_TAB_UNLOCK() pthread_rwlock_unlock(&crtn_tab_lock)
+
+/*
+  Lock of the accounting of the deadline scheduling class
+*/
+static crtn_lock_t crtn_edf_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+  Stack of the idle context of the main thread (the other threads
+  run their idle context on their own stack)
+*/
+static char *crtn_idle_stack;
+#define CRTN_IDLE_STACK_SIZE (32 * 1024)
+
+#define CRTN_RQ_SELF() (*crtn_rq_ptr())
+
+// Wake up an idle thread (if any) as a coroutine became runnable
+#define CRTN_MT_WAKEUP()                                          \
+  do {                                                            \
+    if (__atomic_load_n(&crtn_idle_nb, __ATOMIC_SEQ_CST)) {       \
+      crtn_mt_wakeup();                                           \
+    }                                                             \
+  } while(0)
+
+static void crtn_mt_wakeup(void);
+
+static void crtn_switch_finish(void);
+#define CRTN_SWITCH_FINISH() crtn_switch_finish()
+
+static void crtn_cancel_apply(crtn_ccb_t *ccb);
+
+static int crtn_mt_start(void);
+
+#else
+
+static crtn_rq_t crtn_rqs[1];
+
+#define CRTN_TAB_RDLOCK()    do {} while(0)
+#define CRTN_TAB_WRLOCK()    do {} while(0)
+#define CRTN_TAB_UNLOCK()    do {} while(0)
+#define CRTN_RQ_SELF()       crtn_rqs
+#define CRTN_MT_WAKEUP()     do {} while(0)
+#define CRTN_SWITCH_FINISH() do {} while(0)
+
+#endif // HAVE_CRTN_MT
+
+
+#define CRTN_EXIST(id) (((id) >= 0)                                      && \
+                        (CRTN_CID_SLOT(id) < crtn_tab_sz)                 && \
+                        (crtn_slot(CRTN_CID_SLOT(id))->gen == CRTN_CID_GEN(id)) && \
+                        crtn_slot(CRTN_CID_SLOT(id))->ccb)
 
 
 /*
@@ -100,9 +267,42 @@ static size_t crtn_stack_size;
 static char *crtn_stackless;
 
 /*
-  Size of the termination stack for the stackless coroutines
+  Size of the termination stack for the stackless coroutines. It also
+  holds the CCB and the termination runs down to the scheduler (the
+  symbols of the C library may be resolved on it).
+*/
+#define CRTN_CANCEL_STACK_SIZE (16 * 1024)
+
+/*
+  Stack shared by the copy-stack coroutines and the coroutine whose
+  stack frames are currently on it
+*/
+static char *crtn_copystack;
+static crtn_ccb_t *crtn_copystack_owner;
+
+/*
+  The stack of the owner can't be saved/overwritten while running on it.
+  The switches from the owner to another copy-stack coroutine go through
+  a helper context running on its own stack
+*/
+static char *crtn_copystack_helper_stack;
+static crtn_ctx_t crtn_copystack_helper_ctx;
+static crtn_ccb_t *crtn_copystack_next;
+#define CRTN_COPYSTACK_HELPER_SIZE (16 * 1024)
+
+
+#ifdef HAVE_CRTN_ASM_CTX
+/*
+  Signal mask shared by the coroutines which do not save/restore
+  their own signal mask (it is the signal mask of the thread running
+  them in multithreaded mode)
 */
-#define CRTN_CANCEL_STACK_SIZE (4 * 1024)
+#ifdef HAVE_CRTN_MT
+static __thread sigset_t crtn_sigmask;
+#else
+static sigset_t crtn_sigmask;
+#endif // HAVE_CRTN_MT
+#endif // HAVE_CRTN_ASM_CTX
 
 
 int crtn_errno(void)
@@ -111,286 +311,1077 @@ int crtn_errno(void)
 }
 
 
-static crtn_t crtn_get_id(crtn_ccb_t *ccb)
+static struct crtn_slot_t *crtn_slot(unsigned int slot)
 {
-  int i;
-  int count = crtn_max;
+  unsigned long q = (unsigned long)slot >> CRTN_TAB_SEG0_SHIFT;
+  int           seg;
 
-  for (i = crtn_next_free_id; count; count --, i = (i + 1) % crtn_max) {
-    if (!(crtn_tab[i])) {
-      // Mark the context busy
-      crtn_tab[i] = ccb;
-      crtn_next_free_id = (i + 1) % crtn_max;
-      crtn_nb ++;
-      return i;
-    }
+  if (!q) {
+    return &(crtn_tab[0][slot]);
+  }
+
+  // Segment = Index of the most significant bit of q + 1
+  seg = (int)(sizeof(unsigned long) * 8) - __builtin_clzl(q);
+
+  return &(crtn_tab[seg][(unsigned long)slot - ((unsigned long)CRTN_TAB_SEG0_SZ << (seg - 1))]);
+
+} // crtn_slot
+
+
+/*
+  Add a segment to the table of coroutines
+  Return 0 or an errno value
+*/
+static int crtn_tab_grow(void)
+{
+  int                 seg = crtn_tab_segs;
+  size_t              first, nb, i;
+  struct crtn_slot_t *slots;
+
+  first = (seg ? ((size_t)CRTN_TAB_SEG0_SZ << (seg - 1)) : 0);
+
+  // Upper limit
+  if ((seg >= CRTN_TAB_SEGS) || (first >= crtn_max)) {
+    return EAGAIN;
+  }
+
+  // Only the entries below the upper limit are allocated
+  nb = (seg ? first : CRTN_TAB_SEG0_SZ);
+  if (nb > (crtn_max - first)) {
+    nb = crtn_max - first;
+  }
+
+  slots = (struct crtn_slot_t *)malloc(nb * sizeof(struct crtn_slot_t));
+  if (!slots) {
+    return errno;
+  }
+
+  // Chain the free identifiers in ascending order
+  // (the new segment is allocated when there are no more free identifiers)
+  assert(crtn_free_ids < 0);
+  for (i = 0; i < nb; i ++) {
+    slots[i].ccb = (crtn_ccb_t *)0;
+    slots[i].gen = 0;
+    slots[i].next_free = ((i + 1) < nb ? (int)(first + i + 1) : -1);
   }
+  crtn_free_ids = (int)first;
+
+  crtn_tab[seg] = slots;
+  crtn_tab_segs ++;
+  crtn_tab_sz = first + nb;
+
+  return 0;
+
+} // crtn_tab_grow
+
+
+static crtn_t crtn_get_id(crtn_ccb_t *ccb)
+{
+  int                 i;
+  struct crtn_slot_t *slot;
 
   // Impossible as controls are done before calling this function
   // to make sure that there is space
-  assert(0);
-  crtn_set_errno(EAGAIN);
-  return -1;
+  assert(crtn_free_ids >= 0);
+
+  // Pop the first free identifier
+  i = crtn_free_ids;
+  slot = crtn_slot((unsigned int)i);
+  crtn_free_ids = slot->next_free;
+
+  // Mark the context busy
+  slot->ccb = ccb;
+  crtn_nb ++;
+
+  return CRTN_CID(slot->gen, i);
 
 } // crtn_get_id
 
 
 static void crtn_free_id(crtn_t cid)
 {
-
-  crtn_tab[cid] = (crtn_ccb_t *)0;
-  crtn_next_free_id = cid;
+  struct crtn_slot_t *slot = crtn_slot(CRTN_CID_SLOT(cid));
+
+  // Push the identifier on top of the free ones
+  // with a new generation
+  slot->ccb = (crtn_ccb_t *)0;
+  slot->gen = (slot->gen + 1) & CRTN_CID_GEN_MASK;
+  slot->next_free = crtn_free_ids;
+  crtn_free_ids = (int)CRTN_CID_SLOT(cid);
   crtn_nb --;
 
 } // crtn_free_id
 
 
-static void crtn_free(crtn_ccb_t *ccb)
+/*
+  Free the memory of a coroutine (stack, CCB...)
+*/
+static void crtn_free_stack(crtn_ccb_t *ccb)
 {
-  crtn_free_id(ccb->cid);
+  if (ccb->attr.type & CRTN_TYPE_COPYSTACK) {
+
+    if (ccb == crtn_copystack_owner) {
+      crtn_copystack_owner = (crtn_ccb_t *)0;
+    }
 
-  if (!(ccb->attr.type & CRTN_TYPE_STACKLESS)) {
+    free(ccb->copy);
+  }
+
+  if (!(ccb->attr.type & (CRTN_TYPE_STACKLESS | CRTN_TYPE_COPYSTACK))) {
 
     if (!(ccb->flags & CRTN_CCB_FLAG_STATIC)) {
 
       // The CCB is in the stack
-      free(ccb->stack);
+      crtn_stack_free(ccb->stack, ccb->alloc_size, ccb->attr.stack_mode);
     }
 
   } else {
 
     // The CCB is in the cancel stack area
-    free(ccb->cancel_stack);
+    crtn_stack_free(ccb->cancel_stack, ccb->alloc_size, CRTN_STACK_MALLOC);
 
   }
-} // crtn_free
+} // crtn_free_stack
 
 
-crtn_t crtn_self(void)
+static void crtn_free(crtn_ccb_t *ccb)
 {
-  return crtn_current->cid;
-} // crtn_self
+#ifdef HAVE_CRTN_MT
+  // The thread which ran the coroutine may not have left its stack yet
+  while (__atomic_load_n(&(ccb->on_cpu), __ATOMIC_ACQUIRE)) {
+    sched_yield();
+  }
+#endif // HAVE_CRTN_MT
 
+  CRTN_TAB_WRLOCK();
+  crtn_free_id(ccb->cid);
+  CRTN_TAB_UNLOCK();
 
-void crtn_make_runnable(crtn_link_t *link)
-{
-  CRTN_LINK2CCB(link)->state = CRTN_STATE_RUNNABLE;
-  CRTN_LIST_ADD_TAIL(&crtn_runnable_list, link);
-}
+  crtn_free_stack(ccb);
+} // crtn_free
 
 
-void crtn_make_waiting(
-                    crtn_link_t *list,
-                    crtn_link_t *link
-                   )
+/*
+  Coroutine designated by an identifier. In multithreaded mode, the
+  table is read locked upon success (cf. CRTN_TAB_UNLOCK())
+*/
+static crtn_ccb_t *crtn_tab_lookup(crtn_t cid)
 {
-  CRTN_LIST_DEL(link);
-  CRTN_LINK2CCB(link)->state = CRTN_STATE_WAITING;
-  if (list) {
-    CRTN_LIST_ADD_FRONT(list, link);
+  CRTN_TAB_RDLOCK();
+
+  if (!CRTN_EXIST(cid)) {
+    CRTN_TAB_UNLOCK();
+    crtn_set_errno(ENOENT);
+    return (crtn_ccb_t *)0;
   }
-}
 
+  return crtn_slot(CRTN_CID_SLOT(cid))->ccb;
+} // crtn_tab_lookup
 
-int crtn_yield(void *data)
-{
-  int rc;
-  crtn_link_t *plink;
-  crtn_ccb_t *next_ccb;
-  crtn_ccb_t *old_ccb;
 
-  switch(crtn_current->state) {
+static void crtn_entry(void);
+static void crtn_cancelled(void);
 
-    case CRTN_STATE_RUNNING: {
 
-      // The current coroutine will stay runnable only if it is not a stepper
-      if (crtn_current->attr.type & CRTN_TYPE_STEPPER) {
+/*
+  Make the shared stack hold the stack frames of a copy-stack coroutine
+*/
+static void crtn_copystack_load(crtn_ccb_t *next_ccb)
+{
+  crtn_ccb_t *owner = crtn_copystack_owner;
+  char       *top = crtn_copystack + crtn_stack_size;
+  char       *sp;
+  char       *p;
+  size_t      len;
+
+  // Save the used part of the stack of the current owner (if it is not finished)
+  if (owner && (owner->state != CRTN_STATE_ZOMBIE)) {
+
+    sp = crtn_ctx_sp(&(owner->ctx));
+    if ((sp < crtn_copystack) || (sp >= top)) {
+      // Unknown stack pointer ==> The whole stack is saved
+      sp = crtn_copystack;
+    }
+    len = (size_t)(top - sp);
+
+    // The buffer is adjusted to the used size
+    if ((len > owner->copy_size) || (len < (owner->copy_size / 4))) {
+      p = (char *)realloc(owner->copy, len);
+      if (!p) {
+        fprintf(stderr, "crtn: Unable to save the stack of coroutine '%s' (%zu bytes)\n", owner->name, len);
+        abort();
+      }
+      owner->copy = p;
+      owner->copy_size = len;
+    }
 
-        // If some coroutine is waiting on the current coroutine
-        if (crtn_current->waiting) {
+    memcpy(owner->copy, sp, len);
+    owner->copy_len = len;
+  }
 
-          // Pass the data
-          crtn_current->yielded_data = data;
+  if (next_ccb->flags & CRTN_CCB_FLAG_NEWCTX) {
 
-          // Put the waiting coroutine in the runnable list
-          crtn_make_runnable(&(crtn_current->waiting->link));
-        }
+    // Brand new (or cancelled) coroutine
+    next_ccb->flags &= ~CRTN_CCB_FLAG_NEWCTX;
+    crtn_ctx_make(&(next_ccb->ctx), crtn_copystack, crtn_stack_size,
+                  (next_ccb->flags & CRTN_CCB_FLAG_CANCELLED ? crtn_cancelled : crtn_entry));
 
-        // Put current coroutine in the READY state
-        CRTN_LIST_DEL(&(crtn_current->link));
-        crtn_current->state = CRTN_STATE_READY;
+  } else {
 
-        // Get the link of the schedulable coroutine
-        plink = CRTN_LIST_FRONT(&crtn_runnable_list);
+    // Restore the stack frames of the coroutine
+    memcpy(top - next_ccb->copy_len, next_ccb->copy, next_ccb->copy_len);
+  }
 
-        // If there no schedulable coroutines, this is a dead end!
-        assert(plink);
+  crtn_copystack_owner = next_ccb;
 
-        // Context switch
-        next_ccb = CRTN_LINK2CCB(plink);
-        assert(next_ccb->state == CRTN_STATE_RUNNABLE);
-        old_ccb = crtn_current;
-        crtn_current = next_ccb;
-        crtn_current->state = CRTN_STATE_RUNNING;
-        swapcontext(&(old_ccb->ctx), &(next_ccb->ctx));
+} // crtn_copystack_load
 
-        rc = CRTN_SCHED_OTHER;
 
-      } else {
+static void crtn_copystack_helper(void)
+{
+  crtn_ccb_t *next_ccb;
 
-        // The coroutine is STANDALONE, it decided to give the processor
+  for (;;) {
 
-        // The current coroutine stays RUNNABLE
+    // The previous owner is suspended ==> Its stack can be saved
+    next_ccb = crtn_copystack_next;
+    crtn_copystack_load(next_ccb);
 
-        // Put the current CCB at the end of the runnable list if it is not
-        // already the last. Brand new coroutines from calls to crtn_spawn()
-        // may be located before the running coroutine in the runnable list.
-        if (crtn_runnable_list.prev != &(crtn_current->link))  {
-          CRTN_LIST_DEL(&(crtn_current->link));
-          CRTN_LIST_ADD_TAIL(&crtn_runnable_list, &(crtn_current->link));
-        }
+    crtn_ctx_swap(&crtn_copystack_helper_ctx, &(next_ccb->ctx));
+  }
 
-        // Get the link of the schedulable coroutine (1st of the list)
-        plink = CRTN_LIST_FRONT(&crtn_runnable_list);
+} // crtn_copystack_helper
 
-        // The list can't be empty (otherwise it is an internal bug!)
-        assert(plink);
 
-        // Context switch if it is not the current one
-        if (plink != &(crtn_current->link)) {
-          crtn_current->state = CRTN_STATE_RUNNABLE;
-          next_ccb = CRTN_LINK2CCB(plink);
-          assert(next_ccb->state == CRTN_STATE_RUNNABLE);
-          old_ccb = crtn_current;
-          crtn_current = next_ccb;
-          crtn_current->state = CRTN_STATE_RUNNING;
-          swapcontext(&(old_ccb->ctx), &(next_ccb->ctx));
+crtn_t crtn_self(void)
+{
+  return crtn_current->cid;
+} // crtn_self
 
-          rc = CRTN_SCHED_OTHER;
-        } else {
-          rc = CRTN_SCHED_SELF;
-        }
+
+static void crtn_switch(
+                        crtn_ccb_t *old_ccb,
+                        crtn_ccb_t *next_ccb
+                       )
+{
+#ifdef HAVE_CRTN_ASM_CTX
+  sigset_t *old_mask;
+  sigset_t *next_mask;
+#endif // HAVE_CRTN_ASM_CTX
+
+#ifdef HAVE_CRTN_MT
+  *crtn_prev_ptr() = old_ccb;
+
+  // The thread which suspended the coroutine may not have left its
+  // context yet (cf. crtn_switch_finish()). As this thread may be
+  // waiting for the current coroutine as well, the latter leaves the
+  // processor: the idle context waits and resumes the coroutine.
+  if (__atomic_load_n(&(next_ccb->on_cpu), __ATOMIC_ACQUIRE)) {
+    if (old_ccb != *crtn_idle_ptr()) {
+      *crtn_resume_ptr() = next_ccb;
+      next_ccb = crtn_current = *crtn_idle_ptr();
+    } else {
+      while (__atomic_load_n(&(next_ccb->on_cpu), __ATOMIC_ACQUIRE)) {
+        sched_yield();
       }
     }
-    break;
+  }
+  next_ccb->on_cpu = 1;
+
+  // The cancellation requested by crtn_cancel() is applied when the
+  // coroutine is resumed (unless it resumes to complete a join or a
+  // wait: it is applied when it gives back the processor)
+  if ((__atomic_load_n(&(next_ccb->flags), __ATOMIC_SEQ_CST) & CRTN_CCB_FLAG_CANCEL_PENDING) &&
+      !(next_ccb->joining_on || next_ccb->waiting_on)) {
+    crtn_cancel_apply(next_ccb);
+  }
+#endif // HAVE_CRTN_MT
+
+#ifdef HAVE_CRTN_ASM_CTX
+  // The context switch does not save/restore the signal mask.
+  // Only the coroutines which asked for it pay the system call.
+  if (old_ccb->attr.sigmask || next_ccb->attr.sigmask) {
+    old_mask = (old_ccb->attr.sigmask ? &(old_ccb->sigmask) : &crtn_sigmask);
+    next_mask = (next_ccb->attr.sigmask ? &(next_ccb->sigmask) : &crtn_sigmask);
+    sigprocmask(SIG_SETMASK, next_mask, old_mask);
+  }
+#endif // HAVE_CRTN_ASM_CTX
 
-    case CRTN_STATE_ZOMBIE: {
+  if ((next_ccb->attr.type & CRTN_TYPE_COPYSTACK) &&
+      (next_ccb != crtn_copystack_owner)) {
 
-      // The current coroutine reached the end of its entry point
-      // or it called crtn_exit()
+    if (old_ccb == crtn_copystack_owner) {
+      crtn_copystack_next = next_ccb;
+      crtn_ctx_swap(&(old_ccb->ctx), &crtn_copystack_helper_ctx);
+      CRTN_SWITCH_FINISH();
+      return;
+    }
 
-      // If a coroutine is joining or waiting
-      if (crtn_current->joining) {
+    crtn_copystack_load(next_ccb);
+  }
 
-        // Put the joining coroutine in the ready list
-        crtn_make_runnable(&(crtn_current->joining->link));
+  crtn_ctx_swap(&(old_ccb->ctx), &(next_ccb->ctx));
 
-      } else if (crtn_current->waiting) {
+  // Resumed (possibly by another thread)
+  CRTN_SWITCH_FINISH();
 
-        // If a coroutine is waiting
-        assert(crtn_current->attr.type & CRTN_TYPE_STEPPER);
+} // crtn_switch
 
-        // No data
-        crtn_current->yielded_data = 0;
 
-        // Put the joining coroutine in the ready list
-        crtn_make_runnable(&(crtn_current->waiting->link));
+static void crtn_edf_set(crtn_rq_t *rq, unsigned int i, crtn_ccb_t *ccb)
+{
+  rq->edf_heap[i] = ccb;
+  ccb->edf_idx = (int)i;
+} // crtn_edf_set
 
-      }
 
-      // Get the link of the schedulable coroutine
-      plink = CRTN_LIST_FRONT(&crtn_runnable_list);
+static void crtn_edf_up(crtn_rq_t *rq, unsigned int i)
+{
+  crtn_ccb_t   *ccb = rq->edf_heap[i];
+  unsigned int  parent;
 
-      // If there are no schedulable coroutines, this is a dead end!
-      assert(plink);
+  while (i > 0) {
+    parent = (i - 1) / 2;
+    if (rq->edf_heap[parent]->edf_deadline <= ccb->edf_deadline) {
+      break;
+    }
+    crtn_edf_set(rq, i, rq->edf_heap[parent]);
+    i = parent;
+  }
 
-      // Context switch
-      next_ccb = CRTN_LINK2CCB(plink);
-      old_ccb = crtn_current;
-      crtn_current = next_ccb;
-      crtn_current->state = CRTN_STATE_RUNNING;
-      swapcontext(&(old_ccb->ctx), &(next_ccb->ctx));
+  crtn_edf_set(rq, i, ccb);
+} // crtn_edf_up
 
-      rc = CRTN_SCHED_OTHER;
-    }
-    break;
 
-    case CRTN_STATE_WAITING: {
+static void crtn_edf_down(crtn_rq_t *rq, unsigned int i)
+{
+  crtn_ccb_t   *ccb = rq->edf_heap[i];
+  unsigned int  child;
 
-      // The current coroutine called either crtn_wait() or crtn_join()
+  while ((child = (2 * i) + 1) < rq->edf_nb) {
+    if ((child + 1 < rq->edf_nb) &&
+        (rq->edf_heap[child + 1]->edf_deadline < rq->edf_heap[child]->edf_deadline)) {
+      child ++;
+    }
+    if (ccb->edf_deadline <= rq->edf_heap[child]->edf_deadline) {
+      break;
+    }
+    crtn_edf_set(rq, i, rq->edf_heap[child]);
+    i = child;
+  }
 
-      // Get the link of the schedulable coroutine
-      plink = CRTN_LIST_FRONT(&crtn_runnable_list);
+  crtn_edf_set(rq, i, ccb);
+} // crtn_edf_down
 
-      // If there no schedulable coroutines, this is a dead end!
-      assert(plink);
 
-      // Context switch
-      next_ccb = CRTN_LINK2CCB(plink);
-      old_ccb = crtn_current;
-      crtn_current = next_ccb;
-      crtn_current->state = CRTN_STATE_RUNNING;
-      swapcontext(&(old_ccb->ctx), &(next_ccb->ctx));
+static void crtn_edf_add(crtn_rq_t *rq, crtn_ccb_t *ccb)
+{
+  assert(rq->edf_nb < crtn_edf_sz);
 
-      rc = CRTN_SCHED_OTHER;
-    }
-    break;
+  rq->edf_heap[rq->edf_nb] = ccb;
+  rq->edf_nb ++;
+  crtn_edf_up(rq, rq->edf_nb - 1);
+} // crtn_edf_add
 
-    default: {
 
-      assert(0);
+static void crtn_edf_del(crtn_rq_t *rq, crtn_ccb_t *ccb)
+{
+  unsigned int  i = (unsigned int)(ccb->edf_idx);
+  crtn_ccb_t   *last;
 
-      crtn_set_errno(ENOSYS);
-      rc = -1;
+  assert(rq->edf_heap[i] == ccb);
 
-    }
-    break;
+  rq->edf_nb --;
+  ccb->edf_idx = -1;
 
-  } // End switch
+  // Move the last entry in the hole
+  if (i != rq->edf_nb) {
+    last = rq->edf_heap[rq->edf_nb];
+    crtn_edf_set(rq, i, last);
+    crtn_edf_up(rq, i);
+    crtn_edf_down(rq, (unsigned int)(last->edf_idx));
+  }
+} // crtn_edf_del
 
-  return rc;
 
-} // crtn_yield
+/*
+  Lock the run queue of a coroutine: it may change until it is locked
+  (cf. crtn_rq_steal())
+*/
+static crtn_rq_t *crtn_rq_lock(crtn_ccb_t *ccb)
+{
+#ifdef HAVE_CRTN_MT
+  crtn_rq_t *rq;
+
+  for (;;) {
+    rq = __atomic_load_n(&(ccb->rq), __ATOMIC_ACQUIRE);
+    CRTN_LOCK(&(rq->lock));
+    if (rq == ccb->rq) {
+      return rq;
+    }
+    CRTN_UNLOCK(&(rq->lock));
+  }
+#else
+  (void)ccb;
 
+  return crtn_rqs;
+#endif // HAVE_CRTN_MT
+} // crtn_rq_lock
 
-static void crtn_end(int status)
+
+/*
+  Queue a coroutine at the end (or at the head) of the runnable list
+  of its priority into its run queue (locked by the caller). The
+  running coroutines are not linked in the runnable lists.
+*/
+static void crtn_runnable_add(
+                              crtn_rq_t  *rq,
+                              crtn_ccb_t *ccb,
+                              int         front
+                             )
 {
-  crtn_ccb_t *ccb = crtn_current;
+  if (front) {
+    CRTN_LIST_ADD_FRONT(&(rq->list[ccb->attr.prio]), &(ccb->link));
+  } else {
+    CRTN_LIST_ADD_TAIL(&(rq->list[ccb->attr.prio]), &(ccb->link));
+  }
+  rq->map |= (1U << ccb->attr.prio);
 
-  ccb->status = status;
+  // The coroutine may still be in the heap if it was not runnable
+  // for a short time
+  if ((ccb->edf_deadline >= 0) && (ccb->edf_idx < 0)) {
+    crtn_edf_add(rq, ccb);
+  }
 
-  // Change the state
-  ccb->state = CRTN_STATE_ZOMBIE;
+#ifdef HAVE_CRTN_MT
+  // Seen by the idle threads (cf. crtn_worker_loop())
+  (void)__atomic_add_fetch(&(rq->nb), 1, __ATOMIC_SEQ_CST);
+#endif // HAVE_CRTN_MT
+} // crtn_runnable_add
 
-  // Get out from the runnable list
+
+/*
+  Remove a coroutine elected to run from the runnable lists of its
+  run queue (locked by the caller)
+*/
+static void crtn_runnable_del(
+                              crtn_rq_t  *rq,
+                              crtn_ccb_t *ccb
+                             )
+{
   CRTN_LIST_DEL(&(ccb->link));
 
-  // Give back the processor
-  crtn_yield(0);
+  // The heap index is out of the first cache line of the CCB: it is
+  // read only for the coroutines of the deadline scheduling class
+  if ((ccb->edf_deadline >= 0) && (ccb->edf_idx >= 0)) {
+    crtn_edf_del(rq, ccb);
+  }
 
-  // We should never come back here as the state
-  // of the coroutine being ZOMBIE, it must not
-  // be scheduled again
-  assert(0);
-  
-} // crtn_end
+#ifdef HAVE_CRTN_MT
+  (void)__atomic_sub_fetch(&(rq->nb), 1, __ATOMIC_RELAXED);
+#endif // HAVE_CRTN_MT
+} // crtn_runnable_del
 
 
-static void crtn_entry(void)
+void crtn_make_runnable(crtn_link_t *link)
 {
-  crtn_ccb_t *ccb = crtn_current;
-  int status;
+  crtn_ccb_t *ccb = CRTN_LINK2CCB(link);
+  crtn_rq_t  *rq;
 
-  // Call the entry point
-  status = ccb->entry(ccb->param);
+  // The coroutine is woken up before the end of its timeout
+  crtn_timer_stop(ccb);
 
-  // Handle termination (cancellation, exit)
-  crtn_end(status);
+  rq = crtn_rq_lock(ccb);
+  ccb->state = CRTN_STATE_RUNNABLE;
+  crtn_runnable_add(rq, ccb, 0);
+  CRTN_UNLOCK(&(rq->lock));
 
-} // crtn_entry
+  CRTN_MT_WAKEUP();
+}
 
 
-static void crtn_fill_ccb(
+/*
+  Runnable coroutine with the earliest deadline or first coroutine of
+  the highest priority non empty runnable list
+*/
+static crtn_link_t *crtn_runnable_front(crtn_rq_t *rq)
+{
+  unsigned int  prio;
+  crtn_ccb_t   *ccb;
+
+  while (rq->edf_nb) {
+
+    ccb = rq->edf_heap[0];
+
+    if (CRTN_STATE_RUNNABLE == ccb->state) {
+      return &(ccb->link);
+    }
+
+    // Lazy removal of the coroutines which are no longer runnable
+    crtn_edf_del(rq, ccb);
+  }
+
+  while (rq->map) {
+
+    prio = (unsigned int)__builtin_ctz(rq->map);
+
+    if (!CRTN_LIST_EMPTY(&(rq->list[prio]))) {
+      return rq->list[prio].next;
+    }
+
+    // Lazy update of the bitmap
+    rq->map &= ~(1U << prio);
+  }
+
+  return NULL;
+}
+
+
+/*
+  Elect the next coroutine of a run queue (locked by the caller)
+*/
+static crtn_ccb_t *crtn_rq_pick(crtn_rq_t *rq)
+{
+  crtn_link_t *plink;
+  crtn_ccb_t  *ccb;
+
+  plink = crtn_runnable_front(rq);
+  if (!plink) {
+    return (crtn_ccb_t *)0;
+  }
+
+  ccb = CRTN_LINK2CCB(plink);
+  assert(ccb->state == CRTN_STATE_RUNNABLE);
+  crtn_runnable_del(rq, ccb);
+  ccb->state = CRTN_STATE_RUNNING;
+
+  return ccb;
+} // crtn_rq_pick
+
+
+#ifdef HAVE_CRTN_MT
+/*
+  The run queue of the calling thread is empty: take the first
+  coroutine of another run queue. It moves into the run queue of
+  the calling thread.
+*/
+static crtn_ccb_t *crtn_rq_steal(crtn_rq_t *rq)
+{
+  size_t      self = (size_t)(rq - crtn_rqs);
+  size_t      i;
+  crtn_rq_t  *victim;
+  crtn_ccb_t *ccb;
+
+  for (i = 1; i < crtn_workers; i ++) {
+
+    victim = &(crtn_rqs[(self + i) % crtn_workers]);
+    if (!__atomic_load_n(&(victim->nb), __ATOMIC_RELAXED)) {
+      continue;
+    }
+
+    CRTN_LOCK(&(victim->lock));
+    ccb = crtn_rq_pick(victim);
+    if (ccb) {
+      __atomic_store_n(&(ccb->rq), rq, __ATOMIC_RELEASE);
+      CRTN_UNLOCK(&(victim->lock));
+      return ccb;
+    }
+    CRTN_UNLOCK(&(victim->lock));
+  }
+
+  return (crtn_ccb_t *)0;
+} // crtn_rq_steal
+
+
+/*
+  Are there queued coroutines?
+*/
+static int crtn_rq_pending(void)
+{
+  size_t i;
+
+  for (i = 0; i < crtn_workers; i ++) {
+    if (__atomic_load_n(&(crtn_rqs[i].nb), __ATOMIC_SEQ_CST)) {
+      return 1;
+    }
+  }
+
+  return 0;
+} // crtn_rq_pending
+#endif // HAVE_CRTN_MT
+
+
+#ifdef HAVE_CRTN_IO
+#define CRTN_IO_PENDING() crtn_io_pending()
+#else
+#define CRTN_IO_PENDING() 0
+#endif // HAVE_CRTN_IO
+
+
+#ifndef HAVE_CRTN_MT
+/*
+  No runnable coroutines: the processor sleeps until the earliest
+  deadline or an event on the file descriptors the coroutines are
+  blocked on
+*/
+static void crtn_sched_idle(void)
+{
+#ifdef HAVE_CRTN_IO
+  if (crtn_io_pending()) {
+    crtn_io_poll(crtn_timer_next());
+    return;
+  }
+#endif // HAVE_CRTN_IO
+
+  crtn_timer_idle();
+}
+#endif // HAVE_CRTN_MT
+
+
+/*
+  Next coroutine to run, removed from the runnable lists, after the
+  expiration of the elapsed timers (and the check of the file
+  descriptors). In multithreaded mode, this is the idle context of the
+  calling thread if there are no runnable coroutines.
+*/
+static crtn_ccb_t *crtn_sched_next(void)
+{
+  crtn_rq_t  *rq = CRTN_RQ_SELF();
+  crtn_ccb_t *ccb;
+
+  if (crtn_timer_pending()) {
+    crtn_timer_expire();
+  }
+
+#ifdef HAVE_CRTN_IO
+  if (crtn_io_pending()) {
+    crtn_io_check();
+  }
+#endif // HAVE_CRTN_IO
+
+  CRTN_LOCK(&(rq->lock));
+  ccb = crtn_rq_pick(rq);
+  CRTN_UNLOCK(&(rq->lock));
+
+#ifdef HAVE_CRTN_MT
+  if (!ccb) {
+    ccb = crtn_rq_steal(rq);
+    if (!ccb) {
+      ccb = *crtn_idle_ptr();
+    }
+  }
+#else
+  while (!ccb && (crtn_timer_pending() || CRTN_IO_PENDING())) {
+    crtn_sched_idle();
+    ccb = crtn_rq_pick(rq);
+  }
+
+  // If there are no schedulable coroutines, this is a dead end!
+  assert(ccb);
+#endif // HAVE_CRTN_MT
+
+  return ccb;
+}
+
+
+void crtn_make_waiting(
+                    crtn_link_t *list,
+                    crtn_link_t *link
+                   )
+{
+  CRTN_LIST_DEL(link);
+  CRTN_LINK2CCB(link)->state = CRTN_STATE_WAITING;
+  if (list) {
+    // FIFO order: the oldest waiter is woken up first
+    CRTN_LIST_ADD_TAIL(list, link);
+  }
+}
+
+
+#ifdef HAVE_CRTN_MT
+/*
+  The current coroutine picked itself in the run queues while another
+  thread requested its cancellation: it is queued back and resumed
+  through the idle context of the thread to apply the cancellation
+  (cf. crtn_switch()).
+  Return 1 if the coroutine has been resumed, 0 otherwise
+*/
+static int crtn_yield_cancelled(crtn_ccb_t *ccb)
+{
+  crtn_rq_t *rq;
+
+  if (!(__atomic_load_n(&(ccb->flags), __ATOMIC_SEQ_CST) & CRTN_CCB_FLAG_CANCEL_PENDING)) {
+    return 0;
+  }
+
+  rq = crtn_rq_lock(ccb);
+  ccb->state = CRTN_STATE_RUNNABLE;
+  crtn_runnable_add(rq, ccb, 1);
+  CRTN_UNLOCK(&(rq->lock));
+
+  crtn_current = *crtn_idle_ptr();
+  crtn_switch(ccb, crtn_current);
+
+  return 1;
+} // crtn_yield_cancelled
+#endif // HAVE_CRTN_MT
+
+
+/*
+  Give back the processor after a call to crtn_make_waiting() from a
+  blocking service (e.g. crtn_join(), crtn_mbx_get()...). In
+  multithreaded mode, the state of the current coroutine is not read
+  as its waker may make it runnable (and another thread may take it)
+  before it leaves the processor
+*/
+void crtn_suspend(void)
+{
+  crtn_ccb_t *next_ccb;
+  crtn_ccb_t *old_ccb;
+
+#ifdef HAVE_CRTN_MT
+  // The idle threads take into account the timeout (if any)
+  if (__atomic_load_n(&(crtn_current->deadline), __ATOMIC_RELAXED) != CRTN_TIME_INFINITE) {
+    CRTN_MT_WAKEUP();
+  }
+#endif // HAVE_CRTN_MT
+
+  // Context switch (unless the current coroutine has been
+  // woken up in the meantime)
+  next_ccb = crtn_sched_next();
+  old_ccb = crtn_current;
+  crtn_current = next_ccb;
+  crtn_current->state = CRTN_STATE_RUNNING;
+  if (next_ccb != old_ccb) {
+    crtn_switch(old_ccb, next_ccb);
+  }
+#ifdef HAVE_CRTN_MT
+  else {
+    (void)crtn_yield_cancelled(old_ccb);
+  }
+#endif // HAVE_CRTN_MT
+
+} // crtn_suspend
+
+
+int crtn_yield(void *data)
+{
+  int rc;
+  crtn_ccb_t *next_ccb;
+  crtn_ccb_t *old_ccb;
+  crtn_rq_t  *rq;
+
+  switch(crtn_current->state) {
+
+    case CRTN_STATE_RUNNING: {
+
+      // The current coroutine will stay runnable only if it is not a stepper
+      if (crtn_current->attr.type & CRTN_TYPE_STEPPER) {
+
+        old_ccb = crtn_current;
+
+        // Put current coroutine in the READY state
+        CRTN_LOCK(&(old_ccb->lock));
+        old_ccb->state = CRTN_STATE_READY;
+
+        // If some coroutine is waiting on the current coroutine (it
+        // may be woken up by its canceller in the meantime)
+        next_ccb = old_ccb->waiting;
+        if (next_ccb && CRTN_CLAIM(next_ccb)) {
+
+          // Pass the data
+          old_ccb->yielded_data = data;
+          CRTN_UNLOCK(&(old_ccb->lock));
+
+          // Fast path: direct return to the waiting coroutine which
+          // runs without being queued in the runnable lists. It makes
+          // the stepper ready again (cf. crtn_wait_internal()).
+          assert(next_ccb->state == CRTN_STATE_WAITING);
+          crtn_current = next_ccb;
+          crtn_current->state = CRTN_STATE_RUNNING;
+          crtn_switch(old_ccb, next_ccb);
+
+          return CRTN_SCHED_OTHER;
+        }
+
+        old_ccb->waiting = 0;
+        CRTN_ARM(old_ccb);
+        CRTN_UNLOCK(&(old_ccb->lock));
+
+        // Context switch
+        next_ccb = crtn_sched_next();
+        crtn_current = next_ccb;
+        crtn_current->state = CRTN_STATE_RUNNING;
+        crtn_switch(old_ccb, next_ccb);
+
+        rc = CRTN_SCHED_OTHER;
+
+      } else {
+
+        // The coroutine is STANDALONE, it decided to give the processor
+
+        // The current coroutine stays RUNNABLE at the end of the
+        // runnable list of its priority (brand new coroutines from
+        // calls to crtn_spawn() may be located before it)
+        old_ccb = crtn_current;
+        rq = crtn_rq_lock(old_ccb);
+        old_ccb->state = CRTN_STATE_RUNNABLE;
+        crtn_runnable_add(rq, old_ccb, 0);
+        CRTN_UNLOCK(&(rq->lock));
+
+        // Get the schedulable coroutine (1st of the highest priority list)
+        next_ccb = crtn_sched_next();
+
+        // Context switch if it is not the current one
+        if (next_ccb != old_ccb) {
+
+          // The current coroutine may be resumed by an idle thread
+          CRTN_MT_WAKEUP();
+
+          crtn_current = next_ccb;
+          crtn_current->state = CRTN_STATE_RUNNING;
+          crtn_switch(old_ccb, next_ccb);
+
+          rc = CRTN_SCHED_OTHER;
+        } else {
+
+#ifdef HAVE_CRTN_MT
+          if (crtn_yield_cancelled(old_ccb)) {
+            return CRTN_SCHED_OTHER;
+          }
+#endif // HAVE_CRTN_MT
+
+          crtn_current->state = CRTN_STATE_RUNNING;
+          rc = CRTN_SCHED_SELF;
+        }
+      }
+    }
+    break;
+
+    case CRTN_STATE_ZOMBIE: {
+
+      // The current coroutine reached the end of its entry point
+      // or it called crtn_exit()
+      old_ccb = crtn_current;
+
+      // If a coroutine is joining or waiting (it may be woken up
+      // by its timer or its canceller in the meantime)
+      CRTN_LOCK(&(old_ccb->lock));
+
+      if (old_ccb->joining) {
+
+        // Put the joining coroutine in the ready list
+        if (CRTN_CLAIM(old_ccb->joining)) {
+          crtn_make_runnable(&(old_ccb->joining->link));
+        }
+
+      } else if (old_ccb->waiting) {
+
+        // If a coroutine is waiting
+        assert(old_ccb->attr.type & CRTN_TYPE_STEPPER);
+
+        // No data: the waiting coroutine no longer refers to the
+        // coroutine which may be freed as soon as it is joined
+        next_ccb = old_ccb->waiting;
+        if (CRTN_CLAIM(next_ccb)) {
+          old_ccb->yielded_data = 0;
+          old_ccb->waiting = 0;
+          next_ccb->waiting_on = 0;
+
+          // Put the waiting coroutine in the ready list
+          crtn_make_runnable(&(next_ccb->link));
+        }
+
+      }
+
+      CRTN_UNLOCK(&(old_ccb->lock));
+
+      // Context switch
+      next_ccb = crtn_sched_next();
+      crtn_current = next_ccb;
+      crtn_current->state = CRTN_STATE_RUNNING;
+      crtn_switch(old_ccb, next_ccb);
+
+      rc = CRTN_SCHED_OTHER;
+    }
+    break;
+
+    case CRTN_STATE_WAITING: {
+
+      // The current coroutine called a blocking service
+      crtn_suspend();
+
+      rc = CRTN_SCHED_OTHER;
+    }
+    break;
+
+    default: {
+
+      assert(0);
+
+      crtn_set_errno(ENOSYS);
+      rc = -1;
+
+    }
+    break;
+
+  } // End switch
+
+  return rc;
+
+} // crtn_yield
+
+
+int crtn_yield_to(
+                  crtn_t  cid,
+                  void   *data
+                 )
+{
+  crtn_ccb_t *next_ccb;
+  crtn_ccb_t *old_ccb;
+  crtn_rq_t  *rq;
+
+  next_ccb = crtn_tab_lookup(cid);
+  if (!next_ccb) {
+    return -1;
+  }
+
+  if (next_ccb == crtn_current) {
+    CRTN_TAB_UNLOCK();
+    crtn_set_errno(EINVAL);
+    return -1;
+  }
+
+  // Only the runnable standalone coroutines can exchange the processor
+  // (the steppers are driven by crtn_wait())
+  if ((crtn_current->attr.type | next_ccb->attr.type) & CRTN_TYPE_STEPPER) {
+    CRTN_TAB_UNLOCK();
+    crtn_set_errno(EPERM);
+    return -1;
+  }
+
+  rq = crtn_rq_lock(next_ccb);
+  if (next_ccb->state != CRTN_STATE_RUNNABLE) {
+    CRTN_UNLOCK(&(rq->lock));
+    CRTN_TAB_UNLOCK();
+    crtn_set_errno(EPERM);
+    return -1;
+  }
+  crtn_runnable_del(rq, next_ccb);
+  next_ccb->state = CRTN_STATE_RUNNING;
+  CRTN_UNLOCK(&(rq->lock));
+  CRTN_TAB_UNLOCK();
+
+  // Direct context switch: the calling coroutine takes the place of
+  // the target at the head of the runnable list of its priority
+  next_ccb->yield_data = data;
+  old_ccb = crtn_current;
+  rq = crtn_rq_lock(old_ccb);
+  old_ccb->state = CRTN_STATE_RUNNABLE;
+  crtn_runnable_add(rq, old_ccb, 1);
+  CRTN_UNLOCK(&(rq->lock));
+  CRTN_MT_WAKEUP();
+  crtn_current = next_ccb;
+  crtn_switch(old_ccb, next_ccb);
+
+  return CRTN_SCHED_OTHER;
+
+} // crtn_yield_to
+
+
+void *crtn_yield_data(void)
+{
+  return crtn_current->yield_data;
+} // crtn_yield_data
+
+
+/*
+  Leave the deadline scheduling class
+*/
+/*
+  Remove a coroutine from the deadline scheduling class
+*/
+static void crtn_edf_leave(crtn_ccb_t *ccb)
+{
+  crtn_rq_t *rq;
+
+  CRTN_LOCK(&crtn_edf_lock);
+  rq = crtn_rq_lock(ccb);
+
+  if (ccb->edf_deadline >= 0) {
+    if (ccb->edf_idx >= 0) {
+      crtn_edf_del(rq, ccb);
+    }
+    ccb->edf_deadline = -1;
+    crtn_edf_users --;
+  }
+
+  CRTN_UNLOCK(&(rq->lock));
+  CRTN_UNLOCK(&crtn_edf_lock);
+} // crtn_edf_leave
+
+
+static void crtn_end(int status)
+{
+  crtn_ccb_t *ccb;
+
+  ccb = crtn_current;
+  ccb->status = status;
+
+  // Leave the deadline scheduling class
+  if (ccb->edf_deadline >= 0) {
+    crtn_edf_leave(ccb);
+  }
+
+  // Change the state
+  ccb->state = CRTN_STATE_ZOMBIE;
+
+  // Get out from the runnable list
+  CRTN_LIST_DEL(&(ccb->link));
+
+  // Give back the processor
+  crtn_yield(0);
+
+  // We should never come back here as the state
+  // of the coroutine being ZOMBIE, it must not
+  // be scheduled again
+  assert(0);
+  
+} // crtn_end
+
+
+static void crtn_entry(void)
+{
+  crtn_ccb_t *ccb;
+  int status;
+
+  // End of the context switch to the brand new coroutine
+  CRTN_SWITCH_FINISH();
+
+  ccb = crtn_current;
+
+  // Call the entry point
+  status = ccb->entry(ccb->param);
+
+  // Handle termination (cancellation, exit)
+  crtn_end(status);
+
+} // crtn_entry
+
+
+static void crtn_cancelled(void)
+{
+
+  // End of the context switch to the cancelled coroutine
+  CRTN_SWITCH_FINISH();
+
+  // Handle termination (cancellation)
+  crtn_end(CRTN_STATUS_CANCELLED);
+
+} // crtn_cancelled
+
+
+static void crtn_fill_ccb(
                           crtn_ccb_t   *ccb,
                           const char   *name,
                           char         *stack,
@@ -404,6 +1395,7 @@ static void crtn_fill_ccb(
   ccb->entry = entry;
   ccb->param = param;
   ccb->stack = stack;
+  ccb->stack_size = stack_sz;
   ccb->joining = 0;
   snprintf(ccb->name, CRTN_NAME_SZ, "%s", name);
   ccb->flags = 0;
@@ -412,508 +1404,1325 @@ static void crtn_fill_ccb(
   } else {
     ccb->attr = crtn_default_attr;
   }
-  ccb->waiting = 0;
-  ccb->yielded_data = 0;
-  CRTN_LINK_INIT(&(ccb->link));
+  ccb->waiting = 0;
+  ccb->yielded_data = 0;
+  ccb->yield_data = 0;
+  ccb->gen_in = 0;
+  ccb->wait_obj = ccb->handoff = 0;
+  ccb->cancel_hook = 0;
+  ccb->io_fd = -1;
+  ccb->edf_deadline = -1;
+  ccb->edf_idx = -1;
+  ccb->deadline = CRTN_TIME_INFINITE;
+  CRTN_LINK_INIT(&(ccb->tlink));
+  CRTN_LINK_INIT(&(ccb->link));
+#ifdef HAVE_CRTN_MT
+  ccb->rq = CRTN_RQ_SELF();
+  ccb->wait_lock = 0;
+  CRTN_LOCK_INIT(&(ccb->lock));
+  ccb->on_cpu = 0;
+  ccb->armed = 0;
+#endif // HAVE_CRTN_MT
+
+} // crtn_fill_ccb
+
+
+int crtn_spawn(
+               crtn_t       *cid,
+               const char   *name,
+               crtn_entry_t  entry,
+               void         *param,
+               crtn_attr_t   attr
+              )
+{
+  char            *stack;
+  size_t           stack_sz;
+  size_t           alloc_sz;
+  crtn_ccb_t      *ccb;
+  char            *p;
+  crtn_ccb_attr_t *iattr;
+  int              rc;
+
+  // Check the parameters
+  if (!cid || !entry || !name) {
+    crtn_set_errno(EINVAL);
+    return -1;
+  }
+
+  *cid = -1;
+
+  if (attr) {
+    iattr = (crtn_ccb_attr_t *)attr;
+  } else {
+    iattr = &crtn_default_attr;
+  }
+
+#ifdef HAVE_CRTN_MT
+  // The stackless and copy-stack coroutines share one stack: they
+  // can't be run by several threads
+  if ((iattr->type & (CRTN_TYPE_STACKLESS | CRTN_TYPE_COPYSTACK)) &&
+      (crtn_workers > 1)) {
+    crtn_set_errno(EINVAL);
+    return -1;
+  }
+#endif // HAVE_CRTN_MT
+
+  if (iattr->type & (CRTN_TYPE_STACKLESS | CRTN_TYPE_COPYSTACK)) {
+
+    // This is a stackless or copy-stack coroutine
+
+    // The CCB is allocated globally but to be able to set
+    // a termination context in crtn_cancel(), a termination
+    // stack must be set up otherwise, the cancel stack frame
+    // can be clobbered by other running stackless coroutines
+
+    // Allocate the CCB
+    alloc_sz = CRTN_CANCEL_STACK_SIZE;
+    stack = crtn_stack_alloc(&alloc_sz, CRTN_STACK_MALLOC);
+    if (!stack) {
+      return -1;
+    }
+
+    // The CCB is aligned at the bottom of the stack
+    p = stack + alloc_sz - sizeof(crtn_ccb_t); 
+    p = (char *)((unsigned long)p & ~(__alignof__(crtn_ccb_t) - 1));
+    ccb = (crtn_ccb_t *)p;
+    ccb->cancel_stack = stack;
+    ccb->cancel_stack_size = (size_t)(p - stack);
+    ccb->alloc_size = alloc_sz;
+
+    if (iattr->type & CRTN_TYPE_COPYSTACK) {
+
+      // The copy-stack coroutines run on the same stack which is saved
+      // into/restored from a private buffer upon context switches
+
+      // If the shared stack is not yet allocated, allocate it
+      if (!crtn_copystack) {
+        crtn_copystack_helper_stack = (char *)malloc(CRTN_COPYSTACK_HELPER_SIZE);
+        crtn_copystack = (char *)malloc(crtn_stack_size);
+        if (!crtn_copystack || !crtn_copystack_helper_stack) {
+          crtn_set_errno(errno);
+          free(crtn_copystack);
+          free(crtn_copystack_helper_stack);
+          crtn_copystack = crtn_copystack_helper_stack = (char *)0;
+          crtn_stack_free(ccb->cancel_stack, alloc_sz, CRTN_STACK_MALLOC);
+          return -1;
+        }
+
+        crtn_ctx_make(&crtn_copystack_helper_ctx, crtn_copystack_helper_stack,
+                      CRTN_COPYSTACK_HELPER_SIZE, crtn_copystack_helper);
+      }
+
+      stack = crtn_copystack;
+      stack_sz = crtn_stack_size;
+
+      ccb->copy = (char *)0;
+      ccb->copy_size = ccb->copy_len = 0;
+
+    } else {
+
+      // At runtime, the stackless coroutines actually all use the same
+      // stack to avoid the pollution of the caller's stack
+
+      // If the stackless stack is not yet allocated, allocate it
+      if (!crtn_stackless) {
+        crtn_stackless = (char *)malloc(crtn_stack_size);
+        if (!crtn_stackless) {
+          crtn_set_errno(errno);
+          crtn_stack_free(ccb->cancel_stack, alloc_sz, CRTN_STACK_MALLOC);
+          return -1;
+        }
+      }
+
+      stack = crtn_stackless;
+      stack_sz = crtn_stack_size;
+    }
+
+  } else {
+
+    // The CCB will be at the bottom of the stack
+
+    // Dynamic allocation of the stack (possibly recycled from a
+    // previously freed coroutine)
+    alloc_sz = iattr->stack_size;
+    stack = crtn_stack_alloc(&alloc_sz, iattr->stack_mode);
+    if (!stack) {
+      return -1;
+    }
+
+    // The CCB is aligned at the bottom of the stack
+    p = stack + alloc_sz - sizeof(crtn_ccb_t); 
+    p = (char *)((unsigned long)p & ~(__alignof__(crtn_ccb_t) - 1));
+    ccb = (crtn_ccb_t *)p;
+    ccb->alloc_size = alloc_sz;
+    stack_sz = (size_t)(p - stack);
+  }
+
+  crtn_fill_ccb(ccb, name, stack, stack_sz, entry, param, iattr);
+
+  // The coroutine inherits the signal mask of its creator
+  if (ccb->attr.sigmask) {
+    sigprocmask(SIG_BLOCK, 0, &(ccb->sigmask));
+  }
+
+  // Initialize the execution context on the stack
+  if (ccb->attr.type & CRTN_TYPE_COPYSTACK) {
+    // The shared stack may be in use: the context is made when the
+    // coroutine is scheduled for the first time
+    ccb->flags |= CRTN_CCB_FLAG_NEWCTX;
+  } else {
+    crtn_ctx_make(&(ccb->ctx), stack, stack_sz, crtn_entry);
+  }
+
+  CRTN_TAB_WRLOCK();
+
+  // No free identifier ==> Extend the table
+  rc = 0;
+  if (crtn_free_ids < 0) {
+    rc = crtn_tab_grow();
+  }
+
+#ifdef HAVE_CRTN_MT
+  // Start the threads running the coroutines
+  if (!rc && (crtn_workers_nb < crtn_workers)) {
+    rc = crtn_mt_start();
+  }
+#endif // HAVE_CRTN_MT
+
+  if (rc) {
+    CRTN_TAB_UNLOCK();
+    crtn_free_stack(ccb);
+    crtn_set_errno(rc);
+    return -1;
+  }
+
+  ccb->cid = crtn_get_id(ccb);
+  assert(ccb->cid >= 0);
+
+  CRTN_TAB_UNLOCK();
+
+  *cid = ccb->cid;
+
+  if (ccb->attr.type & CRTN_TYPE_STEPPER) {
+    ccb->state = CRTN_STATE_READY;
+    CRTN_ARM(ccb);
+  } else {
+    crtn_make_runnable(&(ccb->link));
+  }
+
+  return 0;
+} // crtn_spawn
+
+
+crtn_attr_t crtn_attr_new(void)
+{
+  crtn_ccb_attr_t *iattr;
+
+  iattr = (crtn_ccb_attr_t *)malloc(sizeof(crtn_ccb_attr_t));
+  *iattr = crtn_default_attr;
+  return (crtn_attr_t)iattr;
+
+} // crtn_attr_new
+
+
+int crtn_attr_delete(
+                     crtn_attr_t attr
+                    )
+{
+  if (!attr) {
+    crtn_set_errno(EINVAL);
+    return -1;
+  }
+
+  free(attr);
+
+  return 0;
+
+} // crtn_attr_delete
+
+
+int crtn_set_attr_type(
+                       crtn_attr_t attr,
+                       unsigned int type
+                      )
+{
+crtn_ccb_attr_t *iattr;
+
+#define CRTN_TYPE_MASK 0x7
+
+  if (!attr ||
+      (type & ~CRTN_TYPE_MASK)) {
+    crtn_set_errno(EINVAL);
+    return -1;
+  }
+
+  iattr = (crtn_ccb_attr_t *)attr;
+
+  // A coroutine can't be both stackless and copy-stack
+  if (((iattr->type | type) & (CRTN_TYPE_STACKLESS | CRTN_TYPE_COPYSTACK)) ==
+      (CRTN_TYPE_STACKLESS | CRTN_TYPE_COPYSTACK)) {
+    crtn_set_errno(EINVAL);
+    return -1;
+  }
+
+  if (type & CRTN_TYPE_STACKLESS) {
+    iattr->type |= CRTN_TYPE_STACKLESS;
+    iattr->stack_size = 0;
+  } else if (type & CRTN_TYPE_COPYSTACK) {
+    iattr->type |= CRTN_TYPE_COPYSTACK;
+    iattr->stack_size = 0;
+  } else {
+    assert(iattr->stack_size ||
+           (iattr->type & (CRTN_TYPE_STACKLESS | CRTN_TYPE_COPYSTACK)));
+  }
+
+  if (type & CRTN_TYPE_STEPPER) {
+    iattr->type |= CRTN_TYPE_STEPPER;
+  }
+
+  return 0;
+} // crtn_set_attr_type
+
+
+int crtn_set_attr_stack_size(
+                       crtn_attr_t attr,
+                       size_t stack_size
+                      )
+{
+crtn_ccb_attr_t *iattr;
+
+  if (!attr ||
+      (stack_size < crtn_stack_size)) {
+    crtn_set_errno(EINVAL);
+    return -1;
+  }
+
+  iattr = (crtn_ccb_attr_t *)attr;
+  if (iattr->type & (CRTN_TYPE_STACKLESS | CRTN_TYPE_COPYSTACK)) {
+    crtn_set_errno(EINVAL);
+    return -1;
+  }
+  iattr->stack_size = stack_size;
+
+  return 0;
+} // crtn_set_attr_stack_size
+
+
+int crtn_set_attr_sigmask(
+                          crtn_attr_t attr,
+                          int sigmask
+                         )
+{
+crtn_ccb_attr_t *iattr;
+
+  if (!attr) {
+    crtn_set_errno(EINVAL);
+    return -1;
+  }
+
+  iattr = (crtn_ccb_attr_t *)attr;
+  iattr->sigmask = (sigmask ? 1 : 0);
+
+  return 0;
+} // crtn_set_attr_sigmask
+
+
+int crtn_set_attr_stack_mode(
+                             crtn_attr_t attr,
+                             unsigned int mode
+                            )
+{
+crtn_ccb_attr_t *iattr;
+
+  if (!attr ||
+      ((CRTN_STACK_MALLOC != mode) &&
+       (CRTN_STACK_GUARD != mode) &&
+       (CRTN_STACK_LAZY != mode))) {
+    crtn_set_errno(EINVAL);
+    return -1;
+  }
+
+  iattr = (crtn_ccb_attr_t *)attr;
+  iattr->stack_mode = mode;
+
+  return 0;
+} // crtn_set_attr_stack_mode
+
+
+int crtn_set_attr_prio(
+                       crtn_attr_t attr,
+                       unsigned int prio
+                      )
+{
+crtn_ccb_attr_t *iattr;
+
+  if (!attr ||
+      (prio > CRTN_PRIO_LOWEST)) {
+    crtn_set_errno(EINVAL);
+    return -1;
+  }
+
+  iattr = (crtn_ccb_attr_t *)attr;
+  iattr->prio = prio;
+
+  return 0;
+} // crtn_set_attr_prio
+
+
+void crtn_exit(int status)
+{
+
+  // Handle termination (cancellation, exit)
+  crtn_end(status);  
+
+} // crtn_exit
+
+
+static int crtn_join_internal(
+                              crtn_t       cid,
+                              int         *status,
+                              crtn_time_t  timeout
+                             )
+{
+crtn_ccb_t *ccb;
+
+  ccb = crtn_tab_lookup(cid);
+  if (!ccb) {
+    return -1;
+  }
 
-  // Initialize the stack in the context
-  ccb->ctx.uc_stack.ss_sp = stack;
-  ccb->ctx.uc_stack.ss_size = stack_sz;
-  ccb->ctx.uc_stack.ss_flags = 0;
-  ccb->ctx.uc_link = 0;
+  if (ccb == crtn_current) {
+    CRTN_TAB_UNLOCK();
+    crtn_set_errno(EINVAL);
+    return -1;
+  }
 
-} // crtn_fill_ccb
+  // Only the joining coroutine frees the CCB: the table is unlocked
+  // once the join is registered
+  CRTN_LOCK(&(ccb->lock));
 
+  if (ccb->joining) {
+    CRTN_UNLOCK(&(ccb->lock));
+    CRTN_TAB_UNLOCK();
+    crtn_set_errno(EBUSY);
+    return -1;
+  }
 
-int crtn_spawn(
-               crtn_t       *cid,
-               const char   *name,
-               crtn_entry_t  entry,
-               void         *param,
-               crtn_attr_t   attr
-              )
+  switch(ccb->state) {
+
+    case CRTN_STATE_ZOMBIE: {
+      ccb->joining = crtn_current;
+      crtn_current->joining_on = ccb;
+      CRTN_UNLOCK(&(ccb->lock));
+      CRTN_TAB_UNLOCK();
+    }
+    break;
+
+    case CRTN_STATE_ALLOCATED: // Being spawned
+    case CRTN_STATE_RUNNING:   // On another thread
+    case CRTN_STATE_RUNNABLE:
+    case CRTN_STATE_WAITING:
+    case CRTN_STATE_READY: {
+
+      if (0 == timeout) {
+        CRTN_UNLOCK(&(ccb->lock));
+        CRTN_TAB_UNLOCK();
+        crtn_set_errno(ETIMEDOUT);
+        return -1;
+      }
+
+      crtn_make_waiting(0, &(crtn_current->link));
+      CRTN_SET_WAIT_LOCK(crtn_current, &(ccb->lock));
+
+      ccb->joining = crtn_current;
+      crtn_current->joining_on = ccb;
+
+      crtn_timer_start(crtn_current, timeout);
+
+      CRTN_UNLOCK(&(ccb->lock));
+      CRTN_TAB_UNLOCK();
+
+      // Give back the processor
+      crtn_suspend();
+
+      // The coroutine may resume on another thread
+      CRTN_SET_WAIT_LOCK(crtn_current, 0);
+
+      // The timeout elapsed: the join has been disabled
+      if (crtn_current->flags & CRTN_CCB_FLAG_TIMEDOUT) {
+        CRTN_FLAG_CLR(crtn_current, CRTN_CCB_FLAG_TIMEDOUT);
+        crtn_set_errno(ETIMEDOUT);
+        return -1;
+      }
+    }
+    break;
+
+    default: {
+
+      assert(0);
+    }
+    break;
+
+  } // End switch
+
+  // For stackless coroutines, the local variables are clobbered here
+  // ==> Reload 'ccb'
+  ccb = crtn_current->joining_on;
+
+  if (status) {
+    *status = ccb->status;
+  }
+
+  crtn_current->joining_on = 0;
+  ccb->joining = 0;
+
+  // Free the coroutine
+  crtn_free(ccb);
+
+  return 0;
+} // crtn_join_internal
+
+
+int crtn_join(crtn_t cid, int *status)
 {
-  char            *stack;
-  size_t           stack_sz;
-  crtn_ccb_t      *ccb;
-  char            *p;
-  crtn_ccb_attr_t *iattr;
+  return crtn_join_internal(cid, status, CRTN_TIME_INFINITE);
+} // crtn_join
 
-  // Check the parameters
-  if (!cid || !entry || !name) {
+
+int crtn_timedjoin(
+                   crtn_t       cid,
+                   int         *status,
+                   crtn_time_t  timeout
+                  )
+{
+  if (timeout < 0) {
     crtn_set_errno(EINVAL);
     return -1;
   }
 
-  *cid = -1;
+  return crtn_join_internal(cid, status, timeout);
+} // crtn_timedjoin
+
 
-  if ((size_t)crtn_nb >= crtn_max) {
-    crtn_set_errno(EAGAIN);
+crtn_time_t crtn_now(void)
+{
+  return crtn_timer_now();
+} // crtn_now
+
+
+int crtn_sleep_until(crtn_time_t deadline)
+{
+  if (deadline < 0) {
+    crtn_set_errno(EINVAL);
     return -1;
   }
 
-  if (attr) {
-    iattr = (crtn_ccb_attr_t *)attr;
-  } else {
-    iattr = &crtn_default_attr;
+  crtn_make_waiting(0, &(crtn_current->link));
+
+  crtn_timer_start_at(crtn_current, deadline);
+
+  // Give back the processor until the expiration of the timer
+  crtn_suspend();
+
+  CRTN_FLAG_CLR(crtn_current, CRTN_CCB_FLAG_TIMEDOUT);
+
+  return 0;
+} // crtn_sleep_until
+
+
+int crtn_sleep(crtn_time_t duration)
+{
+  if (duration < 0) {
+    crtn_set_errno(EINVAL);
+    return -1;
   }
 
-  if (iattr->type & CRTN_TYPE_STACKLESS) {
+  return crtn_sleep_until(crtn_timer_now() + duration);
+} // crtn_sleep
 
-    // This is a stackless coroutine
 
-    // The CCB is allocated globally but to be able to set
-    // a termination context in crtn_cancel(), a termination
-    // stack must be set up otherwise, the cancel stack frame
-    // can be clobbered by other running stackless coroutines
+/*
+  Make room for "sz" coroutines in the heaps of the deadline
+  scheduling class
+  Return 0 or an errno value
+*/
+static int crtn_edf_grow(unsigned int sz)
+{
+  crtn_rq_t    *rq;
+  crtn_ccb_t  **heap;
+  size_t        i;
+  int           rc = 0;
 
-    // Allocate the CCB
-    stack = (char *)malloc(CRTN_CANCEL_STACK_SIZE);
-    if (!stack) {
-      crtn_set_errno(errno);
-      return -1;
+#ifdef HAVE_CRTN_MT
+  for (i = 0; i < crtn_workers; i ++) {
+#else
+  for (i = 0; i < 1; i ++) {
+#endif // HAVE_CRTN_MT
+
+    rq = &(crtn_rqs[i]);
+
+    CRTN_LOCK(&(rq->lock));
+    heap = (crtn_ccb_t **)realloc(rq->edf_heap, sz * sizeof(crtn_ccb_t *));
+    if (heap) {
+      rq->edf_heap = heap;
+    } else {
+      rc = ENOMEM;
     }
+    CRTN_UNLOCK(&(rq->lock));
 
-    // The CCB is aligned at the bottom of the stack
-    p = stack + CRTN_CANCEL_STACK_SIZE - sizeof(crtn_ccb_t); 
-    p = (char *)((unsigned long)p & ~(__alignof__(crtn_ccb_t) - 1));
-    ccb = (crtn_ccb_t *)p;
-    ccb->cancel_stack = stack;
-    ccb->cancel_stack_size = (size_t)(p - stack);
+    if (rc) {
+      return rc;
+    }
+  }
 
-    // At runtime, the stackless coroutines actually all use the same
-    // stack to avoid the pollution of the caller's stack
+  crtn_edf_sz = sz;
 
-    // If the stackless stack is not yet allocated, allocate it
-    if (!crtn_stackless) {
-      crtn_stackless = (char *)malloc(crtn_stack_size);
-      if (!crtn_stackless) {
-        crtn_set_errno(errno);
-        free(ccb);
+  return 0;
+} // crtn_edf_grow
+
+
+int crtn_set_deadline(
+                      crtn_t      cid,
+                      crtn_time_t deadline
+                     )
+{
+crtn_ccb_t  *ccb;
+crtn_rq_t   *rq;
+int          rc;
+
+  ccb = crtn_tab_lookup(cid);
+  if (!ccb) {
+    return -1;
+  }
+
+  if (CRTN_STATE_ZOMBIE == ccb->state) {
+    CRTN_TAB_UNLOCK();
+    crtn_set_errno(EINVAL);
+    return -1;
+  }
+
+  // Leave the deadline scheduling class
+  if (deadline < 0) {
+    if (ccb->edf_deadline >= 0) {
+      crtn_edf_leave(ccb);
+    }
+
+    CRTN_TAB_UNLOCK();
+    return 0;
+  }
+
+  CRTN_LOCK(&crtn_edf_lock);
+
+  // Enter the deadline scheduling class: make room in the heaps
+  if (ccb->edf_deadline < 0) {
+    if (crtn_edf_users == crtn_edf_sz) {
+      rc = crtn_edf_grow(crtn_edf_sz ? crtn_edf_sz * 2 : 16);
+      if (rc) {
+        CRTN_UNLOCK(&crtn_edf_lock);
+        CRTN_TAB_UNLOCK();
+        crtn_set_errno(rc);
         return -1;
       }
     }
+    crtn_edf_users ++;
+  }
 
-    stack = crtn_stackless;
-    stack_sz = crtn_stack_size;
+  // Reorder the heap with the new deadline
+  rq = crtn_rq_lock(ccb);
+  if (ccb->edf_idx >= 0) {
+    crtn_edf_del(rq, ccb);
+  }
+  ccb->edf_deadline = deadline;
+  if (CRTN_STATE_RUNNABLE == ccb->state) {
+    crtn_edf_add(rq, ccb);
+  }
+  CRTN_UNLOCK(&(rq->lock));
 
-  } else {
+  CRTN_UNLOCK(&crtn_edf_lock);
+  CRTN_TAB_UNLOCK();
 
-    // The CCB will be at the bottom of the stack
+  return 0;
+} // crtn_set_deadline
 
-    // Dynamic allocation of the stack
-    stack_sz = iattr->stack_size;
-    stack = (char *)malloc(stack_sz);
-    if (!stack) {
-      crtn_set_errno(errno);
-      return -1;
-    }
 
-    // The CCB is aligned at the bottom of the stack
-    p = stack + stack_sz - sizeof(crtn_ccb_t); 
-    p = (char *)((unsigned long)p & ~(__alignof__(crtn_ccb_t) - 1));
-    ccb = (crtn_ccb_t *)p;
-    stack_sz = (size_t)(p - stack);
+/*
+  If 'in' is not NULL, it points on the input passed to the
+  generator (cf. crtn_gen_next())
+*/
+static int crtn_wait_internal(
+                              crtn_t       cid,
+                              void *const *in,
+                              void       **ret
+                             )
+{
+  crtn_ccb_t *ccb;
+  crtn_ccb_t *old_ccb;
+
+  ccb = crtn_tab_lookup(cid);
+  if (!ccb) {
+    return -1;
   }
 
-  ccb->cid = crtn_get_id(ccb);
-  assert(ccb->cid >= 0);
-  crtn_fill_ccb(ccb, name, stack, stack_sz, entry, param, iattr);
+  if (ccb == crtn_current) {
+    CRTN_TAB_UNLOCK();
+    crtn_set_errno(EINVAL);
+    return -1;
+  }
 
-  *cid = ccb->cid;
+  if (!(ccb->attr.type & CRTN_TYPE_STEPPER)) {
+    CRTN_TAB_UNLOCK();
+    crtn_set_errno(EINVAL);
+    return -1;
+  }
 
-  if (ccb->attr.type & CRTN_TYPE_STEPPER) {
-    ccb->state = CRTN_STATE_READY;
-  } else {
-    crtn_make_runnable(&(ccb->link));
+  // A ready stepper is armed: the calling coroutine runs the step if
+  // it wins the stepper over its canceller (or a concurrent waiter)
+  CRTN_LOCK(&(ccb->lock));
+  CRTN_TAB_UNLOCK();
+
+  if ((ccb->state != CRTN_STATE_READY) || !CRTN_CLAIM(ccb)) {
+    CRTN_UNLOCK(&(ccb->lock));
+    crtn_set_errno(EPERM);
+    return -1;
   }
 
-#if 1
+  // As it is ready, no join/wait has been done on it
+  assert(!(ccb->joining || ccb->waiting));
 
-  getcontext(&(ccb->ctx));
+  if (in) {
+    ccb->gen_in = *in;
+  }
 
-#else
+  crtn_make_waiting(0, &(crtn_current->link));
+  CRTN_SET_WAIT_LOCK(crtn_current, &(ccb->lock));
 
-  // We remove this check as the compiler complains with:
-  //  "variable 'ccb' might be clobbered by 'longjmp' or 'vfork' [-Werror=clobbered]"
+  ccb->waiting = crtn_current;
+  crtn_current->waiting_on = ccb;
 
-  // On x86_64 machines, getcontext() may fail only if the rt_sigprocmask() fails
-  {
-  int rc = getcontext(&(ccb->ctx));
+  CRTN_ARM(crtn_current);
+  CRTN_UNLOCK(&(ccb->lock));
 
-    if (0 != rc) {
-      crtn_set_errno(errno);
-      crtn_free_id(ccb->cid);
-      free(stack);
-      return -1;
+  // Fast path: direct call of the stepper coroutine which runs without
+  // being queued in the runnable lists. It gives back the processor
+  // directly to the calling coroutine in crtn_yield().
+  old_ccb = crtn_current;
+  crtn_current = ccb;
+  crtn_current->state = CRTN_STATE_RUNNING;
+  crtn_switch(old_ccb, ccb);
+
+  // For stackless coroutines, the local variables are clobbered here
+  // ==> Reload 'ccb'
+  CRTN_SET_WAIT_LOCK(crtn_current, 0);
+  ccb = crtn_current->waiting_on;
+
+  // If the call to crtn_wait() trigger the termination of the target
+  // coroutine or if it has been cancelled (it may already be freed)
+  if (!ccb) {
+
+    if (ret) {
+      *ret = 0;
     }
+
+    return CRTN_DEAD;
+  }
+
+  CRTN_LOCK(&(ccb->lock));
+
+  ccb->waiting = 0;
+  crtn_current->waiting_on = 0;
+
+  if (ret) {
+    *ret = ccb->yielded_data;
   }
 
-#endif // 0
+  assert(ccb->state == CRTN_STATE_READY);
+
+  // The stepper is armed again for the next wait
+  CRTN_ARM(ccb);
+
+#ifdef HAVE_CRTN_MT
+  // The stepper has been cancelled by another thread during the
+  // step: the step is complete and the cancellation is applied
+  // as if it were requested while the stepper was ready
+  if ((__atomic_load_n(&(ccb->flags), __ATOMIC_SEQ_CST) & CRTN_CCB_FLAG_CANCEL_PENDING) &&
+      CRTN_CLAIM(ccb)) {
+    crtn_make_runnable(&(ccb->link));
+  }
+#endif // HAVE_CRTN_MT
 
-  makecontext(&(ccb->ctx), (mkctx_func_t)crtn_entry, 0);
+  CRTN_UNLOCK(&(ccb->lock));
 
   return 0;
-} // crtn_spawn
+} // crtn_wait_internal
 
 
-crtn_attr_t crtn_attr_new(void)
+int crtn_wait(crtn_t cid, void **ret)
 {
-  crtn_ccb_attr_t *iattr;
+  return crtn_wait_internal(cid, 0, ret);
+} // crtn_wait
 
-  iattr = (crtn_ccb_attr_t *)malloc(sizeof(crtn_ccb_attr_t));
-  *iattr = crtn_default_attr;
-  return (crtn_attr_t)iattr;
 
-} // crtn_attr_new
+int crtn_gen_next(
+                  crtn_t   gen,
+                  void    *in,
+                  void   **out
+                 )
+{
+  return crtn_wait_internal(gen, &in, out);
+} // crtn_gen_next
 
 
-int crtn_attr_delete(
-                     crtn_attr_t attr
+void *crtn_gen_yield(
+                     const void *value,
+                     size_t      size
                     )
 {
-  if (!attr) {
-    crtn_set_errno(EINVAL);
-    return -1;
+  // The small values are copied into the inline buffer: they remain
+  // valid even if they are located in the (shared) stack
+  if (size && (size <= CRTN_GEN_VALUE_SZ)) {
+    memcpy(crtn_current->gen_value, value, size);
+    value = crtn_current->gen_value;
   }
 
-  free(attr);
-
-  return 0;
+  crtn_yield((void *)(uintptr_t)value);
 
-} // crtn_attr_delete
+  // For stackless coroutines, the local variables are clobbered here
+  return crtn_current->gen_in;
+} // crtn_gen_yield
 
 
-int crtn_set_attr_type(
-                       crtn_attr_t attr,
-                       unsigned int type
-                      )
+void *crtn_gen_input(void)
 {
-crtn_ccb_attr_t *iattr;
+  return crtn_current->gen_in;
+} // crtn_gen_input
 
-#define CRTN_TYPE_MASK 0x3
 
-  if (!attr ||
-      (type & ~CRTN_TYPE_MASK)) {
-    crtn_set_errno(EINVAL);
-    return -1;
-  }
+/*
+  Wake up a suspended coroutine disarmed by the caller (timer, canceller):
+  the wait is disabled and the coroutine is unlinked from the list of
+  the object it is waiting on (e.g. semaphore, mailbox)
+*/
+void crtn_wait_abort(crtn_ccb_t *ccb)
+{
+crtn_ccb_t *ccb1;
+#ifdef HAVE_CRTN_MT
+crtn_lock_t *wait_lock = CRTN_WAIT_LOCK(ccb);
 
-  iattr = (crtn_ccb_attr_t *)attr;
-  if (type & CRTN_TYPE_STACKLESS) {
-    iattr->type |= CRTN_TYPE_STACKLESS;
-    iattr->stack_size = 0;
-  } else {
-    assert(iattr->stack_size);
+  if (wait_lock) {
+    CRTN_LOCK(wait_lock);
   }
-
-  if (type & CRTN_TYPE_STEPPER) {
-    iattr->type |= CRTN_TYPE_STEPPER;
+#endif // HAVE_CRTN_MT
+
+  // The coroutine is waiting on a stepper or joining a coroutine
+  // (the latter may have been handed to another one in the meantime)
+  if (ccb->waiting_on) {
+    ccb1 = ccb->waiting_on;
+    if (ccb1->waiting == ccb) {
+      ccb1->waiting = 0;
+    }
+    ccb->waiting_on = 0;
+  } else if (ccb->joining_on) {
+    ccb1 = ccb->joining_on;
+    if (ccb1->joining == ccb) {
+      ccb1->joining = 0;
+    }
+    ccb->joining_on = 0;
   }
 
-  return 0;
-} // crtn_set_attr_type
+  // If it is not linked, the macro does not change the links
+  CRTN_LIST_DEL(&(ccb->link));
 
+#ifdef HAVE_CRTN_MT
+  if (wait_lock) {
+    CRTN_UNLOCK(wait_lock);
+  }
+#endif // HAVE_CRTN_MT
 
-int crtn_set_attr_stack_size(
-                       crtn_attr_t attr,
-                       size_t stack_size
-                      )
-{
-crtn_ccb_attr_t *iattr;
+  crtn_make_runnable(&(ccb->link));
 
-  if (!attr ||
-      (stack_size < crtn_stack_size)) {
-    crtn_set_errno(EINVAL);
-    return -1;
-  }
+} // crtn_wait_abort
 
-  iattr = (crtn_ccb_attr_t *)attr;
-  if (iattr->type & CRTN_TYPE_STACKLESS) {
-    crtn_set_errno(EINVAL);
-    return -1;
+
+/*
+  Change the context of a suspended coroutine to make it call the
+  termination routine
+*/
+static void crtn_cancel_ctx(crtn_ccb_t *ccb)
+{
+  CRTN_FLAG_SET(ccb, CRTN_CCB_FLAG_CANCELLED);
+
+  if (ccb->attr.type & CRTN_TYPE_COPYSTACK) {
+    // The stack frames of the coroutine are discarded and the
+    // termination context is made when it is scheduled
+    CRTN_FLAG_SET(ccb, CRTN_CCB_FLAG_NEWCTX);
+    ccb->copy_len = 0;
+    if (ccb == crtn_copystack_owner) {
+      crtn_copystack_owner = (crtn_ccb_t *)0;
+    }
+  } else if (ccb->attr.type & CRTN_TYPE_STACKLESS) {
+    // For stackless coroutines, we use the dedicated cancel stack otherwise
+    // the stack frame could be clobbered
+    crtn_ctx_make(&(ccb->ctx), ccb->cancel_stack, ccb->cancel_stack_size, crtn_cancelled);
+  } else {
+    crtn_ctx_make(&(ccb->ctx), ccb->stack, ccb->stack_size, crtn_cancelled);
   }
-  iattr->stack_size = stack_size;
 
-  return 0;
-} // crtn_set_attr_stack_size
+} // crtn_cancel_ctx
 
 
-void crtn_exit(int status)
+#ifdef HAVE_CRTN_MT
+/*
+  Apply the cancellation requested by crtn_cancel() to a coroutine
+  being resumed (cf. crtn_switch()): it is no longer linked to the
+  object it was waiting on but it may have been handed off some
+  resource that it did not consume yet
+*/
+static void crtn_cancel_apply(crtn_ccb_t *ccb)
 {
+crtn_lock_t *wait_lock = CRTN_WAIT_LOCK(ccb);
 
-  // Handle termination (cancellation, exit)
-  crtn_end(status);  
+  if (ccb->cancel_hook) {
+    if (wait_lock) {
+      CRTN_LOCK(wait_lock);
+    }
 
-} // crtn_exit
+    ccb->cancel_hook(ccb);
+    ccb->cancel_hook = 0;
 
+    if (wait_lock) {
+      CRTN_UNLOCK(wait_lock);
+    }
+  }
 
-int crtn_join(crtn_t cid, int *status)
-{
-crtn_ccb_t *ccb;
+  CRTN_SET_WAIT_LOCK(ccb, 0);
 
-  if (!CRTN_EXIST(cid)) {
-    crtn_set_errno(ENOENT);
-    return -1;
-  }
+  crtn_cancel_ctx(ccb);
 
-  if (cid == crtn_current->cid) {
-    crtn_set_errno(EINVAL);
-    return -1;
-  }
+  CRTN_FLAG_CLR(ccb, CRTN_CCB_FLAG_CANCEL_PENDING);
 
-  ccb = crtn_tab[cid];
+} // crtn_cancel_apply
 
-  if (ccb->joining) {
-    crtn_set_errno(EBUSY);
-    return -1;
+#else
+
+/*
+  Make a suspended coroutine run its termination routine
+*/
+static void crtn_cancel_ccb(crtn_ccb_t *ccb)
+{
+  // The target coroutine is blocked in a service (e.g. mailbox) or
+  // it has been handed off some resource that it did not consume yet
+  if (ccb->cancel_hook) {
+    ccb->cancel_hook(ccb);
+    ccb->cancel_hook = 0;
+
+    // The hook deferred the cancellation (e.g. I/O operation in
+    // progress): it is applied later by crtn_cancel_deferred()
+    if (ccb->flags & CRTN_CCB_FLAG_CANCEL_PENDING) {
+      return;
+    }
   }
 
   switch(ccb->state) {
 
-    case CRTN_STATE_ZOMBIE: {
-      ccb->joining = crtn_current;
-      crtn_current->joining_on = ccb;
+    case CRTN_STATE_WAITING: {
+
+      // The target coroutine is waiting on some resource
+      // ==> Disable the wait and put it in the runnable lists
+      crtn_wait_abort(ccb);
     }
     break;
 
-    case CRTN_STATE_RUNNABLE:
-    case CRTN_STATE_WAITING:
     case CRTN_STATE_READY: {
-
-      crtn_make_waiting(0, &(crtn_current->link));
-
-      ccb->joining = crtn_current;
-      crtn_current->joining_on = ccb;
-
-      // Give back the processor
-      crtn_yield(0);
+      // Put the target coroutine at the end of
+      // the runnable queue and change its state to runnable
+      crtn_make_runnable(&(ccb->link));
     }
     break;
 
     default: {
-
-      assert(0);
+      // The target coroutine is in runnable state
+      assert(ccb->state == CRTN_STATE_RUNNABLE);
     }
     break;
 
   } // End switch
 
-  // For stackless coroutines, the local variables are clobbered here
-  // ==> Reload 'ccb'
-  ccb = crtn_current->joining_on;
+  crtn_cancel_ctx(ccb);
 
-  if (status) {
-    *status = ccb->status;
-  }
+} // crtn_cancel_ccb
 
-  crtn_current->joining_on = 0;
-  ccb->joining = 0;
 
-  // Free the coroutine
-  crtn_free(ccb);
+/*
+  Apply a cancellation deferred by a cancel hook (e.g. the I/O
+  operation of the coroutine completed)
+*/
+void crtn_cancel_deferred(crtn_ccb_t *ccb)
+{
+  ccb->flags &= ~CRTN_CCB_FLAG_CANCEL_PENDING;
 
-  return 0;
-} // crtn_join
+  crtn_cancel_ccb(ccb);
 
+} // crtn_cancel_deferred
+#endif // HAVE_CRTN_MT
 
-int crtn_wait(crtn_t cid, void **ret)
+
+int crtn_cancel(crtn_t cid)
 {
-  crtn_ccb_t *ccb;
+crtn_ccb_t *ccb;
+#ifdef HAVE_CRTN_MT
+int         flags;
+#endif // HAVE_CRTN_MT
 
-  if (!CRTN_EXIST(cid)) {
-    crtn_set_errno(ENOENT);
+  ccb = crtn_tab_lookup(cid);
+  if (!ccb) {
     return -1;
   }
 
-  if (cid == crtn_current->cid) {
+  if (ccb == crtn_current) {
+    CRTN_TAB_UNLOCK();
     crtn_set_errno(EINVAL);
     return -1;
   }
 
-  ccb = crtn_tab[cid];
+  if (cid == CRTN_CID_MAIN) {
+    CRTN_TAB_UNLOCK();
+    crtn_set_errno(EPERM);
+    return -1;
+  }
 
-  if (!(ccb->attr.type & CRTN_TYPE_STEPPER)) {
+  if (CRTN_STATE_ZOMBIE == ccb->state) {
+    CRTN_TAB_UNLOCK();
     crtn_set_errno(EINVAL);
     return -1;
   }
 
-  if (ccb->state != CRTN_STATE_READY) {
-    crtn_set_errno(EPERM);
+#ifdef HAVE_CRTN_MT
+  // Only one canceller marks the coroutine
+  flags = __atomic_load_n(&(ccb->flags), __ATOMIC_SEQ_CST);
+  do {
+    if (flags & (CRTN_CCB_FLAG_CANCELLED | CRTN_CCB_FLAG_CANCEL_PENDING)) {
+      CRTN_TAB_UNLOCK();
+      crtn_set_errno(EBUSY);
+      return -1;
+    }
+  } while (!__atomic_compare_exchange_n(&(ccb->flags), &flags, flags | CRTN_CCB_FLAG_CANCEL_PENDING,
+                                        0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST));
+
+  // The coroutine is suspended: wake it up. Otherwise, it is running or
+  // runnable or some waker is making it runnable. In any case, the
+  // cancellation is applied when it is resumed (cf. crtn_switch())
+  if (CRTN_CLAIM(ccb)) {
+    crtn_wait_abort(ccb);
+  }
+#else
+  if (ccb->flags & (CRTN_CCB_FLAG_CANCELLED | CRTN_CCB_FLAG_CANCEL_PENDING)) {
+    crtn_set_errno(EBUSY);
     return -1;
   }
 
-  // As it is ready, no join/wait has been done on it
-  assert(!(ccb->joining || ccb->waiting));
+  crtn_cancel_ccb(ccb);
+#endif // HAVE_CRTN_MT
 
-  crtn_make_runnable(&(ccb->link));
+  CRTN_TAB_UNLOCK();
 
-  crtn_make_waiting(0, &(crtn_current->link));
+  return 0;
+} // crtn_cancel
 
-  ccb->waiting = crtn_current;
-  crtn_current->waiting_on = ccb;
 
-  // Give back the processor
-  crtn_yield(0);
+#ifdef HAVE_CRTN_MT
+/*
+  End of a context switch in the resumed context: the coroutine which
+  gave the processor has left its context. If it suspended itself while
+  a cancellation was requested, it is woken up to apply it.
+*/
+static void crtn_switch_finish(void)
+{
+  crtn_ccb_t *prev = *crtn_prev_ptr();
 
-  // For stackless coroutines, the local variables are clobbered here
-  // ==> Reload 'ccb'
-  ccb = crtn_current->waiting_on;
+  if (!prev) {
+    return;
+  }
 
-  ccb->waiting = 0;
-  crtn_current->waiting_on = 0;
+  *crtn_prev_ptr() = (crtn_ccb_t *)0;
 
-  if (ret) {
-    *ret = ccb->yielded_data;
+  if ((__atomic_load_n(&(prev->flags), __ATOMIC_SEQ_CST) & CRTN_CCB_FLAG_CANCEL_PENDING) &&
+      CRTN_CLAIM(prev)) {
+    crtn_wait_abort(prev);
   }
 
-  // If the call to crtn_wait() trigger the termination of the target
-  // coroutine or if it has been cancelled
-  if (ccb->state != CRTN_STATE_READY) {
+  // From now on, the coroutine may be resumed by another thread
+  __atomic_store_n(&(prev->on_cpu), 0, __ATOMIC_RELEASE);
 
-    assert(ccb->state == CRTN_STATE_ZOMBIE);
-    return CRTN_DEAD;
+} // crtn_switch_finish
 
-  }
 
-  return 0;
-} // crtn_wait
+static void crtn_mt_wakeup(void)
+{
+  CRTN_LOCK(&crtn_idle_lock);
+  pthread_cond_signal(&crtn_idle_cond);
+  CRTN_UNLOCK(&crtn_idle_lock);
+} // crtn_mt_wakeup
 
 
-int crtn_cancel(crtn_t cid)
+/*
+  Idle context of a thread: run the runnable coroutines or sleep until
+  some coroutines become runnable or the earliest timer expires
+*/
+static void crtn_worker_loop(void)
 {
-crtn_ccb_t *ccb, *ccb1;
+  crtn_ccb_t      *idle = crtn_current;
+  crtn_ccb_t      *next_ccb;
+  crtn_time_t      deadline;
+  struct timespec  ts;
 
-  if (!CRTN_EXIST(cid)) {
-    crtn_set_errno(ENOENT);
-    return -1;
-  }
+  crtn_switch_finish();
 
-  if (cid == crtn_current->cid) {
-    crtn_set_errno(EINVAL);
-    return -1;
-  }
+  for (;;) {
 
-  if (cid == CRTN_CID_MAIN) {
-    crtn_set_errno(EPERM);
-    return -1;
-  }
+    // Context switch diverted to the idle context (cf. crtn_switch())
+    next_ccb = *crtn_resume_ptr();
+    if (next_ccb) {
+      *crtn_resume_ptr() = (crtn_ccb_t *)0;
+    } else {
+      next_ccb = crtn_sched_next();
+    }
 
-  ccb = crtn_tab[cid];
+    if (next_ccb != idle) {
+      crtn_current = next_ccb;
+      crtn_switch(idle, next_ccb);
+      continue;
+    }
 
-  if (ccb->flags & CRTN_CCB_FLAG_CANCELLED) {
-    crtn_set_errno(EBUSY);
-    return -1;
+    // The wakers check the number of idle threads after queuing a
+    // coroutine: it is incremented before checking the run queues
+    CRTN_LOCK(&crtn_idle_lock);
+    __atomic_add_fetch(&crtn_idle_nb, 1, __ATOMIC_SEQ_CST);
+    if (!crtn_rq_pending()) {
+      deadline = crtn_timer_next();
+      if (CRTN_TIME_INFINITE == deadline) {
+        pthread_cond_wait(&crtn_idle_cond, &crtn_idle_lock);
+      } else {
+        ts.tv_sec = (time_t)(deadline / 1000000000LL);
+        ts.tv_nsec = (long)(deadline % 1000000000LL);
+        pthread_cond_timedwait(&crtn_idle_cond, &crtn_idle_lock, &ts);
+      }
+    }
+    __atomic_sub_fetch(&crtn_idle_nb, 1, __ATOMIC_SEQ_CST);
+    CRTN_UNLOCK(&crtn_idle_lock);
   }
 
-  switch(ccb->state) {
+} // crtn_worker_loop
 
-    case CRTN_STATE_ZOMBIE: {
-      crtn_set_errno(EINVAL);
-      return -1;
-    }
-    break;
 
-    case CRTN_STATE_WAITING: {
+static void crtn_fill_idle(crtn_ccb_t *ccb)
+{
+  crtn_fill_ccb(ccb, "Idle", 0, 0, 0, 0, 0);
+  ccb->cid = -1;
+  ccb->flags = CRTN_CCB_FLAG_STATIC;
+  ccb->state = CRTN_STATE_RUNNING;
+} // crtn_fill_idle
 
-      // The target coroutine is waiting on some resource
-      // ==> Disable the wait
-      if (ccb->waiting_on) {
-        ccb1 = ccb->waiting_on;
-        ccb1->waiting = 0;
-        ccb->waiting_on = 0;
-      } else if (ccb->joining_on) {
-        ccb1 = ccb->joining_on;
-        ccb1->joining = 0;
-        ccb->joining_on = 0;
-      }
 
-      // Unlink the coroutine from the list of the object
-      // it is waiting on (e.g. semaphore, mailbox)
-      // If it is not linked, the macro does not change the links
-      CRTN_LIST_DEL(&(ccb->link));
-    }
-    __CRTN_FALLTHROUGH
+static void crtn_worker_exit(void *arg)
+{
+  (void)arg;
 
-    case CRTN_STATE_READY: {
-      // Put the target coroutine at the end of
-      // the runnable queue and change its state to runnable
-      crtn_make_runnable(&(ccb->link));
-    }
-    break;
+  crtn_stack_altstack_free();
+} // crtn_worker_exit
 
-    default: {
-      // The target coroutine is in runnable state
-      assert(ccb->state == CRTN_STATE_RUNNABLE);
-    }
-    break;
 
-  } // End switch
+/*
+  Additional thread: the idle context runs on the stack of the thread
+*/
+static void *crtn_worker(void *arg)
+{
+  crtn_ccb_t idle;
 
-  ccb->flags |= CRTN_CCB_FLAG_CANCELLED;
+  // Run queue of the thread
+  *crtn_rq_ptr() = &(crtn_rqs[(uintptr_t)arg]);
 
-  // Change the context of the target coroutine to make it call the
-  // termination routine
-  if (ccb->attr.type & CRTN_TYPE_STACKLESS) {
-    // For stackless coroutines, we use the dedicated cancel stack otherwise
-    // the stack frame could be clobbered
-    ccb->ctx.uc_stack.ss_sp = ccb->cancel_stack;
-    ccb->ctx.uc_stack.ss_size = ccb->cancel_stack_size;
-    ccb->ctx.uc_stack.ss_flags = 0;
+  crtn_fill_idle(&idle);
+  idle.on_cpu = 1;
+  crtn_current = &idle;
+  *crtn_idle_ptr() = &idle;
 
-    makecontext(&(ccb->ctx), (mkctx_func_t)crtn_end, 1, CRTN_STATUS_CANCELLED);
-  } else {
-    makecontext(&(ccb->ctx), (mkctx_func_t)crtn_end, 1, CRTN_STATUS_CANCELLED);
+  // The overflows of the guard pages are reported on an alternate
+  // signal stack which is per thread (a failure only prevents the
+  // report)
+  (void)crtn_stack_altstack_install();
+
+  pthread_cleanup_push(crtn_worker_exit, 0);
+
+  crtn_worker_loop();
+
+  pthread_cleanup_pop(1);
+
+  return NULL;
+} // crtn_worker
+
+
+/*
+  Start the additional threads (the table of coroutines is locked)
+  Return 0 or an errno value
+*/
+static int crtn_mt_start(void)
+{
+  pthread_t tid;
+  int       rc;
+
+  // The calling thread runs coroutines as well (cf. crtn_worker())
+  (void)crtn_stack_altstack_install();
+
+  while (crtn_workers_nb < crtn_workers) {
+    rc = pthread_create(&tid, 0, crtn_worker, (void *)(uintptr_t)crtn_workers_nb);
+    if (rc) {
+      return rc;
+    }
+    pthread_detach(tid);
+    crtn_workers_nb ++;
   }
 
   return 0;
-} // crtn_cancel
+} // crtn_mt_start
+#endif // HAVE_CRTN_MT
 
 
 
-void crtn_get_size_env(
-                       const char *name,
-                       size_t *value,
-                       size_t default_value
-                      )
+/*
+  Read a numeric environment variable which must not be lower
+  than "min_value"
+*/
+static void crtn_get_env(
+                         const char *name,
+                         size_t     *value,
+                         size_t      default_value,
+                         long        min_value
+                        )
 {
   char *env;
+  long  v;
 
   env = getenv(name);
   if (env) {
     errno = 0;
-    *value = (size_t)strtol(env, NULL, 10);
-    if (0 != errno || (0 == *value)) {
+    v = strtol(env, NULL, 10);
+    if (0 != errno || (v < min_value)) {
       fprintf(stderr, "Bad value '%s' for variable '%s', error '%m' (%d)\n", env, name, errno);
       *value = default_value;
+    } else {
+      *value = (size_t)v;
     }
   } else {
     *value = default_value;
   }
+} // crtn_get_env
+
+
+void crtn_get_size_env(
+                       const char *name,
+                       size_t *value,
+                       size_t default_value
+                      )
+{
+  crtn_get_env(name, value, default_value, 1);
 } // crtn_get_size_env
 
 
+/*
+  Same as crtn_get_size_env() but 0 is a valid value
+*/
+void crtn_get_count_env(
+                        const char *name,
+                        size_t *value,
+                        size_t default_value
+                       )
+{
+  crtn_get_env(name, value, default_value, 0);
+} // crtn_get_count_env
+
+
 
 void __attribute__ ((constructor)) crtn_lib_init(void);
 
 void crtn_lib_init(void)
 {
-  crtn_ccb_t *ccb;
+  crtn_ccb_t   *ccb;
+  crtn_rq_t    *rq;
+  int           rc;
+  unsigned int  i;
+  size_t        j;
+#ifdef HAVE_CRTN_MT
+  long               nb_cpus;
+  pthread_condattr_t cond_attr;
+  char              *p;
+#endif // HAVE_CRTN_MT
 
   // Get the environment variables
   crtn_get_size_env("CRTN_MAX", &crtn_max, CRTN_MAX);
   crtn_get_size_env("CRTN_STACK_SIZE", &crtn_stack_size, CRTN_DEFAULT_STACK_SIZE);
   crtn_default_attr.stack_size = crtn_stack_size;
 
-  // Allocate the table of coroutines
-  crtn_tab = (crtn_ccb_t **)malloc(crtn_max * sizeof(crtn_ccb_t *));
-  if (!crtn_tab) {
-    fprintf(stderr, "malloc(%zu): %m (%d)\n", crtn_max * sizeof(crtn_ccb_t *), errno);
+#ifdef HAVE_CRTN_MT
+  // One thread per processor by default
+  nb_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  crtn_get_size_env("CRTN_WORKERS", &crtn_workers, (nb_cpus > 0 ? (size_t)nb_cpus : 1));
+
+  // One run queue per thread
+  crtn_rqs = (crtn_rq_t *)calloc(crtn_workers, sizeof(crtn_rq_t));
+  if (!crtn_rqs) {
+    fprintf(stderr, "calloc(%zu): %m (%d)\n", crtn_workers * sizeof(crtn_rq_t), errno);
+    return;
+  }
+  for (j = 0; j < crtn_workers; j ++) {
+    CRTN_LOCK_INIT(&(crtn_rqs[j].lock));
+  }
+
+  // The main thread runs the coroutines queued into the first run queue
+  *crtn_rq_ptr() = &(crtn_rqs[0]);
+
+  // The deadlines of the timers are based on the monotonic clock
+  pthread_condattr_init(&cond_attr);
+  pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&crtn_idle_cond, &cond_attr);
+  pthread_condattr_destroy(&cond_attr);
+
+  // Idle context of the main thread (the CCB is at the bottom of its stack)
+  crtn_idle_stack = (char *)malloc(CRTN_IDLE_STACK_SIZE);
+  if (!crtn_idle_stack) {
+    fprintf(stderr, "malloc(%d): %m (%d)\n", CRTN_IDLE_STACK_SIZE, errno);
+    return;
+  }
+  p = crtn_idle_stack + CRTN_IDLE_STACK_SIZE - sizeof(crtn_ccb_t);
+  p = (char *)((unsigned long)p & ~(__alignof__(crtn_ccb_t) - 1));
+  ccb = (crtn_ccb_t *)p;
+  crtn_fill_idle(ccb);
+  crtn_ctx_make(&(ccb->ctx), crtn_idle_stack, (size_t)(p - crtn_idle_stack), crtn_worker_loop);
+  *crtn_idle_ptr() = ccb;
+#endif // HAVE_CRTN_MT
+
+  crtn_lib_stack_init();
+  crtn_lib_timer_init();
+
+  // Allocate the first segment of the table of coroutines
+  rc = crtn_tab_grow();
+  if (rc) {
+    errno = rc;
+    fprintf(stderr, "malloc(%zu): %m (%d)\n", CRTN_TAB_SEG0_SZ * sizeof(struct crtn_slot_t), errno);
     return;
   }
 
-  // Initialize the list
-  CRTN_LIST_INIT(&crtn_runnable_list);
+  // Initialize the run queues
+#ifdef HAVE_CRTN_MT
+  for (j = 0; j < crtn_workers; j ++) {
+#else
+  for (j = 0; j < 1; j ++) {
+#endif // HAVE_CRTN_MT
+    rq = &(crtn_rqs[j]);
+    for (i = 0; i < CRTN_PRIO_NB; i ++) {
+      CRTN_LIST_INIT(&(rq->list[i]));
+    }
+    rq->map = 0;
+  }
 
   // Initialize the optional services
 #ifdef HAVE_CRTN_MBX
@@ -926,17 +2735,22 @@ void crtn_lib_init(void)
   crtn_lib_sem_init();
 #endif // HAVE_CRTN_SEM
 
+#ifdef HAVE_CRTN_IO
+  crtn_lib_io_init();
+#endif // HAVE_CRTN_IO
+
   // Make the CCB of the main thread, no entry point
   ccb = crtn_current = &crtn_ccb_main;
   ccb->cid = crtn_get_id(ccb);
   assert(ccb->cid == CRTN_CID_MAIN);
   crtn_fill_ccb(ccb, "Main", 0, 0, 0, 0, 0);
 
-  // Put the MAIN coroutine in the runnable list
-  crtn_make_runnable(&(ccb->link));
-
-  // Main is the first running coroutine
+  // Main is the first running coroutine (the running
+  // coroutines are not linked in the runnable lists)
   ccb->state = CRTN_STATE_RUNNING;
+#ifdef HAVE_CRTN_MT
+  ccb->on_cpu = 1;
+#endif // HAVE_CRTN_MT
 } // crtn_lib_init
 
 
@@ -945,6 +2759,19 @@ void __attribute__ ((destructor)) crtn_lib_exit(void);
 
 void crtn_lib_exit(void)
 {
+  size_t j;
+
+#ifdef HAVE_CRTN_MT
+  // The other threads may still run coroutines: the
+  // memory is given back upon the end of the process
+  if (crtn_workers_nb > 1) {
+    return;
+  }
+
+  free(crtn_idle_stack);
+  crtn_idle_stack = 0;
+#endif // HAVE_CRTN_MT
+
   // Stop all the coroutines
 
   // Free the CCBs
@@ -959,13 +2786,49 @@ void crtn_lib_exit(void)
   crtn_lib_sem_exit();
 #endif // HAVE_CRTN_SEM
 
+#ifdef HAVE_CRTN_IO
+  crtn_lib_io_exit();
+#endif // HAVE_CRTN_IO
+
   // Free the stack of the stackless coroutines
   if (crtn_stackless) {
     free(crtn_stackless);
     crtn_stackless = 0;
   }
 
+  // Free the stacks of the copy-stack coroutines
+  if (crtn_copystack) {
+    free(crtn_copystack);
+    free(crtn_copystack_helper_stack);
+    crtn_copystack = crtn_copystack_helper_stack = 0;
+  }
+
+  // Free the heaps of the deadline scheduling class
+#ifdef HAVE_CRTN_MT
+  for (j = 0; j < crtn_workers; j ++) {
+#else
+  for (j = 0; j < 1; j ++) {
+#endif // HAVE_CRTN_MT
+    free(crtn_rqs[j].edf_heap);
+    crtn_rqs[j].edf_heap = 0;
+    crtn_rqs[j].edf_nb = 0;
+  }
+  crtn_edf_users = crtn_edf_sz = 0;
+
+#ifdef HAVE_CRTN_MT
+  free(crtn_rqs);
+  crtn_rqs = 0;
+#endif // HAVE_CRTN_MT
+
+  // Free the cached stacks
+  crtn_lib_stack_exit();
+
   // Free the table of coroutines
-  free(crtn_tab);
+  while (crtn_tab_segs > 0) {
+    crtn_tab_segs --;
+    free(crtn_tab[crtn_tab_segs]);
+    crtn_tab[crtn_tab_segs] = 0;
+  }
+  crtn_tab_sz = 0;
 
 } // crtn_lib_exit
@@ -32,17 +32,69 @@
 #define CRTN_CCB_H
 
 #include <stddef.h>
-#include <ucontext.h>
+#include <signal.h>
+#ifdef HAVE_CRTN_MT
+#include <pthread.h>
+#endif // HAVE_CRTN_MT
 
 #include "crtn.h"
 #include "crtn_list.h"
+#include "crtn_ctx.h"
+
 
 
 /*
-  Entry point for makecontext()
+  Locks of the multithreaded mode (no-ops otherwise)
+
+  There is no scheduler lock and no lock is held across a context
+  switch:
+  . Each thread has its own run queue protected by its lock (cf.
+    crtn.c). The idle threads steal the coroutines queued into the
+    other run queues;
+  . The objects (mailboxes, semaphores, coroutines joined or waited
+    on) have their own lock protecting their data and their list of
+    waiting coroutines;
+  . The timers are protected by the lock of the timer wheel.
+  The locks are taken in this order: table of coroutines, object,
+  timer wheel, run queue.
+
+  A suspended coroutine is armed. The first of its wakers (poster,
+  timer, canceller...) which disarms it (CRTN_CLAIM()) unlinks it from
+  the object it is waiting on and makes it runnable. The others leave
+  it alone.
 */
-typedef void (* mkctx_func_t)(void);
+#ifdef HAVE_CRTN_MT
+
+typedef pthread_mutex_t crtn_lock_t;
+
+#define CRTN_LOCK_INIT(l) pthread_mutex_init((l), 0)
+#define CRTN_LOCK(l)      pthread_mutex_lock(l)
+#define CRTN_UNLOCK(l)    pthread_mutex_unlock(l)
+
+#define CRTN_ARM(ccb)   __atomic_store_n(&((ccb)->armed), 1, __ATOMIC_SEQ_CST)
+#define CRTN_CLAIM(ccb) __atomic_exchange_n(&((ccb)->armed), 0, __ATOMIC_SEQ_CST)
+
+// Lock of the object the coroutine is blocked on (NULL if none)
+#define CRTN_WAIT_LOCK(ccb)        ((ccb)->wait_lock)
+#define CRTN_SET_WAIT_LOCK(ccb, l) (ccb)->wait_lock = (l)
 
+// The flags of a coroutine may be updated by other threads
+#define CRTN_FLAG_SET(ccb, f) (void)__atomic_fetch_or(&((ccb)->flags), (f), __ATOMIC_SEQ_CST)
+#define CRTN_FLAG_CLR(ccb, f) (void)__atomic_fetch_and(&((ccb)->flags), ~(f), __ATOMIC_SEQ_CST)
+
+#else
+
+#define CRTN_LOCK_INIT(l)          do {} while(0)
+#define CRTN_LOCK(l)               do {} while(0)
+#define CRTN_UNLOCK(l)             do {} while(0)
+#define CRTN_ARM(ccb)              do {} while(0)
+#define CRTN_CLAIM(ccb)            1
+#define CRTN_WAIT_LOCK(ccb)        ((void *)0)
+#define CRTN_SET_WAIT_LOCK(ccb, l) do {} while(0)
+#define CRTN_FLAG_SET(ccb, f)      (ccb)->flags |= (f)
+#define CRTN_FLAG_CLR(ccb, f)      (ccb)->flags &= ~(f)
+
+#endif // HAVE_CRTN_MT
 
 
 /*
@@ -50,22 +102,61 @@ typedef void (* mkctx_func_t)(void);
 */
 typedef struct
 {
+  //
+  // The fields read upon each context switch come first as they
+  // end the first cache line of the CCB
+  //
+
   unsigned int type;
 
+  // Save/restore the signal mask upon context switches
+  int sigmask;
+
+  // Scheduling priority (CRTN_PRIO_HIGHEST to CRTN_PRIO_LOWEST)
+  unsigned int prio;
+
+  // Allocation mode of the stack (CRTN_STACK_xxx)
+  unsigned int stack_mode;
+
   size_t stack_size;
 
 } crtn_ccb_attr_t;
 
 
+/*
+  Size of a cache line
+*/
+#define CRTN_CACHE_LINE_SZ 64
+
+
 /*
            CCB
 
   Coroutine Control Block
 
+  The fields accessed by the scheduler upon each context switch
+  (list walks, state changes, timer and deadline checks) fill the
+  first cache line. The saved context follows: the stack pointer is
+  the only other data read to switch to a coroutine. The fields used
+  by the blocking services, at creation/termination time or by the
+  less frequent services are pushed at the end (the name...).
+
 */
 typedef struct crtn_ccb
 {
-  int cid;
+  //
+  // Hot fields (first cache line)
+  //
+
+  // Link into the current list
+  crtn_link_t link __attribute__((aligned(CRTN_CACHE_LINE_SZ)));
+
+  // Link into the list of timers (the timer is stopped when the
+  // coroutine is made runnable)
+  crtn_link_t tlink;
+
+  // Deadline of the deadline scheduling class (-1 if none)
+  crtn_time_t edf_deadline;
 
   int state;
 #define CRTN_STATE_ALLOCATED  0
@@ -75,25 +166,35 @@ typedef struct crtn_ccb
 #define CRTN_STATE_WAITING    4
 #define CRTN_STATE_ZOMBIE     5
 
+  int flags;
+#define CRTN_CCB_FLAG_STATIC     0x1
+#define CRTN_CCB_FLAG_CANCELLED  0x2
+#define CRTN_CCB_FLAG_NEWCTX     0x4  // Context to make on the shared stack
+#define CRTN_CCB_FLAG_TIMEDOUT   0x8  // The timeout of the last blocking call elapsed
+#define CRTN_CCB_FLAG_CANCEL_PENDING 0x10 // Cancel deferred (running on another thread, I/O in progress)
+
+  // Type, signal mask flag and priority end the cache line (the
+  // stack allocation fields overflow on the next one)
   crtn_ccb_attr_t  attr;
 
-  // Entry point (function, parameter and return code)
-  crtn_entry_t  entry;
-  void         *param;
-  int           status;
+  // Saved execution context
+  crtn_ctx_t ctx;
 
-  char *stack;
-  char *cancel_stack; // For stackless coroutines
-  size_t cancel_stack_size;
+  //
+  // Warm fields (blocking services)
+  //
 
-  // Saved registers and signal mask
-  ucontext_t ctx;
+  // Index in the heap of the deadline scheduling class (-1 if not in
+  // the heap). It is meaningful only if there is a deadline.
+  int edf_idx;
 
   // Error on last library/system call
   int err_num;
 
-  // Link into the current list
-  crtn_link_t link;
+  crtn_t cid;
+
+  // Deadline of the blocking call
+  crtn_time_t deadline;
 
   // Joining corouting
   struct crtn_ccb *joining;
@@ -105,20 +206,105 @@ typedef struct crtn_ccb
 
   void *yielded_data;
 
-  char name[CRTN_NAME_SZ];
+  // Data passed by the last crtn_yield_to() to this coroutine
+  void *yield_data;
 
-  int flags;
-#define CRTN_CCB_FLAG_STATIC     0x1
-#define CRTN_CCB_FLAG_CANCELLED  0x2
+  // Object (mailbox, semaphore...) the coroutine is blocked on, data
+  // handed off by the waker and hook called if the coroutine is
+  // cancelled before getting back the processor
+  void *wait_obj;
+  void *handoff;
+  void (* cancel_hook)(struct crtn_ccb *ccb);
+
+  // File descriptor the coroutine is waiting on and received events
+  int io_fd;
+  unsigned int io_events;
+
+  // Result of the last I/O operation
+  int io_res;
+
+  // Value received from crtn_gen_next() and inline buffer of the
+  // values passed to crtn_gen_yield()
+  void *gen_in;
+  char gen_value[CRTN_GEN_VALUE_SZ] __attribute__((aligned(16)));
+
+  // Copy of the used part of the shared stack (copy-stack coroutines)
+  char *copy;
+  size_t copy_size;
+  size_t copy_len;
+
+#ifdef HAVE_CRTN_MT
+  // Run queue of the last thread which ran the coroutine: it is queued
+  // into it when it is made runnable. It changes only with the run
+  // queue locked.
+  struct crtn_rq *rq;
+
+  // Lock of the object the coroutine is blocked on and lock of the
+  // coroutines joining or waiting on this one
+  crtn_lock_t *wait_lock;
+  crtn_lock_t  lock;
+
+  // Set while a thread runs on the context of the coroutine
+  int on_cpu;
+
+  // Set while the coroutine is suspended and can be woken up (cf. CRTN_CLAIM())
+  int armed;
+#endif // HAVE_CRTN_MT
+
+  //
+  // Cold fields
+  //
+
+  // Entry point (function, parameter and return code)
+  crtn_entry_t  entry;
+  void         *param;
+  int           status;
+
+  char *stack;
+  size_t stack_size;
+  char *cancel_stack; // For stackless coroutines
+  size_t cancel_stack_size;
+  size_t alloc_size; // Size of the area holding the CCB (stack or cancel stack)
+
+  // Saved signal mask (if attr.sigmask is set)
+  sigset_t sigmask;
+
+  char name[CRTN_NAME_SZ];
 } crtn_ccb_t;
 
 
 
+_Static_assert(offsetof(crtn_ccb_t, attr.prio) + sizeof(unsigned int) <= CRTN_CACHE_LINE_SZ,
+               "The fields read upon each context switch must fit in the first cache line of the CCB");
+
 #define CRTN_LINK2CCB(l) ((crtn_ccb_t *)((char *)(l) - offsetof(crtn_ccb_t, link)))
 
 
+#ifdef HAVE_CRTN_MT
+
+// Running CCB of the calling thread. The accessors are not inlined
+// (cf. crtn_mt.c).
+extern crtn_ccb_t **crtn_current_ptr(void);
+#define crtn_current (*crtn_current_ptr())
+
+// Idle context of the calling thread
+extern crtn_ccb_t **crtn_idle_ptr(void);
+
+// Run queue of the calling thread
+extern struct crtn_rq **crtn_rq_ptr(void);
+
+// Coroutine giving the processor in the ongoing context switch
+extern crtn_ccb_t **crtn_prev_ptr(void);
+
+// Coroutine to resume from the idle context of the calling thread
+extern crtn_ccb_t **crtn_resume_ptr(void);
+
+#else
+
 extern crtn_ccb_t *crtn_current;
 
+#endif // HAVE_CRTN_MT
+
 #define crtn_set_errno(e) crtn_current->err_num = e
 
 extern void crtn_make_runnable(crtn_link_t *link);
@@ -128,10 +314,22 @@ extern void crtn_make_waiting(
                            crtn_link_t *link
                           );
 
+extern void crtn_suspend(void);
+
+extern void crtn_wait_abort(crtn_ccb_t *ccb);
+
+extern void crtn_cancel_deferred(crtn_ccb_t *ccb);
+
 extern void crtn_get_size_env(
                        const char *name,
                        size_t *value,
                        size_t default_value
                        );
 
+extern void crtn_get_count_env(
+                       const char *name,
+                       size_t *value,
+                       size_t default_value
+                       );
+
 #endif // CRTN_CCB_H
@@ -0,0 +1,280 @@
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+// File        : crtn_ctx.c
+// Description : Execution context switch
+// License     :
+//
+//  Copyright (C) 2021 Rachid Koucha <rachid dot koucha at gmail dot com>
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2.1 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to:
+//  the Free Software Foundation, Inc.,
+//  51 Franklin Street, Fifth Floor,
+//  Boston, MA  02110-1301  USA
+//
+// Evolutions  :
+//
+//     17-Oct-2026 agent          - Creation
+//
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+#define _GNU_SOURCE  // For REG_RSP
+#include "../config.h"
+#include <string.h>
+
+#include "crtn_ctx.h"
+
+
+#ifdef HAVE_CRTN_ASM_CTX
+
+#if defined(__x86_64__)
+
+/*
+  Frame of a suspended context (from the saved stack pointer):
+
+     [0]  MXCSR (4 bytes) + x87 control word (2 bytes)
+     [1]  r15
+     [2]  r14
+     [3]  r13
+     [4]  r12
+     [5]  rbx
+     [6]  rbp
+     [7]  Return address
+
+  This is what the System V ABI requires to be preserved across a
+  function call. The caller-saved registers are already saved by the
+  compiler around the call to crtn_ctx_swap().
+
+  A brand new context "returns" into crtn_ctx_start() which moves
+  to the top of the stack (r13) and calls the entry point (r12).
+*/
+__asm__(
+  ".text\n"
+  ".globl crtn_ctx_swap\n"
+  ".hidden crtn_ctx_swap\n"
+  ".type crtn_ctx_swap, @function\n"
+  ".p2align 4\n"
+  "crtn_ctx_swap:\n"
+  "  pushq %rbp\n"
+  "  pushq %rbx\n"
+  "  pushq %r12\n"
+  "  pushq %r13\n"
+  "  pushq %r14\n"
+  "  pushq %r15\n"
+  "  subq $8, %rsp\n"
+  "  stmxcsr (%rsp)\n"
+  "  fnstcw 4(%rsp)\n"
+  "  movq %rsp, (%rdi)\n"
+  "  movq (%rsi), %rsp\n"
+  "  ldmxcsr (%rsp)\n"
+  "  fldcw 4(%rsp)\n"
+  "  addq $8, %rsp\n"
+  "  popq %r15\n"
+  "  popq %r14\n"
+  "  popq %r13\n"
+  "  popq %r12\n"
+  "  popq %rbx\n"
+  "  popq %rbp\n"
+  "  ret\n"
+  ".size crtn_ctx_swap, .-crtn_ctx_swap\n"
+  "\n"
+  ".globl crtn_ctx_start\n"
+  ".hidden crtn_ctx_start\n"
+  ".type crtn_ctx_start, @function\n"
+  ".p2align 4\n"
+  "crtn_ctx_start:\n"
+  "  movq %r13, %rsp\n"
+  "  xorl %ebp, %ebp\n"
+  "  callq *%r12\n"
+  "  ud2\n"
+  ".size crtn_ctx_start, .-crtn_ctx_start\n"
+);
+
+extern void crtn_ctx_start(void);
+
+
+void crtn_ctx_make(
+                   crtn_ctx_t   *ctx,
+                   char         *stack,
+                   size_t        stack_size,
+                   mkctx_func_t  func
+                  )
+{
+  unsigned long *frame = ctx->frame;
+  unsigned int mxcsr;
+  unsigned short fpucw;
+
+  memset(frame, 0, sizeof(ctx->frame));
+
+  // The floating point control words are inherited from the caller
+  __asm__ __volatile__ ("stmxcsr %0" : "=m" (mxcsr));
+  __asm__ __volatile__ ("fnstcw %0" : "=m" (fpucw));
+  memcpy(&(frame[0]), &mxcsr, sizeof(mxcsr));
+  memcpy((char *)&(frame[0]) + sizeof(mxcsr), &fpucw, sizeof(fpucw));
+
+  // r13: top of the stack aligned on 16 bytes
+  frame[3] = (unsigned long)(stack + stack_size) & ~15UL;
+
+  // r12: entry point
+  frame[4] = (unsigned long)func;
+
+  // Return address
+  frame[7] = (unsigned long)crtn_ctx_start;
+
+  ctx->sp = frame;
+
+} // crtn_ctx_make
+
+#elif defined(__aarch64__)
+
+/*
+  Frame of a suspended context (from the saved stack pointer):
+
+     [0-11]  x19-x30 (x29 is the frame pointer, x30 the return address)
+     [12-19] d8-d15
+     [20]    FPCR
+     [21]    Padding (the stack pointer must be aligned on 16 bytes)
+
+  This is what the AAPCS64 requires to be preserved across a
+  function call.
+
+  A brand new context "returns" into crtn_ctx_start() which moves
+  to the top of the stack (x20) and calls the entry point (x19).
+*/
+__asm__(
+  ".text\n"
+  ".globl crtn_ctx_swap\n"
+  ".hidden crtn_ctx_swap\n"
+  ".type crtn_ctx_swap, %function\n"
+  ".p2align 4\n"
+  "crtn_ctx_swap:\n"
+  "  sub sp, sp, #176\n"
+  "  stp x19, x20, [sp, #0]\n"
+  "  stp x21, x22, [sp, #16]\n"
+  "  stp x23, x24, [sp, #32]\n"
+  "  stp x25, x26, [sp, #48]\n"
+  "  stp x27, x28, [sp, #64]\n"
+  "  stp x29, x30, [sp, #80]\n"
+  "  stp d8, d9, [sp, #96]\n"
+  "  stp d10, d11, [sp, #112]\n"
+  "  stp d12, d13, [sp, #128]\n"
+  "  stp d14, d15, [sp, #144]\n"
+  "  mrs x9, fpcr\n"
+  "  str x9, [sp, #160]\n"
+  "  mov x9, sp\n"
+  "  str x9, [x0]\n"
+  "  ldr x9, [x1]\n"
+  "  mov sp, x9\n"
+  "  ldp x19, x20, [sp, #0]\n"
+  "  ldp x21, x22, [sp, #16]\n"
+  "  ldp x23, x24, [sp, #32]\n"
+  "  ldp x25, x26, [sp, #48]\n"
+  "  ldp x27, x28, [sp, #64]\n"
+  "  ldp x29, x30, [sp, #80]\n"
+  "  ldp d8, d9, [sp, #96]\n"
+  "  ldp d10, d11, [sp, #112]\n"
+  "  ldp d12, d13, [sp, #128]\n"
+  "  ldp d14, d15, [sp, #144]\n"
+  "  ldr x9, [sp, #160]\n"
+  "  msr fpcr, x9\n"
+  "  add sp, sp, #176\n"
+  "  ret\n"
+  ".size crtn_ctx_swap, .-crtn_ctx_swap\n"
+  "\n"
+  ".globl crtn_ctx_start\n"
+  ".hidden crtn_ctx_start\n"
+  ".type crtn_ctx_start, %function\n"
+  ".p2align 4\n"
+  "crtn_ctx_start:\n"
+  "  mov sp, x20\n"
+  "  mov x29, #0\n"
+  "  blr x19\n"
+  "  brk #0\n"
+  ".size crtn_ctx_start, .-crtn_ctx_start\n"
+);
+
+extern void crtn_ctx_start(void);
+
+
+void crtn_ctx_make(
+                   crtn_ctx_t   *ctx,
+                   char         *stack,
+                   size_t        stack_size,
+                   mkctx_func_t  func
+                  )
+{
+  unsigned long *frame = ctx->frame;
+  unsigned long fpcr;
+
+  memset(frame, 0, sizeof(ctx->frame));
+
+  // x19: entry point
+  frame[0] = (unsigned long)func;
+
+  // x20: top of the stack aligned on 16 bytes
+  frame[1] = (unsigned long)(stack + stack_size) & ~15UL;
+
+  // x30: return address
+  frame[11] = (unsigned long)crtn_ctx_start;
+
+  // The floating point control register is inherited from the caller
+  __asm__ __volatile__ ("mrs %0, fpcr" : "=r" (fpcr));
+  frame[20] = fpcr;
+
+  ctx->sp = frame;
+
+} // crtn_ctx_make
+
+#endif // __x86_64__ / __aarch64__
+
+
+char *crtn_ctx_sp(crtn_ctx_t *ctx)
+{
+  return (char *)(ctx->sp);
+} // crtn_ctx_sp
+
+#else
+
+void crtn_ctx_make(
+                   crtn_ctx_t   *ctx,
+                   char         *stack,
+                   size_t        stack_size,
+                   mkctx_func_t  func
+                  )
+{
+  // On x86_64 machines, getcontext() may fail only if the rt_sigprocmask() fails
+  getcontext(ctx);
+
+  ctx->uc_stack.ss_sp = stack;
+  ctx->uc_stack.ss_size = stack_size;
+  ctx->uc_stack.ss_flags = 0;
+  ctx->uc_link = 0;
+
+  makecontext(ctx, func, 0);
+
+} // crtn_ctx_make
+
+
+char *crtn_ctx_sp(crtn_ctx_t *ctx)
+{
+#if defined(__x86_64__)
+  return (char *)(ctx->uc_mcontext.gregs[REG_RSP]);
+#elif defined(__aarch64__)
+  return (char *)(ctx->uc_mcontext.sp);
+#else
+  // Unknown
+  (void)ctx;
+  return (char *)0;
+#endif
+} // crtn_ctx_sp
+
+#endif // HAVE_CRTN_ASM_CTX
@@ -0,0 +1,98 @@
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+// File        : crtn_ctx.h
+// Description : Execution context switch
+// License     :
+//
+//  Copyright (C) 2021 Rachid Koucha <rachid dot koucha at gmail dot com>
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2.1 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to:
+//  the Free Software Foundation, Inc.,
+//  51 Franklin Street, Fifth Floor,
+//  Boston, MA  02110-1301  USA
+//
+//
+// Evolutions  :
+//
+//     17-Oct-2026 agent          - Creation
+//
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+#ifndef CRTN_CTX_H
+#define CRTN_CTX_H
+
+#include <stddef.h>
+
+
+/*
+  Entry point of a context
+*/
+typedef void (* mkctx_func_t)(void);
+
+
+#ifdef HAVE_CRTN_ASM_CTX
+
+#if defined(__x86_64__)
+#define CRTN_CTX_FRAME_SZ 8
+#elif defined(__aarch64__)
+#define CRTN_CTX_FRAME_SZ 22
+#else
+#error "HAVE_CRTN_ASM_CTX is not supported on this architecture"
+#endif
+
+/*
+  Saved execution context
+
+  The callee-saved registers are pushed on the stack of the
+  suspended coroutine. Only the resulting stack pointer is
+  stored here. The signal mask is not saved.
+
+  The first frame of a brand new context is not located on its
+  stack but in "frame[]": the stack may be shared with other
+  coroutines (stackless coroutines) which are not finished.
+*/
+typedef struct
+{
+  void *sp;
+  unsigned long frame[CRTN_CTX_FRAME_SZ];
+} crtn_ctx_t;
+
+extern void crtn_ctx_swap(
+                          crtn_ctx_t *from,
+                          crtn_ctx_t *to
+                         );
+
+#else
+
+#include <ucontext.h>
+
+/*
+  Saved execution context (registers and signal mask)
+*/
+typedef ucontext_t crtn_ctx_t;
+
+#define crtn_ctx_swap(from, to) swapcontext((from), (to))
+
+#endif // HAVE_CRTN_ASM_CTX
+
+
+extern void crtn_ctx_make(
+                          crtn_ctx_t   *ctx,
+                          char         *stack,
+                          size_t        stack_size,
+                          mkctx_func_t  func
+                         );
+
+extern char *crtn_ctx_sp(crtn_ctx_t *ctx);
+
+#endif // CRTN_CTX_H
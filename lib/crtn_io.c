@@ -0,0 +1,807 @@
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+// File        : crtn_io.c
+// Description : I/O reactor (file descriptors events)
+// License     :
+//
+//  Copyright (C) 2021 Rachid Koucha <rachid dot koucha at gmail dot com>
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2.1 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to:
+//  the Free Software Foundation, Inc.,
+//  51 Franklin Street, Fifth Floor,
+//  Boston, MA  02110-1301  USA
+//
+//
+// Evolutions  :
+//
+//     17-Oct-2026 agent          - Creation
+//
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+#include "../config.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#include "crtn.h"
+#include "crtn_list.h"
+#include "crtn_ccb.h"
+#include "crtn_timer.h"
+#include "crtn_io.h"
+
+
+/*
+  The coroutines blocked on file descriptors are registered in an
+  epoll instance (created upon the first wait). The reactor is polled
+  when there are no more runnable coroutines (the process blocks in
+  epoll_wait() until the next timer expiration) and, without blocking,
+  every CRTN_IO_POLL_PERIOD scheduling operations to avoid starving the
+  blocked coroutines when some others never stop running.
+
+  The read/write operations are submitted to an io_uring instance
+  (created upon the first operation) whose file descriptor is also
+  registered in the epoll instance: the completions wake up the
+  reactor. The submissions and the completions are processed in
+  batches when the reactor is polled. If io_uring is not available,
+  the operations fall back to crtn_wait_fd() followed by the
+  corresponding system call.
+*/
+#define CRTN_IO_POLL_PERIOD 64
+
+// Maximum number of events retrieved by one call to epoll_wait()
+#define CRTN_IO_EVENTS 64
+
+static int crtn_io_epfd = -1;
+
+// Number of coroutines blocked on file descriptors
+static size_t crtn_io_nb;
+
+// Scheduling operations since the last poll
+static unsigned int crtn_io_ticks;
+
+// Number of entries of the io_uring submission queue
+static size_t crtn_io_ring_entries;
+
+/*
+  The io_uring instance is driven with the raw system calls and the
+  rings shared with the kernel
+*/
+#define CRTN_IO_RING_UNINIT  -1
+#define CRTN_IO_RING_NONE    -2
+
+static struct crtn_io_ring_t
+{
+  int fd;
+
+  // Submission queue
+  unsigned int        *sq_head;
+  unsigned int        *sq_tail;
+  unsigned int         sq_mask;
+  unsigned int         sq_entries;
+  unsigned int        *sq_array;
+  unsigned int        *sq_flags;
+  struct io_uring_sqe *sqes;
+
+  // Number of entries not yet passed to the kernel
+  unsigned int to_submit;
+
+  // Completion queue
+  unsigned int        *cq_head;
+  unsigned int        *cq_tail;
+  unsigned int         cq_mask;
+  struct io_uring_cqe *cqes;
+
+  // Shared memory
+  void   *sq_ptr;
+  size_t  sq_sz;
+  void   *cq_ptr;
+  size_t  cq_sz;
+  size_t  sqes_sz;
+
+  // Number of operations in flight
+  size_t nb;
+
+  // Cancelled coroutines whose cancellation request is not yet
+  // queued (the submission queue was full)
+  crtn_link_t cancels;
+
+  // Coroutines waiting for a free submission queue entry
+  crtn_link_t waiters;
+} crtn_io_ring;
+
+
+int crtn_io_pending(void)
+{
+  return ((crtn_io_nb != 0) || (crtn_io_ring.nb != 0));
+} // crtn_io_pending
+
+
+static int crtn_io_epoll(void)
+{
+  if (crtn_io_epfd < 0) {
+    crtn_io_epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (crtn_io_epfd < 0) {
+      return -1;
+    }
+  }
+
+  return 0;
+} // crtn_io_epoll
+
+
+static void crtn_io_ring_unmap(void)
+{
+  if (crtn_io_ring.sqes) {
+    munmap(crtn_io_ring.sqes, crtn_io_ring.sqes_sz);
+    crtn_io_ring.sqes = 0;
+  }
+  if (crtn_io_ring.cq_ptr && (crtn_io_ring.cq_ptr != crtn_io_ring.sq_ptr)) {
+    munmap(crtn_io_ring.cq_ptr, crtn_io_ring.cq_sz);
+  }
+  crtn_io_ring.cq_ptr = 0;
+  if (crtn_io_ring.sq_ptr) {
+    munmap(crtn_io_ring.sq_ptr, crtn_io_ring.sq_sz);
+    crtn_io_ring.sq_ptr = 0;
+  }
+  if (crtn_io_ring.fd >= 0) {
+    close(crtn_io_ring.fd);
+  }
+  crtn_io_ring.fd = CRTN_IO_RING_NONE;
+} // crtn_io_ring_unmap
+
+
+/*
+  Creation of the io_uring instance. If it fails (old kernel,
+  forbidden system call...), the I/O operations fall back to
+  crtn_wait_fd()
+*/
+static void crtn_io_ring_init(void)
+{
+  struct io_uring_params  p;
+  struct epoll_event      ev;
+  char                   *sq;
+  char                   *cq;
+
+  crtn_io_ring.fd = CRTN_IO_RING_NONE;
+
+  if (0 != crtn_io_epoll()) {
+    return;
+  }
+
+  memset(&p, 0, sizeof(p));
+  crtn_io_ring.fd = (int)syscall(__NR_io_uring_setup, (unsigned int)crtn_io_ring_entries, &p);
+  if (crtn_io_ring.fd < 0) {
+    crtn_io_ring.fd = CRTN_IO_RING_NONE;
+    return;
+  }
+
+  // The read/write operations at the current file position are needed
+  if (!(p.features & IORING_FEAT_RW_CUR_POS)) {
+    crtn_io_ring_unmap();
+    return;
+  }
+
+  crtn_io_ring.sq_sz = p.sq_off.array + (p.sq_entries * sizeof(unsigned int));
+  crtn_io_ring.cq_sz = p.cq_off.cqes + (p.cq_entries * sizeof(struct io_uring_cqe));
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {
+    if (crtn_io_ring.cq_sz > crtn_io_ring.sq_sz) {
+      crtn_io_ring.sq_sz = crtn_io_ring.cq_sz;
+    }
+    crtn_io_ring.cq_sz = crtn_io_ring.sq_sz;
+  }
+
+  crtn_io_ring.sq_ptr = mmap(0, crtn_io_ring.sq_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                             crtn_io_ring.fd, IORING_OFF_SQ_RING);
+  if (MAP_FAILED == crtn_io_ring.sq_ptr) {
+    crtn_io_ring.sq_ptr = 0;
+    crtn_io_ring_unmap();
+    return;
+  }
+
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {
+    crtn_io_ring.cq_ptr = crtn_io_ring.sq_ptr;
+  } else {
+    crtn_io_ring.cq_ptr = mmap(0, crtn_io_ring.cq_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                               crtn_io_ring.fd, IORING_OFF_CQ_RING);
+    if (MAP_FAILED == crtn_io_ring.cq_ptr) {
+      crtn_io_ring.cq_ptr = 0;
+      crtn_io_ring_unmap();
+      return;
+    }
+  }
+
+  crtn_io_ring.sqes_sz = p.sq_entries * sizeof(struct io_uring_sqe);
+  crtn_io_ring.sqes = (struct io_uring_sqe *)mmap(0, crtn_io_ring.sqes_sz, PROT_READ | PROT_WRITE,
+                                                  MAP_SHARED | MAP_POPULATE, crtn_io_ring.fd, IORING_OFF_SQES);
+  if (MAP_FAILED == (void *)(crtn_io_ring.sqes)) {
+    crtn_io_ring.sqes = 0;
+    crtn_io_ring_unmap();
+    return;
+  }
+
+  sq = (char *)(crtn_io_ring.sq_ptr);
+  crtn_io_ring.sq_head = (unsigned int *)(sq + p.sq_off.head);
+  crtn_io_ring.sq_tail = (unsigned int *)(sq + p.sq_off.tail);
+  crtn_io_ring.sq_mask = *(unsigned int *)(sq + p.sq_off.ring_mask);
+  crtn_io_ring.sq_entries = p.sq_entries;
+  crtn_io_ring.sq_array = (unsigned int *)(sq + p.sq_off.array);
+  crtn_io_ring.sq_flags = (unsigned int *)(sq + p.sq_off.flags);
+
+  cq = (char *)(crtn_io_ring.cq_ptr);
+  crtn_io_ring.cq_head = (unsigned int *)(cq + p.cq_off.head);
+  crtn_io_ring.cq_tail = (unsigned int *)(cq + p.cq_off.tail);
+  crtn_io_ring.cq_mask = *(unsigned int *)(cq + p.cq_off.ring_mask);
+  crtn_io_ring.cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+  // The completions wake up the reactor
+  ev.events = EPOLLIN;
+  ev.data.ptr = &crtn_io_ring;
+  if (0 != epoll_ctl(crtn_io_epfd, EPOLL_CTL_ADD, crtn_io_ring.fd, &ev)) {
+    crtn_io_ring_unmap();
+    return;
+  }
+
+} // crtn_io_ring_init
+
+
+/*
+  Pass the pending submissions to the kernel and optionally wait for
+  some completions
+*/
+static void crtn_io_ring_enter(unsigned int min_complete)
+{
+  int rc;
+
+  if (!(crtn_io_ring.to_submit) && !min_complete) {
+    return;
+  }
+
+  do {
+    rc = (int)syscall(__NR_io_uring_enter, crtn_io_ring.fd, crtn_io_ring.to_submit, min_complete,
+                      (min_complete ? IORING_ENTER_GETEVENTS : 0), 0, 0);
+  } while ((rc < 0) && (EINTR == errno));
+
+  if (rc > 0) {
+    crtn_io_ring.to_submit -= (unsigned int)rc;
+  }
+
+} // crtn_io_ring_enter
+
+
+/*
+  Wake up the coroutines whose operations are complete. Return the
+  number of woken up coroutines
+*/
+static int crtn_io_ring_reap(void)
+{
+  unsigned int         head;
+  unsigned int         tail;
+  struct io_uring_cqe *cqe;
+  crtn_ccb_t          *ccb;
+  crtn_link_t         *link;
+  unsigned int         room;
+  int                  nb = 0;
+
+  for (;;) {
+
+    head = *(crtn_io_ring.cq_head);
+    tail = __atomic_load_n(crtn_io_ring.cq_tail, __ATOMIC_ACQUIRE);
+
+    while (head != tail) {
+      cqe = &(crtn_io_ring.cqes[head & crtn_io_ring.cq_mask]);
+
+      // No coroutine behind the cancellation requests
+      ccb = (crtn_ccb_t *)(uintptr_t)(cqe->user_data);
+      if (ccb) {
+        ccb->io_res = cqe->res;
+        ccb->wait_obj = 0;
+        crtn_io_ring.nb --;
+        if (ccb->flags & CRTN_CCB_FLAG_CANCEL_PENDING) {
+          // The buffer is no longer used: the cancellation
+          // is applied (cf. crtn_io_ring_cancel())
+          crtn_cancel_deferred(ccb);
+          nb ++;
+        } else if (CRTN_STATE_WAITING == ccb->state) {
+          crtn_make_runnable(&(ccb->link));
+          nb ++;
+        }
+      }
+
+      head ++;
+    }
+
+    __atomic_store_n(crtn_io_ring.cq_head, head, __ATOMIC_RELEASE);
+
+    // The completions which did not fit in the completion queue
+    // are kept by the kernel until it is flushed
+    if (!(__atomic_load_n(crtn_io_ring.sq_flags, __ATOMIC_ACQUIRE) & IORING_SQ_CQ_OVERFLOW)) {
+      break;
+    }
+    if (syscall(__NR_io_uring_enter, crtn_io_ring.fd, 0, 0, IORING_ENTER_GETEVENTS, 0, 0) < 0) {
+      break;
+    }
+  }
+
+  // Wake up as many coroutines waiting for a submission
+  // queue entry as there are free entries
+  room = crtn_io_ring.sq_entries -
+         (*(crtn_io_ring.sq_tail) - __atomic_load_n(crtn_io_ring.sq_head, __ATOMIC_ACQUIRE));
+  while (room && (link = CRTN_LIST_FRONT(&(crtn_io_ring.waiters)))) {
+    CRTN_LIST_DEL(link);
+    crtn_make_runnable(link);
+    room --;
+    nb ++;
+  }
+
+  return nb;
+} // crtn_io_ring_reap
+
+
+/*
+  Get a free submission queue entry (NULL if the queue is full)
+*/
+static struct io_uring_sqe *crtn_io_ring_sqe(void)
+{
+  unsigned int         tail;
+  unsigned int         idx;
+  struct io_uring_sqe *sqe;
+
+  tail = *(crtn_io_ring.sq_tail);
+  if ((tail - __atomic_load_n(crtn_io_ring.sq_head, __ATOMIC_ACQUIRE)) >= crtn_io_ring.sq_entries) {
+    crtn_io_ring_enter(0);
+    if ((tail - __atomic_load_n(crtn_io_ring.sq_head, __ATOMIC_ACQUIRE)) >= crtn_io_ring.sq_entries) {
+      return (struct io_uring_sqe *)0;
+    }
+  }
+
+  idx = tail & crtn_io_ring.sq_mask;
+  sqe = &(crtn_io_ring.sqes[idx]);
+  memset(sqe, 0, sizeof(*sqe));
+  crtn_io_ring.sq_array[idx] = idx;
+
+  return sqe;
+} // crtn_io_ring_sqe
+
+
+// Queue the entry returned by crtn_io_ring_sqe()
+static void crtn_io_ring_push(void)
+{
+  __atomic_store_n(crtn_io_ring.sq_tail, *(crtn_io_ring.sq_tail) + 1, __ATOMIC_RELEASE);
+  crtn_io_ring.to_submit ++;
+} // crtn_io_ring_push
+
+
+/*
+  Queue the request to cancel the operation of a coroutine. Return -1
+  if the submission queue is full
+*/
+static int crtn_io_ring_cancel_submit(crtn_ccb_t *ccb)
+{
+  struct io_uring_sqe *sqe;
+
+  sqe = crtn_io_ring_sqe();
+  if (!sqe) {
+    return -1;
+  }
+
+  sqe->opcode = IORING_OP_ASYNC_CANCEL;
+  sqe->addr = (uint64_t)(uintptr_t)ccb;
+  sqe->user_data = 0;
+  crtn_io_ring_push();
+
+  return 0;
+} // crtn_io_ring_cancel_submit
+
+
+/*
+  A coroutine blocked in an I/O operation is cancelled: the operation
+  is cancelled as well. The buffer may be in the stack of the
+  coroutine: the cancellation of the coroutine is deferred until the
+  completion of the operation is reaped (the coroutine stays
+  suspended in the meantime)
+*/
+static void crtn_io_ring_cancel(crtn_ccb_t *ccb)
+{
+  // Make room in the submission queue
+  if (0 != crtn_io_ring_cancel_submit(ccb)) {
+
+    // The completions are retrieved as the kernel does not
+    // consume the submissions when the completion queue is full
+    crtn_io_ring_reap();
+
+    // The operation completed meanwhile
+    if (!(ccb->wait_obj)) {
+      return;
+    }
+
+    // Retried by the reactor
+    if (0 != crtn_io_ring_cancel_submit(ccb)) {
+      CRTN_LIST_ADD_TAIL(&(crtn_io_ring.cancels), &(ccb->link));
+    }
+  }
+
+  crtn_io_ring_enter(0);
+
+  ccb->flags |= CRTN_CCB_FLAG_CANCEL_PENDING;
+
+} // crtn_io_ring_cancel
+
+
+/*
+  Unregister the file descriptor a coroutine is waiting on
+*/
+static void crtn_io_stop(crtn_ccb_t *ccb)
+{
+  if (ccb->io_fd >= 0) {
+    epoll_ctl(crtn_io_epfd, EPOLL_CTL_DEL, ccb->io_fd, 0);
+    ccb->io_fd = -1;
+    crtn_io_nb --;
+  }
+} // crtn_io_stop
+
+
+/*
+  A coroutine blocked in crtn_wait_fd() is cancelled
+*/
+static void crtn_io_cancel(crtn_ccb_t *ccb)
+{
+  crtn_io_stop(ccb);
+} // crtn_io_cancel
+
+
+/*
+  Wake up the coroutines whose file descriptors are ready. The caller
+  blocks until the deadline (CRTN_TIME_INFINITE: no timeout, 0: no
+  blocking) and then expires the elapsed timers
+*/
+void crtn_io_poll(crtn_time_t deadline)
+{
+  struct epoll_event  evs[CRTN_IO_EVENTS];
+  crtn_ccb_t         *ccb;
+  crtn_link_t        *link;
+  crtn_time_t         delay;
+  int                 ms;
+  int                 nb;
+  int                 i;
+
+  if (CRTN_TIME_INFINITE == deadline) {
+    ms = -1;
+  } else if (0 == deadline) {
+    ms = 0;
+  } else {
+    // Round up to never wake up before the deadline
+    delay = deadline - crtn_timer_now();
+    if (delay <= 0) {
+      ms = 0;
+    } else if (delay >= CRTN_MSEC(INT_MAX)) {
+      ms = INT_MAX;
+    } else {
+      ms = (int)((delay + CRTN_MSEC(1) - 1) / CRTN_MSEC(1));
+    }
+  }
+
+  crtn_io_ticks = 0;
+
+  // Submit the queued operations (including the cancellation requests
+  // which did not fit previously) and get the available completions
+  if (crtn_io_ring.nb) {
+    while ((link = CRTN_LIST_FRONT(&(crtn_io_ring.cancels)))) {
+      if (0 != crtn_io_ring_cancel_submit(CRTN_LINK2CCB(link))) {
+        break;
+      }
+      CRTN_LIST_DEL(link);
+    }
+    crtn_io_ring_enter(0);
+    if (crtn_io_ring_reap()) {
+      ms = 0;
+    }
+  }
+
+  nb = epoll_wait(crtn_io_epfd, evs, CRTN_IO_EVENTS, ms);
+  for (i = 0; i < nb; i ++) {
+
+    // Completions of the io_uring operations
+    if (evs[i].data.ptr == &crtn_io_ring) {
+      crtn_io_ring_reap();
+      continue;
+    }
+
+    ccb = (crtn_ccb_t *)(evs[i].data.ptr);
+
+    // The coroutine may have been woken up by the expiration
+    // of its timeout (it unregisters itself when it runs)
+    if (CRTN_STATE_WAITING != ccb->state) {
+      continue;
+    }
+
+    ccb->io_events = evs[i].events & (CRTN_IO_IN | CRTN_IO_OUT | CRTN_IO_ERR | CRTN_IO_HUP);
+    crtn_io_stop(ccb);
+    ccb->cancel_hook = 0;
+    crtn_make_runnable(&(ccb->link));
+  }
+
+  if (crtn_timer_pending()) {
+    crtn_timer_expire();
+  }
+
+} // crtn_io_poll
+
+
+/*
+  Called upon each scheduling operation while coroutines are blocked
+  on file descriptors
+*/
+void crtn_io_check(void)
+{
+  if (++ crtn_io_ticks >= CRTN_IO_POLL_PERIOD) {
+    crtn_io_poll(0);
+  }
+} // crtn_io_check
+
+
+int crtn_wait_fd(
+                 int          fd,
+                 unsigned int events,
+                 crtn_time_t  timeout
+                )
+{
+  struct epoll_event  ev;
+  struct pollfd       pfd;
+  int                 rc;
+
+  if ((fd < 0) || !events || (events & ~(CRTN_IO_IN | CRTN_IO_OUT))) {
+    crtn_set_errno(EINVAL);
+    return -1;
+  }
+
+  // Null timeout: check the current state of the file descriptor
+  if (0 == timeout) {
+    pfd.fd = fd;
+    pfd.events = (short)events;
+    rc = poll(&pfd, 1, 0);
+    if (rc < 0) {
+      crtn_set_errno(errno);
+      return -1;
+    }
+    if (pfd.revents & POLLNVAL) {
+      crtn_set_errno(EBADF);
+      return -1;
+    }
+    if (0 == rc) {
+      crtn_set_errno(ETIMEDOUT);
+      return -1;
+    }
+    return (int)(pfd.revents);
+  }
+
+  if (0 != crtn_io_epoll()) {
+    crtn_set_errno(errno);
+    return -1;
+  }
+
+  // The events are reported once: the file descriptor
+  // is unregistered when the coroutine wakes up
+  ev.events = events | EPOLLONESHOT;
+  ev.data.ptr = crtn_current;
+  if (0 != epoll_ctl(crtn_io_epfd, EPOLL_CTL_ADD, fd, &ev)) {
+    // Another coroutine is waiting on the same file descriptor
+    crtn_set_errno((EEXIST == errno) ? EBUSY : errno);
+    return -1;
+  }
+
+  crtn_io_nb ++;
+  crtn_current->io_fd = fd;
+  crtn_current->io_events = 0;
+  crtn_current->cancel_hook = crtn_io_cancel;
+  crtn_make_waiting(0, &(crtn_current->link));
+  if (timeout > 0) {
+    crtn_timer_start(crtn_current, timeout);
+  }
+  crtn_suspend();
+
+  crtn_current->cancel_hook = 0;
+
+  // The timeout elapsed before any event
+  if (crtn_current->flags & CRTN_CCB_FLAG_TIMEDOUT) {
+    crtn_current->flags &= ~CRTN_CCB_FLAG_TIMEDOUT;
+    crtn_io_stop(crtn_current);
+    crtn_set_errno(ETIMEDOUT);
+    return -1;
+  }
+
+  return (int)(crtn_current->io_events);
+} // crtn_wait_fd
+
+
+/*
+  Read/write operation through io_uring or, as a fallback, a wait
+  for the readiness of the file descriptor (if it is not a regular
+  file) followed by the system call. The offset is -1 for the current
+  file position
+*/
+static ssize_t crtn_io_rw(
+                          int         write_op,
+                          int         fd,
+                          const void *buf,
+                          size_t      count,
+                          off_t       offset
+                         )
+{
+  struct io_uring_sqe *sqe;
+  ssize_t              rc;
+
+  if (fd < 0) {
+    crtn_set_errno(EBADF);
+    return -1;
+  }
+
+  if (CRTN_IO_RING_UNINIT == crtn_io_ring.fd) {
+    crtn_io_ring_init();
+  }
+
+  if (crtn_io_ring.fd < 0) {
+
+    rc = crtn_wait_fd(fd, (write_op ? CRTN_IO_OUT : CRTN_IO_IN), -1);
+    if ((rc < 0) && (EPERM != crtn_errno())) {
+      return -1;
+    }
+
+    if (offset < 0) {
+      rc = (write_op ? write(fd, buf, count) : read(fd, (void *)(uintptr_t)buf, count));
+    } else {
+      rc = (write_op ? pwrite(fd, buf, count, offset) : pread(fd, (void *)(uintptr_t)buf, count, offset));
+    }
+    if (rc < 0) {
+      crtn_set_errno(errno);
+      return -1;
+    }
+
+    return rc;
+  }
+
+  for (;;) {
+    sqe = crtn_io_ring_sqe();
+    if (sqe) {
+      break;
+    }
+
+    // The kernel does not consume the submissions
+    // when the completion queue is full
+    crtn_io_ring_reap();
+    sqe = crtn_io_ring_sqe();
+    if (sqe) {
+      break;
+    }
+
+    // Wait for a free entry (cf. crtn_io_ring_reap()). A
+    // cancellation unlinks the coroutine from the waiters
+    crtn_make_waiting(&(crtn_io_ring.waiters), &(crtn_current->link));
+    crtn_suspend();
+  }
+
+  // The kernel does not transfer more than 2 GB at once
+  if (count > 0x7ffff000) {
+    count = 0x7ffff000;
+  }
+
+  sqe->opcode = (write_op ? IORING_OP_WRITE : IORING_OP_READ);
+  sqe->fd = fd;
+  sqe->addr = (uint64_t)(uintptr_t)buf;
+  sqe->len = (unsigned int)count;
+  sqe->off = (uint64_t)offset;
+  sqe->user_data = (uint64_t)(uintptr_t)crtn_current;
+  crtn_io_ring_push();
+  crtn_io_ring.nb ++;
+
+  // The submission is done in a batch when the reactor is polled
+  crtn_current->wait_obj = &crtn_io_ring;
+  crtn_current->cancel_hook = crtn_io_ring_cancel;
+  crtn_make_waiting(0, &(crtn_current->link));
+  crtn_suspend();
+
+  crtn_current->cancel_hook = 0;
+
+  if (crtn_current->io_res < 0) {
+    crtn_set_errno(-(crtn_current->io_res));
+    return -1;
+  }
+
+  return crtn_current->io_res;
+} // crtn_io_rw
+
+
+ssize_t crtn_read(
+                  int     fd,
+                  void   *buf,
+                  size_t  count
+                 )
+{
+  return crtn_io_rw(0, fd, buf, count, (off_t)-1);
+} // crtn_read
+
+
+ssize_t crtn_write(
+                   int         fd,
+                   const void *buf,
+                   size_t      count
+                  )
+{
+  return crtn_io_rw(1, fd, buf, count, (off_t)-1);
+} // crtn_write
+
+
+ssize_t crtn_pread(
+                   int     fd,
+                   void   *buf,
+                   size_t  count,
+                   off_t   offset
+                  )
+{
+  if (offset < 0) {
+    crtn_set_errno(EINVAL);
+    return -1;
+  }
+
+  return crtn_io_rw(0, fd, buf, count, offset);
+} // crtn_pread
+
+
+ssize_t crtn_pwrite(
+                    int         fd,
+                    const void *buf,
+                    size_t      count,
+                    off_t       offset
+                   )
+{
+  if (offset < 0) {
+    crtn_set_errno(EINVAL);
+    return -1;
+  }
+
+  return crtn_io_rw(1, fd, buf, count, offset);
+} // crtn_pwrite
+
+
+void crtn_lib_io_init(void)
+{
+  crtn_io_epfd = -1;
+  crtn_io_nb = 0;
+  crtn_io_ticks = 0;
+
+  crtn_get_size_env("CRTN_IO_RING", &crtn_io_ring_entries, CRTN_IO_RING);
+  memset(&crtn_io_ring, 0, sizeof(crtn_io_ring));
+  crtn_io_ring.fd = CRTN_IO_RING_UNINIT;
+  CRTN_LIST_INIT(&(crtn_io_ring.cancels));
+  CRTN_LIST_INIT(&(crtn_io_ring.waiters));
+} // crtn_lib_io_init
+
+
+void crtn_lib_io_exit(void)
+{
+  if (crtn_io_ring.fd >= 0) {
+    crtn_io_ring_unmap();
+  }
+
+  if (crtn_io_epfd >= 0) {
+    close(crtn_io_epfd);
+    crtn_io_epfd = -1;
+  }
+} // crtn_lib_io_exit
@@ -0,0 +1,48 @@
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+// File        : crtn_io.h
+// Description : I/O reactor (file descriptors events)
+// License     :
+//
+//  Copyright (C) 2021 Rachid Koucha <rachid dot koucha at gmail dot com>
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2.1 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to:
+//  the Free Software Foundation, Inc.,
+//  51 Franklin Street, Fifth Floor,
+//  Boston, MA  02110-1301  USA
+//
+//
+// Evolutions  :
+//
+//     17-Oct-2026 agent          - Creation
+//
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+#ifndef CRTN_IO_H
+#define CRTN_IO_H
+
+#include "crtn.h"
+#include "crtn_ccb.h"
+
+
+extern int crtn_io_pending(void);
+
+extern void crtn_io_poll(crtn_time_t deadline);
+
+extern void crtn_io_check(void);
+
+extern void crtn_lib_io_init(void);
+
+extern void crtn_lib_io_exit(void);
+
+#endif // CRTN_IO_H
@@ -72,6 +72,33 @@ typedef struct crtn_link {
                  } while(0)
 
 
+// Move all the elements of list "l2" at the end of list "l"
+#define CRTN_LIST_SPLICE_TAIL(l, l2)               \
+                 do {                               \
+                   if (!CRTN_LIST_EMPTY(l2)) {      \
+                     (l)->prev->next = (l2)->next;  \
+                     (l2)->next->prev = (l)->prev;  \
+                     (l)->prev = (l2)->prev;        \
+                     (l2)->prev->next = (l);        \
+                     CRTN_LIST_INIT(l2);            \
+                   }                                \
+                 } while(0)
+
+
+// Move the elements of list "l" from the front up to "e" (included)
+// at the end of list "l2"
+#define CRTN_LIST_SPLIT_FRONT(l, e, l2)             \
+                 do {                               \
+                   crtn_link_t *_first = (l)->next; \
+                   (l)->next = (e)->next;           \
+                   (e)->next->prev = (l);           \
+                   (l2)->prev->next = _first;       \
+                   _first->prev = (l2)->prev;       \
+                   (l2)->prev = (e);                \
+                   (e)->next = (l2);                \
+                 } while(0)
+
+
 #define CRTN_IS_LINKED(e) ((e)->next != (e))
 
 
@@ -32,18 +32,28 @@
 #include <sys/types.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <assert.h>
+#include <limits.h>
+#include <stdint.h>
 
 #include "crtn.h"
 #include "crtn_list.h"
 #include "crtn_ccb.h"
+#include "crtn_timer.h"
 
 static size_t crtn_mbx_max;
 static struct crtn_mbx_t
 {
+#ifdef HAVE_CRTN_MT
+  crtn_lock_t lock; // Messages and waiting coroutines
+#endif // HAVE_CRTN_MT
   int         busy;
+  int         next_free;
   size_t      nb_msgs;
+  size_t      capacity; // 0 if unbounded
   crtn_link_t msgs;
-  crtn_link_t crtns;
+  crtn_link_t crtns;    // Receivers waiting for a message
+  crtn_link_t senders;  // Senders waiting for room (bounded mailbox)
 } *crtn_mbx;
 
 
@@ -51,40 +61,72 @@ static struct crtn_mbx_t
   Number of active mailboxes
 */
 static int crtn_mbx_nb;
-static int crtn_next_free_mbxid;
+
+/*
+  Stack of free mailboxes (chained through their "next_free" field)
+*/
+static int crtn_mbx_free_ids = -1;
+
+#ifdef HAVE_CRTN_MT
+/*
+  Lock of the allocation of the mailboxes
+*/
+static crtn_lock_t crtn_mbx_tab_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif // HAVE_CRTN_MT
 
 
 static crtn_mbx_t crtn_get_mbxid(void)
 {
   int i;
-  int count = crtn_mbx_max;
-
-  for (i = crtn_next_free_mbxid; count; count --, i = (i + 1) % crtn_mbx_max) {
-    if (!(crtn_mbx[i].busy)) {
-      // Mark the context busy
-      crtn_mbx[i].busy = 1;
-      CRTN_LIST_INIT(&(crtn_mbx[i].msgs));
-      CRTN_LIST_INIT(&(crtn_mbx[i].crtns));
-      crtn_mbx[i].nb_msgs = 0;
-      crtn_next_free_mbxid = (i + 1) % crtn_mbx_max;
-      crtn_mbx_nb ++;
-      return i;
-    }
+
+  CRTN_LOCK(&crtn_mbx_tab_lock);
+
+  if (crtn_mbx_free_ids < 0) {
+    CRTN_UNLOCK(&crtn_mbx_tab_lock);
+    crtn_set_errno(EAGAIN);
+    return -1;
   }
 
-  crtn_set_errno(EAGAIN);
-  return -1;
+  // Pop the first free mailbox
+  i = crtn_mbx_free_ids;
+  crtn_mbx_free_ids = crtn_mbx[i].next_free;
+
+  // Mark the context busy
+  crtn_mbx[i].busy = 1;
+  CRTN_LIST_INIT(&(crtn_mbx[i].msgs));
+  CRTN_LIST_INIT(&(crtn_mbx[i].crtns));
+  CRTN_LIST_INIT(&(crtn_mbx[i].senders));
+  crtn_mbx[i].nb_msgs = 0;
+  crtn_mbx[i].capacity = 0;
+  crtn_mbx_nb ++;
+
+  CRTN_UNLOCK(&crtn_mbx_tab_lock);
+
+  return i;
 
 } // crtn_get_mbxid
 
 
-static void crtn_free_mbxid(crtn_mbx_t mbx)
+static int crtn_free_mbxid(crtn_mbx_t mbx)
 {
 
+  CRTN_LOCK(&crtn_mbx_tab_lock);
+
+  if (!(crtn_mbx[mbx].busy)) {
+    CRTN_UNLOCK(&crtn_mbx_tab_lock);
+    crtn_set_errno(EINVAL);
+    return -1;
+  }
+
   crtn_mbx[mbx].busy = 0;
-  crtn_next_free_mbxid = mbx;
+  crtn_mbx[mbx].next_free = crtn_mbx_free_ids;
+  crtn_mbx_free_ids = mbx;
   crtn_mbx_nb --;
 
+  CRTN_UNLOCK(&crtn_mbx_tab_lock);
+
+  return 0;
+
 } // crtn_free_mbxid
 
 
@@ -109,25 +151,218 @@ int crtn_mbx_new(crtn_mbx_t *mbx)
 } // crtn_mbx_new
 
 
-int crtn_mbx_delete(crtn_mbx_t mbx)
+int crtn_mbx_new_bounded(
+                         crtn_mbx_t *mbx,
+                         size_t      capacity
+                        )
 {
-  if (mbx < 0 || (size_t)mbx >= crtn_mbx_max) {
+  if (!capacity) {
     crtn_set_errno(EINVAL);
     return -1;
   }
 
-  crtn_free_mbxid(mbx);
+  if (0 != crtn_mbx_new(mbx)) {
+    return -1;
+  }
+
+  crtn_mbx[*mbx].capacity = capacity;
 
   return 0;
+} // crtn_mbx_new_bounded
+
+
+int crtn_mbx_delete(crtn_mbx_t mbx)
+{
+  if (mbx < 0 || (size_t)mbx >= crtn_mbx_max) {
+    crtn_set_errno(EINVAL);
+    return -1;
+  }
+
+  return crtn_free_mbxid(mbx);
 } // crtn_mbx_delete
 
 
+/*
+  Deliver a message into a mailbox: if coroutines are waiting, the
+  oldest one is handed off the message and made runnable. Otherwise,
+  the message is queued at the front or the tail of the mailbox.
+  Only the messages given back by cancelled receivers are queued at
+  the front: they may make a bounded mailbox exceed its capacity
+  (cf. crtn_mbx_cancel())
+*/
+static void crtn_mbx_deliver(
+                             struct crtn_mbx_t *pmbx,
+                             crtn_link_t       *msg_link,
+                             int                front
+                            )
+{
+  crtn_link_t *link;
+  crtn_ccb_t  *ccb;
+
+  while ((link = CRTN_LIST_FRONT(&(pmbx->crtns)))) {
+    CRTN_LIST_DEL(link);
+    ccb = CRTN_LINK2CCB(link);
+
+    // The coroutine may have been woken up by its timer or
+    // its canceller in the meantime
+    if (!CRTN_CLAIM(ccb)) {
+      continue;
+    }
+
+    ccb->handoff = (void *)(msg_link + 1);
+    crtn_make_runnable(link);
+    return;
+  }
+
+  if (front) {
+    CRTN_LIST_ADD_FRONT(&(pmbx->msgs), msg_link);
+  } else {
+    assert(!(pmbx->capacity) || (pmbx->nb_msgs < pmbx->capacity));
+    CRTN_LIST_ADD_TAIL(&(pmbx->msgs), msg_link);
+  }
+  pmbx->nb_msgs ++;
+
+} // crtn_mbx_deliver
+
+
+/*
+  Messages have been removed from a mailbox: if senders are waiting
+  for room, the messages of the oldest ones are queued as long as there
+  is room and the senders are made runnable
+*/
+static void crtn_mbx_refill(struct crtn_mbx_t *pmbx)
+{
+  crtn_ccb_t *ccb;
+
+  while (CRTN_LIST_FRONT(&(pmbx->senders)) && (pmbx->nb_msgs < pmbx->capacity)) {
+    ccb = CRTN_LINK2CCB(CRTN_LIST_FRONT(&(pmbx->senders)));
+    CRTN_LIST_DEL(&(ccb->link));
+
+    // The sender may have been woken up by its canceller
+    // in the meantime: its message is not posted
+    if (!CRTN_CLAIM(ccb)) {
+      continue;
+    }
+
+    CRTN_LIST_ADD_TAIL(&(pmbx->msgs), ((crtn_link_t *)(ccb->handoff)) - 1);
+    pmbx->nb_msgs ++;
+    ccb->handoff = 0;
+    crtn_make_runnable(&(ccb->link));
+  }
+
+} // crtn_mbx_refill
+
+
+/*
+  Remove the first message of a mailbox
+*/
+static void *crtn_mbx_remove(struct crtn_mbx_t *pmbx)
+{
+  crtn_link_t *link;
+
+  link = CRTN_LIST_FRONT(&(pmbx->msgs));
+  CRTN_LIST_DEL(link);
+  pmbx->nb_msgs --;
+
+  crtn_mbx_refill(pmbx);
+
+  return (void *)(link + 1);
+
+} // crtn_mbx_remove
+
+
+/*
+  Detach the first "nb" messages (at most) of a mailbox at once into
+  "chain" and return their number. The whole list of messages is
+  spliced if it is not longer than "nb"
+*/
+static size_t crtn_mbx_detach(
+                              struct crtn_mbx_t *pmbx,
+                              crtn_link_t       *chain,
+                              size_t             nb
+                             )
+{
+  crtn_link_t *last;
+  size_t       i;
+
+  if (nb >= pmbx->nb_msgs) {
+    nb = pmbx->nb_msgs;
+    CRTN_LIST_SPLICE_TAIL(chain, &(pmbx->msgs));
+  } else {
+    last = pmbx->msgs.next;
+    for (i = 1; i < nb; i ++) {
+      last = last->next;
+    }
+    CRTN_LIST_SPLIT_FRONT(&(pmbx->msgs), last, chain);
+  }
+  pmbx->nb_msgs -= nb;
+
+  crtn_mbx_refill(pmbx);
+
+  return nb;
+
+} // crtn_mbx_detach
+
+
+/*
+  Store the messages of a detached chain into an array
+*/
+static void crtn_mbx_chain2array(
+                                 crtn_link_t  *chain,
+                                 void        **msgs
+                                )
+{
+  crtn_link_t *link;
+
+  for (link = chain->next; link != chain; link = link->next) {
+    *(msgs ++) = (void *)(link + 1);
+  }
+
+} // crtn_mbx_chain2array
+
+
+/*
+  A coroutine blocked in crtn_mbx_get() is cancelled: if it was
+  handed off a message, the latter is delivered to the next waiter
+  or put back at the front of the mailbox.
+  The message has already been accepted from its sender: if the
+  mailbox became full meanwhile, a bounded mailbox exceeds its
+  capacity until enough messages are removed. This is the only case.
+  The senders stay suspended and crtn_mbx_trypost() fails as long as
+  the number of messages is not below the capacity.
+*/
+static void crtn_mbx_cancel(crtn_ccb_t *ccb)
+{
+  struct crtn_mbx_t *pmbx = (struct crtn_mbx_t *)(ccb->wait_obj);
+
+  if (ccb->handoff) {
+    crtn_mbx_deliver(pmbx, ((crtn_link_t *)(ccb->handoff)) - 1, 1);
+    ccb->handoff = 0;
+  }
+
+  ccb->wait_obj = 0;
+
+} // crtn_mbx_cancel
+
+
+/*
+  A coroutine blocked in crtn_mbx_post() is cancelled: its message
+  is not posted (the generic cancel code unlinks it from the senders)
+*/
+static void crtn_mbx_cancel_post(crtn_ccb_t *ccb)
+{
+  ccb->handoff = ccb->wait_obj = 0;
+
+} // crtn_mbx_cancel_post
+
+
 int crtn_mbx_post(
                   crtn_mbx_t  mbx,
                   void       *msg
                  )
 {
-  crtn_link_t *link;
+  struct crtn_mbx_t *pmbx;
+  crtn_ccb_t        *ccb;
 
   if (mbx < 0 || (size_t)mbx >= crtn_mbx_max) {
     crtn_set_errno(EINVAL);
@@ -139,32 +374,49 @@ int crtn_mbx_post(
     return -1;
   }
 
-  link = ((crtn_link_t *)msg) - 1;
+  pmbx = &(crtn_mbx[mbx]);
+
+  CRTN_LOCK(&(pmbx->lock));
+
+  // Bounded mailbox full: wait for room. The receiver queues
+  // the message when it removes one (FIFO order of the senders)
+  if (pmbx->capacity && (pmbx->nb_msgs >= pmbx->capacity)) {
+    ccb = crtn_current;
+    ccb->wait_obj = pmbx;
+    ccb->handoff = msg;
+    ccb->cancel_hook = crtn_mbx_cancel_post;
+    crtn_make_waiting(&(pmbx->senders), &(ccb->link));
+    CRTN_SET_WAIT_LOCK(ccb, &(pmbx->lock));
+    CRTN_ARM(ccb);
+    CRTN_UNLOCK(&(pmbx->lock));
+    crtn_suspend();
+
+    // The coroutine may resume on another thread
+    ccb = crtn_current;
+    assert(!(ccb->handoff));
+    ccb->wait_obj = 0;
+    ccb->cancel_hook = 0;
+    CRTN_SET_WAIT_LOCK(ccb, 0);
 
-  CRTN_LIST_ADD_TAIL(&(crtn_mbx[mbx].msgs), link);
-  crtn_mbx[mbx].nb_msgs ++;
+    return 0;
+  }
 
-  // Wake up the coroutines waiting on the mailbox if any
-  link = CRTN_LIST_FRONT(&(crtn_mbx[mbx].crtns));
-  if (link) {
+  // Wake up only one waiting coroutine (if any) to which
+  // the message is directly handed off
+  crtn_mbx_deliver(pmbx, ((crtn_link_t *)msg) - 1, 0);
 
-    do {
-      CRTN_LIST_DEL(link);
-      crtn_make_runnable(link);
-      link = CRTN_LIST_FRONT(&(crtn_mbx[mbx].crtns));
-    } while (link);
-  }
+  CRTN_UNLOCK(&(pmbx->lock));
 
   return 0;
 } // crtn_mbx_post
 
 
-int crtn_mbx_get(
-                  crtn_mbx_t   mbx,
-                  void       **msg
-                )
+int crtn_mbx_trypost(
+                     crtn_mbx_t  mbx,
+                     void       *msg
+                    )
 {
-  crtn_link_t *link;
+  struct crtn_mbx_t *pmbx;
 
   if (mbx < 0 || (size_t)mbx >= crtn_mbx_max) {
     crtn_set_errno(EINVAL);
@@ -176,35 +428,154 @@ int crtn_mbx_get(
     return -1;
   }
 
-  do {
+  pmbx = &(crtn_mbx[mbx]);
 
-    if (!(crtn_mbx[mbx].nb_msgs)) {
-      crtn_make_waiting(&(crtn_mbx[mbx].crtns), &(crtn_current->link));
-      crtn_yield(0);
-    }
+  CRTN_LOCK(&(pmbx->lock));
 
-    link = CRTN_LIST_FRONT(&(crtn_mbx[mbx].msgs));
+  if (pmbx->capacity && (pmbx->nb_msgs >= pmbx->capacity)) {
+    CRTN_UNLOCK(&(pmbx->lock));
+    crtn_set_errno(EAGAIN);
+    return -1;
+  }
 
-    // If multiple coroutines are were waiting on the mailbox,
-    // perhaps the available message has already been removed
-    if (link) {
-      CRTN_LIST_DEL(link);
-      crtn_mbx[mbx].nb_msgs --;
-      *msg = (void *)(link + 1);
-    }
+  crtn_mbx_deliver(pmbx, ((crtn_link_t *)msg) - 1, 0);
 
-  } while(!link);
+  CRTN_UNLOCK(&(pmbx->lock));
 
   return 0;
+} // crtn_mbx_trypost
+
+
+/*
+  Get up to "nb" messages (at least one) and return their number
+*/
+static int crtn_mbx_get_internal(
+                                 crtn_mbx_t    mbx,
+                                 void        **msg,
+                                 size_t        nb,
+                                 crtn_time_t   timeout
+                                )
+{
+  struct crtn_mbx_t *pmbx;
+  crtn_ccb_t        *ccb;
+  crtn_link_t        chain;
+  int                timedout;
+  size_t             n;
+
+  if (mbx < 0 || (size_t)mbx >= crtn_mbx_max) {
+    crtn_set_errno(EINVAL);
+    return -1;
+  }
+
+  if (!msg) {
+    crtn_set_errno(EINVAL);
+    return -1;
+  }
+
+  pmbx = &(crtn_mbx[mbx]);
+
+  CRTN_LOCK(&(pmbx->lock));
+
+  if (pmbx->nb_msgs) {
+    if (1 == nb) {
+      *msg = crtn_mbx_remove(pmbx);
+      n = 1;
+    } else {
+      CRTN_LIST_INIT(&chain);
+      n = crtn_mbx_detach(pmbx, &chain, nb);
+    }
+    CRTN_UNLOCK(&(pmbx->lock));
+
+    // The detached messages are stored out of the locks
+    if (nb > 1) {
+      crtn_mbx_chain2array(&chain, msg);
+    }
+
+    return (int)n;
+  }
+
+  if (0 == timeout) {
+    CRTN_UNLOCK(&(pmbx->lock));
+    *msg = (void *)0;
+    crtn_set_errno(ETIMEDOUT);
+    return -1;
+  }
+
+  // Wait for a message: the poster hands it off to the
+  // waiting coroutines in FIFO order
+  ccb = crtn_current;
+  ccb->wait_obj = pmbx;
+  ccb->handoff = 0;
+  ccb->cancel_hook = crtn_mbx_cancel;
+  crtn_make_waiting(&(pmbx->crtns), &(ccb->link));
+  CRTN_SET_WAIT_LOCK(ccb, &(pmbx->lock));
+  crtn_timer_start(ccb, timeout);
+  CRTN_UNLOCK(&(pmbx->lock));
+  crtn_suspend();
+
+  // The coroutine may resume on another thread
+  ccb = crtn_current;
+  *msg = ccb->handoff;
+  ccb->handoff = ccb->wait_obj = 0;
+  ccb->cancel_hook = 0;
+  CRTN_SET_WAIT_LOCK(ccb, 0);
+
+  // The timeout elapsed before the arrival of a message
+  timedout = (ccb->flags & CRTN_CCB_FLAG_TIMEDOUT);
+  CRTN_FLAG_CLR(ccb, CRTN_CCB_FLAG_TIMEDOUT);
+
+  if (timedout) {
+    assert(!(*msg));
+    crtn_set_errno(ETIMEDOUT);
+    return -1;
+  }
+
+  assert(*msg);
+
+  // The messages posted along with the handed off one
+  n = 1;
+  if (nb > 1) {
+    CRTN_LOCK(&(pmbx->lock));
+    CRTN_LIST_INIT(&chain);
+    n += crtn_mbx_detach(pmbx, &chain, nb - 1);
+    CRTN_UNLOCK(&(pmbx->lock));
+    crtn_mbx_chain2array(&chain, msg + 1);
+  }
+
+  return (int)n;
+} // crtn_mbx_get_internal
+
+
+int crtn_mbx_get(
+                  crtn_mbx_t   mbx,
+                  void       **msg
+                )
+{
+  return (crtn_mbx_get_internal(mbx, msg, 1, CRTN_TIME_INFINITE) < 0 ? -1 : 0);
 } // crtn_mbx_get
 
 
+int crtn_mbx_timedget(
+                      crtn_mbx_t    mbx,
+                      void        **msg,
+                      crtn_time_t   timeout
+                     )
+{
+  if (timeout < 0) {
+    crtn_set_errno(EINVAL);
+    return -1;
+  }
+
+  return (crtn_mbx_get_internal(mbx, msg, 1, timeout) < 0 ? -1 : 0);
+} // crtn_mbx_timedget
+
+
 int crtn_mbx_tryget(
                     crtn_mbx_t   mbx,
                     void       **msg
                    )
 {
-  crtn_link_t *link;
+  struct crtn_mbx_t *pmbx;
 
   if (mbx < 0 || (size_t)mbx >= crtn_mbx_max) {
     crtn_set_errno(EINVAL);
@@ -216,34 +587,279 @@ int crtn_mbx_tryget(
     return -1;
   }
 
-  if (!(crtn_mbx[mbx].nb_msgs)) {
+  pmbx = &(crtn_mbx[mbx]);
+
+  CRTN_LOCK(&(pmbx->lock));
+
+  if (!(pmbx->nb_msgs)) {
+    CRTN_UNLOCK(&(pmbx->lock));
     *msg = (void *)0;
     crtn_set_errno(EAGAIN);
     return -1;
   }
 
-  link = CRTN_LIST_FRONT(&(crtn_mbx[mbx].msgs));
-  CRTN_LIST_DEL(link);
-  crtn_mbx[mbx].nb_msgs --;
-  *msg = (void *)(link + 1);
+  *msg = crtn_mbx_remove(pmbx);
+
+  CRTN_UNLOCK(&(pmbx->lock));
 
   return 0;
 } // crtn_mbx_tryget
 
 
+int crtn_mbx_post_n(
+                    crtn_mbx_t   mbx,
+                    void       **msgs,
+                    size_t       nb
+                   )
+{
+  struct crtn_mbx_t *pmbx;
+  crtn_link_t        chain;
+  size_t             i, n;
+
+  if (mbx < 0 || (size_t)mbx >= crtn_mbx_max) {
+    crtn_set_errno(EINVAL);
+    return -1;
+  }
+
+  if (!msgs) {
+    crtn_set_errno(EINVAL);
+    return -1;
+  }
+
+  for (i = 0; i < nb; i ++) {
+    if (!msgs[i]) {
+      crtn_set_errno(EINVAL);
+      return -1;
+    }
+  }
+
+  pmbx = &(crtn_mbx[mbx]);
+
+  CRTN_LOCK(&(pmbx->lock));
+
+  // Hand off the first messages to the waiting coroutines if any
+  i = 0;
+  while ((i < nb) && !CRTN_LIST_EMPTY(&(pmbx->crtns))) {
+    crtn_mbx_deliver(pmbx, ((crtn_link_t *)(msgs[i])) - 1, 0);
+    i ++;
+  }
+
+  // Number of messages which can be queued without waiting
+  n = nb - i;
+  if (pmbx->capacity) {
+    if (pmbx->nb_msgs >= pmbx->capacity) {
+      n = 0;
+    } else if (n > (pmbx->capacity - pmbx->nb_msgs)) {
+      n = pmbx->capacity - pmbx->nb_msgs;
+    }
+  }
+
+  // Chain the messages and splice the chain into the mailbox
+  if (n) {
+    CRTN_LIST_INIT(&chain);
+    for (n += i; i < n; i ++) {
+      CRTN_LIST_ADD_TAIL(&chain, ((crtn_link_t *)(msgs[i])) - 1);
+      pmbx->nb_msgs ++;
+    }
+    CRTN_LIST_SPLICE_TAIL(&(pmbx->msgs), &chain);
+  }
+
+  CRTN_UNLOCK(&(pmbx->lock));
+
+  // The bounded mailbox is full: the remaining
+  // messages are posted as room is made
+  for (; i < nb; i ++) {
+    if (0 != crtn_mbx_post(mbx, msgs[i])) {
+      return -1;
+    }
+  }
+
+  return 0;
+} // crtn_mbx_post_n
+
+
+int crtn_mbx_get_n(
+                   crtn_mbx_t   mbx,
+                   void       **msgs,
+                   size_t       nb
+                  )
+{
+  if (!nb || (nb > INT_MAX)) {
+    crtn_set_errno(EINVAL);
+    return -1;
+  }
+
+  // The available messages are detached at once
+  return crtn_mbx_get_internal(mbx, msgs, nb, CRTN_TIME_INFINITE);
+} // crtn_mbx_get_n
+
+
 #define CRTN_MSG_HDR_SZ                                    \
   ((sizeof(crtn_link_t) + __alignof__(crtn_link_t) - 1) &  \
    ~(__alignof__(crtn_link_t) - 1))
 
+
+/*
+  Allocated messages
+
+  The messages allocated by crtn_mbx_alloc() are preceded by a prefix
+  holding their size class, followed by the link of the message:
+
+       +--------+------+----------
+       | Prefix | Link | Data...
+       +--------+------+----------
+
+  The data sizes are rounded up to power of 2 classes from 16 to
+  4096 bytes. The free messages of a class are chained through their
+  link. They are carved into slabs of CRTN_MSG_SLAB_SZ bytes. The
+  bigger messages are directly allocated with malloc().
+*/
+typedef union
+{
+  int          idx;
+  long double  align1;
+  void        *align2;
+  long long    align3;
+} crtn_msg_pfx_t;
+
+#define CRTN_MSG_NO_CLASS     -1
+#define CRTN_MSG_CLASS_SHIFT  4
+#define CRTN_MSG_CLASSES      9
+#define CRTN_MSG_SLAB_SZ      16384
+
+#define CRTN_MSG_SZ(idx)                                   \
+  (sizeof(crtn_msg_pfx_t) + CRTN_MSG_HDR_SZ +              \
+   ((size_t)1 << (CRTN_MSG_CLASS_SHIFT + (idx))))
+
+#define CRTN_MSG2PFX(msg) \
+  ((crtn_msg_pfx_t *)((char *)(msg) - CRTN_MSG_HDR_SZ - sizeof(crtn_msg_pfx_t)))
+
+#define CRTN_PFX2MSG(pfx) \
+  ((void *)((char *)(pfx) + sizeof(crtn_msg_pfx_t) + CRTN_MSG_HDR_SZ))
+
+static crtn_link_t crtn_msg_free[CRTN_MSG_CLASSES];
+
+#ifdef HAVE_CRTN_MT
+/*
+  Lock of the free lists and of the slabs
+*/
+static crtn_lock_t crtn_msg_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif // HAVE_CRTN_MT
+
+/*
+  Slabs (chained through their first bytes) and number
+  of preallocated messages upon the first allocation in
+  a class (the classes which are not used cost nothing)
+*/
+static void          *crtn_msg_slabs;
+static size_t         crtn_msg_prealloc;
+static unsigned char  crtn_msg_carved[CRTN_MSG_CLASSES];
+
+
+static int crtn_msg_class_idx(size_t size)
+{
+  int i;
+
+  for (i = 0; i < CRTN_MSG_CLASSES; i ++) {
+    if (size <= ((size_t)1 << (CRTN_MSG_CLASS_SHIFT + i))) {
+      return i;
+    }
+  }
+
+  return CRTN_MSG_NO_CLASS;
+
+} // crtn_msg_class_idx
+
+
+/*
+  Carve a new slab into "nb" free messages of class "idx"
+  (at least one message and CRTN_MSG_SLAB_SZ bytes)
+*/
+static int crtn_msg_slab_new(
+                             int    idx,
+                             size_t nb
+                            )
+{
+  char           *slab;
+  size_t          msg_sz = CRTN_MSG_SZ(idx);
+  size_t          i;
+  crtn_msg_pfx_t *pfx;
+
+  // The slab holds a prefix followed by the messages
+  if (nb > ((SIZE_MAX - sizeof(crtn_msg_pfx_t)) / msg_sz)) {
+    errno = ENOMEM;
+    return -1;
+  }
+
+  if ((nb * msg_sz) < CRTN_MSG_SLAB_SZ) {
+    nb = CRTN_MSG_SLAB_SZ / msg_sz;
+  }
+  if (!nb) {
+    nb = 1;
+  }
+
+  slab = (char *)malloc(sizeof(crtn_msg_pfx_t) + (nb * msg_sz));
+  if (!slab) {
+    return -1;
+  }
+
+  *((void **)slab) = crtn_msg_slabs;
+  crtn_msg_slabs = slab;
+
+  pfx = (crtn_msg_pfx_t *)(slab + sizeof(crtn_msg_pfx_t));
+  for (i = 0; i < nb; i ++) {
+    pfx->idx = idx;
+    CRTN_LIST_ADD_TAIL(&(crtn_msg_free[idx]), ((crtn_link_t *)CRTN_PFX2MSG(pfx)) - 1);
+    pfx = (crtn_msg_pfx_t *)((char *)pfx + msg_sz);
+  }
+
+  return 0;
+
+} // crtn_msg_slab_new
+
+
 void *crtn_mbx_alloc(
                      size_t size
                     )
 {
-  crtn_link_t *p;
+  crtn_msg_pfx_t *pfx;
+  crtn_link_t    *link;
+  int             idx;
+
+  idx = crtn_msg_class_idx(size);
+
+  // Big message
+  if (CRTN_MSG_NO_CLASS == idx) {
+    pfx = (crtn_msg_pfx_t *)malloc(sizeof(crtn_msg_pfx_t) + CRTN_MSG_HDR_SZ + size);
+    if (!pfx) {
+      crtn_set_errno(ENOMEM);
+      return (void *)0;
+    }
+    pfx->idx = CRTN_MSG_NO_CLASS;
+    return CRTN_PFX2MSG(pfx);
+  }
 
-  p = (void *)malloc(CRTN_MSG_HDR_SZ + size);
+  CRTN_LOCK(&crtn_msg_lock);
+
+  // Refill the free list if needed (the first slab of the
+  // class holds the preallocated messages if possible)
+  if (CRTN_LIST_EMPTY(&(crtn_msg_free[idx]))) {
+    if ((crtn_msg_carved[idx] || !crtn_msg_prealloc ||
+         (0 != crtn_msg_slab_new(idx, crtn_msg_prealloc))) &&
+        (0 != crtn_msg_slab_new(idx, 0))) {
+      CRTN_UNLOCK(&crtn_msg_lock);
+      crtn_set_errno(ENOMEM);
+      return (void *)0;
+    }
+    crtn_msg_carved[idx] = 1;
+  }
+
+  link = CRTN_LIST_FRONT(&(crtn_msg_free[idx]));
+  CRTN_LIST_DEL(link);
 
-  return (void *)(p + 1);
+  CRTN_UNLOCK(&crtn_msg_lock);
+
+  return (void *)(link + 1);
 
 } // crtn_mbx_alloc
 
@@ -253,16 +869,27 @@ int crtn_mbx_free(
                    void *msg
                   )
 {
-  crtn_link_t *p;
+  crtn_msg_pfx_t *pfx;
+  crtn_link_t    *link;
 
   if (!msg) {
     crtn_set_errno(EINVAL);
     return -1;
   }
 
-  p = ((crtn_link_t *)msg) - 1;
+  pfx = CRTN_MSG2PFX(msg);
+
+  if (CRTN_MSG_NO_CLASS == pfx->idx) {
+    free(pfx);
+    return 0;
+  }
 
-  free(p);
+  // Back into the free list of the class (LIFO to reuse
+  // the most recently used, probably cached, messages)
+  link = ((crtn_link_t *)msg) - 1;
+  CRTN_LOCK(&crtn_msg_lock);
+  CRTN_LIST_ADD_FRONT(&(crtn_msg_free[pfx->idx]), link);
+  CRTN_UNLOCK(&crtn_msg_lock);
 
   return 0;
 
@@ -305,16 +932,42 @@ void *crtn_mbx_format(
 
 void crtn_lib_mbx_init(void)
 {
+  size_t i;
+
   crtn_get_size_env("CRTN_MBX_MAX", &crtn_mbx_max, CRTN_MBX_MAX);
   crtn_mbx = (struct crtn_mbx_t *)malloc(crtn_mbx_max * sizeof(struct crtn_mbx_t));
   if (!crtn_mbx) {
     fprintf(stderr, "malloc(%zu): %m (%d)\n", crtn_mbx_max * sizeof(crtn_mbx_t), errno);
     return;
   }
+
+  // Chain the free mailboxes in ascending order
+  for (i = 0; i < crtn_mbx_max; i ++) {
+    CRTN_LOCK_INIT(&(crtn_mbx[i].lock));
+    crtn_mbx[i].busy = 0;
+    crtn_mbx[i].next_free = ((i + 1) < crtn_mbx_max ? (int)(i + 1) : -1);
+  }
+  crtn_mbx_free_ids = 0;
+
+  // Free lists of messages with optional preallocation
+  // upon the first allocation in each class
+  crtn_get_count_env("CRTN_MBX_PREALLOC", &crtn_msg_prealloc, CRTN_MBX_PREALLOC);
+  for (i = 0; i < CRTN_MSG_CLASSES; i ++) {
+    CRTN_LIST_INIT(&(crtn_msg_free[i]));
+    crtn_msg_carved[i] = 0;
+  }
 } // crtn_lib_mbx_init
 
 
 void crtn_lib_mbx_exit(void)
 {
+  void *slab;
+
   free(crtn_mbx);
+
+  while (crtn_msg_slabs) {
+    slab = crtn_msg_slabs;
+    crtn_msg_slabs = *((void **)slab);
+    free(slab);
+  }
 } // crtn_lib_mbx_exit
@@ -0,0 +1,98 @@
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+// File        : crtn_mt.c
+// Description : Thread local data of the multithreaded mode
+// License     :
+//
+//  Copyright (C) 2021 Rachid Koucha <rachid dot koucha at gmail dot com>
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2.1 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to:
+//  the Free Software Foundation, Inc.,
+//  51 Franklin Street, Fifth Floor,
+//  Boston, MA  02110-1301  USA
+//
+//
+// Evolutions  :
+//
+//     17-Oct-2026 agent          - Creation
+//
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+#include "../config.h"
+
+#include "crtn.h"
+#include "crtn_ccb.h"
+
+
+
+/*
+  A coroutine suspended by a thread may be resumed by another one.
+  The thread local variables are accessed through functions defined
+  in this separate file: the compiler can't cache their address
+  (computed from the thread pointer) across a context switch.
+*/
+
+/*
+  Running CCB
+*/
+static __thread crtn_ccb_t *crtn_mt_current;
+
+/*
+  Idle context of the thread
+*/
+static __thread crtn_ccb_t *crtn_mt_idle;
+
+/*
+  Run queue of the thread
+*/
+static __thread struct crtn_rq *crtn_mt_rq;
+
+/*
+  Coroutine giving the processor in the ongoing context switch
+*/
+static __thread crtn_ccb_t *crtn_mt_prev;
+
+/*
+  Coroutine to resume from the idle context (cf. crtn_switch())
+*/
+static __thread crtn_ccb_t *crtn_mt_resume;
+
+
+crtn_ccb_t **crtn_current_ptr(void)
+{
+  return &crtn_mt_current;
+} // crtn_current_ptr
+
+
+crtn_ccb_t **crtn_idle_ptr(void)
+{
+  return &crtn_mt_idle;
+} // crtn_idle_ptr
+
+
+struct crtn_rq **crtn_rq_ptr(void)
+{
+  return &crtn_mt_rq;
+} // crtn_rq_ptr
+
+
+crtn_ccb_t **crtn_prev_ptr(void)
+{
+  return &crtn_mt_prev;
+} // crtn_prev_ptr
+
+
+crtn_ccb_t **crtn_resume_ptr(void)
+{
+  return &crtn_mt_resume;
+} // crtn_resume_ptr
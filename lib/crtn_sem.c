@@ -33,10 +33,12 @@
 #include <sys/types.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <assert.h>
 
 #include "crtn.h"
 #include "crtn_list.h"
 #include "crtn_ccb.h"
+#include "crtn_timer.h"
 
 
 
@@ -44,7 +46,11 @@ static size_t crtn_sem_max;
 
 static struct crtn_sem_t
 {
+#ifdef HAVE_CRTN_MT
+  crtn_lock_t  lock; // Counter and waiting coroutines
+#endif // HAVE_CRTN_MT
   int          busy;
+  int          next_free;
   unsigned int counter;
   crtn_link_t  crtns;
 } *crtn_sem;
@@ -54,40 +60,70 @@ static struct crtn_sem_t
   Number of active semaphores
 */
 static int crtn_sem_nb;
-static int crtn_next_free_semid;
+
+/*
+  Stack of free semaphores (chained through their "next_free" field)
+*/
+static int crtn_sem_free_ids = -1;
+
+#ifdef HAVE_CRTN_MT
+/*
+  Lock of the allocation of the semaphores
+*/
+static crtn_lock_t crtn_sem_tab_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif // HAVE_CRTN_MT
 
 
 static crtn_sem_t crtn_get_semid(void)
 {
   int i;
-  int count = crtn_sem_max;
-
-  for (i = crtn_next_free_semid; count; count --, i = (i + 1) % crtn_sem_max) {
-    if (!(crtn_sem[i].busy)) {
-      // Mark the context busy
-      crtn_sem[i].busy = 1;
-      CRTN_LIST_INIT(&(crtn_sem[i].crtns));
-      crtn_sem[i].counter = 0;
-      crtn_next_free_semid = (i + 1) % crtn_sem_max;
-      crtn_sem_nb ++;
-      return i;
-    }
+
+  CRTN_LOCK(&crtn_sem_tab_lock);
+
+  if (crtn_sem_free_ids < 0) {
+    CRTN_UNLOCK(&crtn_sem_tab_lock);
+    crtn_set_errno(EAGAIN);
+    return -1;
   }
 
-  crtn_set_errno(EAGAIN);
-  return -1;
+  // Pop the first free semaphore
+  i = crtn_sem_free_ids;
+  crtn_sem_free_ids = crtn_sem[i].next_free;
+
+  // Mark the context busy
+  crtn_sem[i].busy = 1;
+  CRTN_LIST_INIT(&(crtn_sem[i].crtns));
+  crtn_sem[i].counter = 0;
+  crtn_sem_nb ++;
+
+  CRTN_UNLOCK(&crtn_sem_tab_lock);
+
+  return i;
 
 } // crtn_get_semid
 
 
-static void crtn_free_semid(crtn_sem_t sem)
+static int crtn_free_semid(crtn_sem_t sem)
 {
 
+  CRTN_LOCK(&crtn_sem_tab_lock);
+
+  if (!(crtn_sem[sem].busy)) {
+    CRTN_UNLOCK(&crtn_sem_tab_lock);
+    crtn_set_errno(EINVAL);
+    return -1;
+  }
+
   crtn_sem[sem].busy = 0;
-  crtn_next_free_semid = sem;
+  crtn_sem[sem].next_free = crtn_sem_free_ids;
+  crtn_sem_free_ids = sem;
   crtn_sem_nb --;
 
-} // crtn_free_mbxid
+  CRTN_UNLOCK(&crtn_sem_tab_lock);
+
+  return 0;
+
+} // crtn_free_semid
 
 
 int crtn_sem_new(
@@ -122,69 +158,182 @@ int crtn_sem_delete(crtn_sem_t sem)
     return -1;
   }
 
-  crtn_free_semid(sem);
-
-  return 0;
+  return crtn_free_semid(sem);
 } // crtn_sem_delete
 
 
+/*
+  Release a token: if coroutines are waiting, the token is directly
+  handed off to the oldest one which is made runnable. Otherwise,
+  the counter is incremented
+*/
+static void crtn_sem_release(struct crtn_sem_t *psem)
+{
+  crtn_link_t *link;
+  crtn_ccb_t  *ccb;
+
+  while ((link = CRTN_LIST_FRONT(&(psem->crtns)))) {
+    CRTN_LIST_DEL(link);
+    ccb = CRTN_LINK2CCB(link);
+
+    // The coroutine may have been woken up by its timer or
+    // its canceller in the meantime
+    if (!CRTN_CLAIM(ccb)) {
+      continue;
+    }
+
+    ccb->handoff = psem;
+    crtn_make_runnable(link);
+    return;
+  }
+
+  psem->counter ++;
+
+} // crtn_sem_release
+
+
+/*
+  A coroutine blocked in crtn_sem_p() is cancelled: if it was
+  handed off the token, the latter is released again
+*/
+static void crtn_sem_cancel(crtn_ccb_t *ccb)
+{
+  if (ccb->handoff) {
+    crtn_sem_release((struct crtn_sem_t *)(ccb->wait_obj));
+    ccb->handoff = 0;
+  }
+
+  ccb->wait_obj = 0;
+
+} // crtn_sem_cancel
+
+
 int crtn_sem_v(
                 crtn_sem_t sem
                )
 {
-  crtn_link_t *link;
+  struct crtn_sem_t *psem;
 
   if (sem < 0 || (size_t)sem >= crtn_sem_max) {
     crtn_set_errno(EINVAL);
     return -1;
   }
 
-  if (crtn_sem[sem].counter ++ == 0) {
-
-    // Wake up the coroutines waiting
-    // on the semaphore if any
-    link = CRTN_LIST_FRONT(&(crtn_sem[sem].crtns));
-    if (link) {
-      do {
-        CRTN_LIST_DEL(link);
-        crtn_make_runnable(link);
-        link = CRTN_LIST_FRONT(&(crtn_sem[sem].crtns));
-      } while (link);
-    }
-  }
+  psem = &(crtn_sem[sem]);
+
+  CRTN_LOCK(&(psem->lock));
+
+  // Wake up only one waiting coroutine (if any)
+  crtn_sem_release(psem);
+
+  CRTN_UNLOCK(&(psem->lock));
 
   return 0;
 } // crtn_sem_v
 
 
-int crtn_sem_p(
-               crtn_sem_t sem
-              )
+static int crtn_sem_p_internal(
+                               crtn_sem_t  sem,
+                               crtn_time_t timeout
+                              )
 {
+  struct crtn_sem_t *psem;
+  crtn_ccb_t        *ccb;
+  int                timedout;
+
   if (sem < 0 || (size_t)sem >= crtn_sem_max) {
     crtn_set_errno(EINVAL);
     return -1;
   }
 
-  while (crtn_sem[sem].counter == 0) {
-    crtn_make_waiting(&(crtn_sem[sem].crtns), &(crtn_current->link));
-    crtn_yield(0);
+  psem = &(crtn_sem[sem]);
+
+  CRTN_LOCK(&(psem->lock));
+
+  // The counter is positive only when nobody waits
+  if (psem->counter) {
+    psem->counter --;
+    CRTN_UNLOCK(&(psem->lock));
+    return 0;
+  }
+
+  if (0 == timeout) {
+    CRTN_UNLOCK(&(psem->lock));
+    crtn_set_errno(ETIMEDOUT);
+    return -1;
   }
 
-  crtn_sem[sem].counter --;
+  // Wait for the token: crtn_sem_v() hands it off
+  // to the waiting coroutines in FIFO order
+  ccb = crtn_current;
+  ccb->wait_obj = psem;
+  ccb->handoff = 0;
+  ccb->cancel_hook = crtn_sem_cancel;
+  crtn_make_waiting(&(psem->crtns), &(ccb->link));
+  CRTN_SET_WAIT_LOCK(ccb, &(psem->lock));
+  crtn_timer_start(ccb, timeout);
+  CRTN_UNLOCK(&(psem->lock));
+  crtn_suspend();
+
+  // The coroutine may resume on another thread
+  ccb = crtn_current;
+  ccb->handoff = ccb->wait_obj = 0;
+  ccb->cancel_hook = 0;
+  CRTN_SET_WAIT_LOCK(ccb, 0);
+
+  // The timeout elapsed before the release of a token
+  timedout = (ccb->flags & CRTN_CCB_FLAG_TIMEDOUT);
+  CRTN_FLAG_CLR(ccb, CRTN_CCB_FLAG_TIMEDOUT);
+
+  if (timedout) {
+    crtn_set_errno(ETIMEDOUT);
+    return -1;
+  }
 
   return 0;
+} // crtn_sem_p_internal
+
+
+int crtn_sem_p(
+               crtn_sem_t sem
+              )
+{
+  return crtn_sem_p_internal(sem, CRTN_TIME_INFINITE);
 } // crtn_sem_p
 
 
+int crtn_sem_timedp(
+                    crtn_sem_t  sem,
+                    crtn_time_t timeout
+                   )
+{
+  if (timeout < 0) {
+    crtn_set_errno(EINVAL);
+    return -1;
+  }
+
+  return crtn_sem_p_internal(sem, timeout);
+} // crtn_sem_timedp
+
+
 void crtn_lib_sem_init(void)
 {
+  size_t i;
+
   crtn_get_size_env("CRTN_SEM_MAX", &crtn_sem_max, CRTN_SEM_MAX);
   crtn_sem = (struct crtn_sem_t *)malloc(crtn_sem_max * sizeof(struct crtn_sem_t));
   if (!crtn_sem) {
     fprintf(stderr, "malloc(%zu): %m (%d)\n", crtn_sem_max * sizeof(crtn_sem_t), errno);
     return;
   }
+
+  // Chain the free semaphores in ascending order
+  for (i = 0; i < crtn_sem_max; i ++) {
+    CRTN_LOCK_INIT(&(crtn_sem[i].lock));
+    crtn_sem[i].busy = 0;
+    crtn_sem[i].next_free = ((i + 1) < crtn_sem_max ? (int)(i + 1) : -1);
+  }
+  crtn_sem_free_ids = 0;
 } // crtn_lib_sem_init
 
 
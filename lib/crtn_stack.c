@@ -0,0 +1,504 @@
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+// File        : crtn_stack.c
+// Description : Stack allocation
+// License     :
+//
+//  Copyright (C) 2021 Rachid Koucha <rachid dot koucha at gmail dot com>
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2.1 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to:
+//  the Free Software Foundation, Inc.,
+//  51 Franklin Street, Fifth Floor,
+//  Boston, MA  02110-1301  USA
+//
+// Evolutions  :
+//
+//     17-Oct-2026 agent          - Creation
+//
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+#include "../config.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/mman.h>
+
+#include "crtn.h"
+#include "crtn_ccb.h"
+#include "crtn_stack.h"
+
+
+/*
+  The stacks are cached by size classes counted in pages: the
+  first CRTN_STACK_CLASS_PAGES classes contain the stacks of 1, 2...
+  CRTN_STACK_CLASS_PAGES pages. Beyond, each power of 2 is divided
+  into CRTN_STACK_CLASS_STEPS classes (i.e. a size is rounded up by
+  less than 1/CRTN_STACK_CLASS_STEPS) over CRTN_STACK_CLASS_SHIFTS
+  powers of 2. The bigger stacks are not cached. There is one set
+  of classes per allocation mode.
+*/
+#define CRTN_STACK_CLASS_PAGES  16
+#define CRTN_STACK_CLASS_STEPS  8
+#define CRTN_STACK_CLASS_SHIFTS 8
+#define CRTN_STACK_CLASSES      (CRTN_STACK_CLASS_PAGES + \
+                                 CRTN_STACK_CLASS_STEPS * CRTN_STACK_CLASS_SHIFTS)
+#define CRTN_STACK_MODES        3
+
+static struct crtn_stack_class_t
+{
+  char   *free;
+  size_t  nb;
+} crtn_stack_class[CRTN_STACK_MODES][CRTN_STACK_CLASSES];
+
+
+/*
+  Maximum/current number of cached stacks
+*/
+static size_t crtn_stack_cache_max;
+static size_t crtn_stack_cache_nb;
+
+#ifdef HAVE_CRTN_MT
+/*
+  Lock of the cache (and of the installation of the SIGSEGV handler)
+*/
+static crtn_lock_t crtn_stack_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif // HAVE_CRTN_MT
+
+
+/*
+  Size of the guard pages
+*/
+static size_t crtn_stack_page_sz;
+
+
+/*
+  Minimum size of the lazily committed stacks
+*/
+static size_t crtn_stack_lazy_sz;
+
+
+/*
+  SIGSEGV handler reporting the stack overflows
+*/
+static int crtn_stack_segv_installed;
+static struct sigaction crtn_stack_segv_old;
+
+/*
+  The alternate signal stack is per thread: the flag is set once the
+  thread has one (its own or the one allocated by the library)
+*/
+#ifdef HAVE_CRTN_MT
+static __thread int crtn_stack_altstack_set;
+static __thread char *crtn_stack_altstack;
+#else
+static int crtn_stack_altstack_set;
+static char *crtn_stack_altstack;
+#endif // HAVE_CRTN_MT
+
+
+/*
+  The free stacks are chained through the last bytes of their
+  area (the location of the CCB when the stack is used)
+*/
+#define CRTN_STACK_NEXT(s, sz) (*(char **)((s) + (sz) - sizeof(char *)))
+
+
+static int crtn_stack_class_idx(size_t size)
+{
+  size_t pages;
+  size_t base;
+  int    shift;
+
+  pages = (size + crtn_stack_page_sz - 1) / crtn_stack_page_sz;
+
+  if (pages <= CRTN_STACK_CLASS_PAGES) {
+    return (pages ? (int)pages - 1 : 0);
+  }
+
+  // Power of 2 such that: base < pages <= 2 * base
+  for (shift = 0, base = CRTN_STACK_CLASS_PAGES;
+       shift < CRTN_STACK_CLASS_SHIFTS;
+       shift ++, base <<= 1) {
+    if (pages <= 2 * base) {
+      return CRTN_STACK_CLASS_PAGES + (shift * CRTN_STACK_CLASS_STEPS) +
+             (int)((pages - base + (base / CRTN_STACK_CLASS_STEPS) - 1) / (base / CRTN_STACK_CLASS_STEPS)) - 1;
+    }
+  }
+
+  return -1;
+
+} // crtn_stack_class_idx
+
+
+static size_t crtn_stack_class_size(int idx)
+{
+  size_t base;
+
+  if (idx < CRTN_STACK_CLASS_PAGES) {
+    return (size_t)(idx + 1) * crtn_stack_page_sz;
+  }
+
+  idx -= CRTN_STACK_CLASS_PAGES;
+  base = (size_t)CRTN_STACK_CLASS_PAGES << (idx / CRTN_STACK_CLASS_STEPS);
+
+  return (base + ((size_t)(idx % CRTN_STACK_CLASS_STEPS) + 1) * (base / CRTN_STACK_CLASS_STEPS)) * crtn_stack_page_sz;
+
+} // crtn_stack_class_size
+
+
+// Async-signal-safe display of a string
+static void crtn_stack_write(const char *str)
+{
+  ssize_t rc;
+
+  rc = write(2, str, strlen(str));
+  (void)rc;
+
+} // crtn_stack_write
+
+
+static void crtn_stack_segv(
+                            int        sig,
+                            siginfo_t *info,
+                            void      *uctx
+                           )
+{
+  crtn_ccb_t *ccb = crtn_current;
+  char       *addr = (char *)(info->si_addr);
+  char        buf[24];
+  char       *p;
+  unsigned long long cid;
+
+  // Is the fault in the guard page of the current coroutine ?
+  if (ccb &&
+      ccb->stack &&
+      !(ccb->attr.type & CRTN_TYPE_STACKLESS) &&
+      ((CRTN_STACK_GUARD == ccb->attr.stack_mode) ||
+       (CRTN_STACK_LAZY == ccb->attr.stack_mode)) &&
+      (addr >= (ccb->stack - crtn_stack_page_sz)) &&
+      (addr < ccb->stack)) {
+
+    p = buf + sizeof(buf);
+    *(--p) = '\0';
+    cid = (unsigned long long)(ccb->cid);
+    do {
+      *(--p) = (char)('0' + (cid % 10));
+      cid /= 10;
+    } while (cid);
+
+    crtn_stack_write("crtn: stack overflow in coroutine '");
+    crtn_stack_write(ccb->name);
+    crtn_stack_write("' (cid ");
+    crtn_stack_write(p);
+    crtn_stack_write(")\n");
+  }
+
+  // Chain to the previous handler
+  if (crtn_stack_segv_old.sa_flags & SA_SIGINFO) {
+    crtn_stack_segv_old.sa_sigaction(sig, info, uctx);
+  } else if ((SIG_DFL == crtn_stack_segv_old.sa_handler) ||
+             (SIG_IGN == crtn_stack_segv_old.sa_handler)) {
+    // The fault will be raised again upon return with the default action
+    sigaction(SIGSEGV, &crtn_stack_segv_old, 0);
+  } else {
+    crtn_stack_segv_old.sa_handler(sig);
+  }
+
+} // crtn_stack_segv
+
+
+/*
+  Set an alternate signal stack for the calling thread
+*/
+int crtn_stack_altstack_install(void)
+{
+  stack_t ss;
+
+  if (crtn_stack_altstack_set) {
+    return 0;
+  }
+
+  // Keep the alternate stack of the application if any
+  if (0 != sigaltstack(0, &ss)) {
+    crtn_set_errno(errno);
+    return -1;
+  }
+
+  if (ss.ss_flags & SS_DISABLE) {
+    ss.ss_size = SIGSTKSZ;
+    crtn_stack_altstack = (char *)malloc(ss.ss_size);
+    if (!crtn_stack_altstack) {
+      crtn_set_errno(errno);
+      return -1;
+    }
+    ss.ss_sp = crtn_stack_altstack;
+    ss.ss_flags = 0;
+    if (0 != sigaltstack(&ss, 0)) {
+      crtn_set_errno(errno);
+      free(crtn_stack_altstack);
+      crtn_stack_altstack = (char *)0;
+      return -1;
+    }
+  }
+
+  crtn_stack_altstack_set = 1;
+
+  return 0;
+
+} // crtn_stack_altstack_install
+
+
+/*
+  Free the alternate signal stack of the calling thread
+  (if allocated by the library)
+*/
+void crtn_stack_altstack_free(void)
+{
+  stack_t ss;
+
+  if (crtn_stack_altstack) {
+    memset(&ss, 0, sizeof(ss));
+    ss.ss_flags = SS_DISABLE;
+    sigaltstack(&ss, 0);
+    free(crtn_stack_altstack);
+    crtn_stack_altstack = (char *)0;
+  }
+
+  crtn_stack_altstack_set = 0;
+
+} // crtn_stack_altstack_free
+
+
+/*
+  The SIGSEGV handler runs on an alternate stack as the
+  stack of the faulting coroutine is exhausted (the other
+  threads set theirs when they start, cf. crtn_worker())
+*/
+static int crtn_stack_segv_install(void)
+{
+  struct sigaction sa;
+
+  if (0 != crtn_stack_altstack_install()) {
+    return -1;
+  }
+
+  CRTN_LOCK(&crtn_stack_lock);
+
+  if (crtn_stack_segv_installed) {
+    CRTN_UNLOCK(&crtn_stack_lock);
+    return 0;
+  }
+
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_sigaction = crtn_stack_segv;
+  sa.sa_flags = SA_SIGINFO | SA_ONSTACK;
+  sigemptyset(&(sa.sa_mask));
+  if (0 != sigaction(SIGSEGV, &sa, &crtn_stack_segv_old)) {
+    crtn_set_errno(errno);
+    CRTN_UNLOCK(&crtn_stack_lock);
+    return -1;
+  }
+
+  crtn_stack_segv_installed = 1;
+
+  CRTN_UNLOCK(&crtn_stack_lock);
+
+  return 0;
+
+} // crtn_stack_segv_install
+
+
+char *crtn_stack_alloc(
+                       size_t       *size,
+                       unsigned int  mode
+                      )
+{
+  int    idx;
+  char  *stack;
+  int    flags;
+
+  // The lazily committed stacks are big virtual areas
+  if ((CRTN_STACK_LAZY == mode) && (*size < crtn_stack_lazy_sz)) {
+    *size = crtn_stack_lazy_sz;
+  }
+
+  idx = crtn_stack_class_idx(*size);
+
+  if (idx >= 0) {
+
+    // The size is rounded up to the size of the class
+    *size = crtn_stack_class_size(idx);
+
+    // Recycle a cached stack if any
+    CRTN_LOCK(&crtn_stack_lock);
+    stack = crtn_stack_class[mode][idx].free;
+    if (stack) {
+      crtn_stack_class[mode][idx].free = CRTN_STACK_NEXT(stack, *size);
+      crtn_stack_class[mode][idx].nb --;
+      crtn_stack_cache_nb --;
+      CRTN_UNLOCK(&crtn_stack_lock);
+      return stack;
+    }
+    CRTN_UNLOCK(&crtn_stack_lock);
+  }
+
+  switch(mode) {
+
+    case CRTN_STACK_GUARD:
+    case CRTN_STACK_LAZY: {
+
+      if (0 != crtn_stack_segv_install()) {
+        return (char *)0;
+      }
+
+      // No swap space is reserved for the lazily committed stacks:
+      // the pages are committed by the kernel upon first access
+      flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK;
+      if (CRTN_STACK_LAZY == mode) {
+        flags |= MAP_NORESERVE;
+      }
+
+      // The guard page is at the lowest address as the stack grows downward
+      stack = (char *)mmap(0, *size + crtn_stack_page_sz,
+                           PROT_READ | PROT_WRITE,
+                           flags,
+                           -1, 0);
+      if (MAP_FAILED == stack) {
+        crtn_set_errno(errno);
+        return (char *)0;
+      }
+
+      if (0 != mprotect(stack, crtn_stack_page_sz, PROT_NONE)) {
+        crtn_set_errno(errno);
+        munmap(stack, *size + crtn_stack_page_sz);
+        return (char *)0;
+      }
+
+      stack += crtn_stack_page_sz;
+    }
+    break;
+
+    case CRTN_STACK_MALLOC:
+    default: {
+      stack = (char *)malloc(*size);
+      if (!stack) {
+        crtn_set_errno(errno);
+        return (char *)0;
+      }
+    }
+    break;
+  }
+
+  return stack;
+
+} // crtn_stack_alloc
+
+
+static void crtn_stack_release(
+                               char         *stack,
+                               size_t        size,
+                               unsigned int  mode
+                              )
+{
+  switch(mode) {
+
+    case CRTN_STACK_GUARD:
+    case CRTN_STACK_LAZY: {
+      munmap(stack - crtn_stack_page_sz, size + crtn_stack_page_sz);
+    }
+    break;
+
+    case CRTN_STACK_MALLOC:
+    default: {
+      free(stack);
+    }
+    break;
+  }
+
+} // crtn_stack_release
+
+
+void crtn_stack_free(
+                     char         *stack,
+                     size_t        size,
+                     unsigned int  mode
+                    )
+{
+  int idx;
+
+  idx = crtn_stack_class_idx(size);
+
+  CRTN_LOCK(&crtn_stack_lock);
+
+  // Keep the stack in the cache if there is room for it
+  if ((idx >= 0) && (crtn_stack_cache_nb < crtn_stack_cache_max)) {
+
+    // Give back the pages committed by the peak usage of a lazily
+    // committed stack (except the last one where the CCB and the
+    // chaining are located)
+    if ((CRTN_STACK_LAZY == mode) && (size > crtn_stack_page_sz)) {
+      (void)madvise(stack, size - crtn_stack_page_sz, MADV_DONTNEED);
+    }
+
+    CRTN_STACK_NEXT(stack, size) = crtn_stack_class[mode][idx].free;
+    crtn_stack_class[mode][idx].free = stack;
+    crtn_stack_class[mode][idx].nb ++;
+    crtn_stack_cache_nb ++;
+    CRTN_UNLOCK(&crtn_stack_lock);
+    return;
+  }
+
+  CRTN_UNLOCK(&crtn_stack_lock);
+
+  crtn_stack_release(stack, size, mode);
+
+} // crtn_stack_free
+
+
+void crtn_lib_stack_init(void)
+{
+  // 0 disables the cache
+  crtn_get_count_env("CRTN_STACK_CACHE", &crtn_stack_cache_max, CRTN_STACK_CACHE);
+  crtn_get_size_env("CRTN_LAZY_STACK_SIZE", &crtn_stack_lazy_sz, CRTN_LAZY_STACK_SIZE);
+
+  // The size classes are based on it
+  crtn_stack_page_sz = (size_t)sysconf(_SC_PAGESIZE);
+} // crtn_lib_stack_init
+
+
+void crtn_lib_stack_exit(void)
+{
+  unsigned int mode;
+  int          i;
+  char        *stack;
+  size_t       size;
+
+  for (mode = 0; mode < CRTN_STACK_MODES; mode ++) {
+    for (i = 0; i < CRTN_STACK_CLASSES; i ++) {
+      size = crtn_stack_class_size(i);
+      while (crtn_stack_class[mode][i].free) {
+        stack = crtn_stack_class[mode][i].free;
+        crtn_stack_class[mode][i].free = CRTN_STACK_NEXT(stack, size);
+        crtn_stack_release(stack, size, mode);
+      }
+      crtn_stack_class[mode][i].nb = 0;
+    }
+  }
+
+  crtn_stack_cache_nb = 0;
+
+  crtn_stack_altstack_free();
+
+} // crtn_lib_stack_exit
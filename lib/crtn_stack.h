@@ -0,0 +1,56 @@
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+// File        : crtn_stack.h
+// Description : Stack allocation
+// License     :
+//
+//  Copyright (C) 2021 Rachid Koucha <rachid dot koucha at gmail dot com>
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2.1 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to:
+//  the Free Software Foundation, Inc.,
+//  51 Franklin Street, Fifth Floor,
+//  Boston, MA  02110-1301  USA
+//
+//
+// Evolutions  :
+//
+//     17-Oct-2026 agent          - Creation
+//
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+#ifndef CRTN_STACK_H
+#define CRTN_STACK_H
+
+#include <stddef.h>
+
+
+extern char *crtn_stack_alloc(
+                              size_t       *size,
+                              unsigned int  mode
+                             );
+
+extern void crtn_stack_free(
+                            char         *stack,
+                            size_t        size,
+                            unsigned int  mode
+                           );
+
+extern int crtn_stack_altstack_install(void);
+
+extern void crtn_stack_altstack_free(void);
+
+extern void crtn_lib_stack_init(void);
+
+extern void crtn_lib_stack_exit(void);
+
+#endif // CRTN_STACK_H
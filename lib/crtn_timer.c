@@ -0,0 +1,436 @@
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+// File        : crtn_timer.c
+// Description : Timers of the blocking services
+// License     :
+//
+//  Copyright (C) 2021 Rachid Koucha <rachid dot koucha at gmail dot com>
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2.1 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to:
+//  the Free Software Foundation, Inc.,
+//  51 Franklin Street, Fifth Floor,
+//  Boston, MA  02110-1301  USA
+//
+// Evolutions  :
+//
+//     17-Oct-2026 agent          - Creation
+//
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+
+#include "../config.h"
+#include <errno.h>
+#include <time.h>
+
+#include "crtn.h"
+#include "crtn_ccb.h"
+#include "crtn_list.h"
+#include "crtn_timer.h"
+
+
+/*
+  Hierarchical timer wheel
+
+  The time is divided into ticks of (1 << CRTN_WHEEL_TICK_SHIFT)
+  nanoseconds (about 1 ms). The wheel is made of CRTN_WHEEL_LEVELS
+  levels of CRTN_WHEEL_SLOTS slots. A timer expiring in less than
+  CRTN_WHEEL_SLOTS ticks is linked into the slot of its tick in level
+  0. A farther timer is linked into level 'n' according to bits
+  [6n, 6n + 6[ of its expiration tick. Each time the level 'n' wraps
+  around, the next slot of level 'n + 1' is cascaded (its timers are
+  linked again into the lower levels). Hence, the arming, disarming
+  and expiration of a timer are done in constant time.
+
+  The timers beyond the last level are linked into its last slot and
+  cascaded again until they get close enough.
+
+  The bitmaps of the levels flag the slots which may not be empty
+  (they are updated lazily upon the disarming of the timers).
+*/
+#define CRTN_WHEEL_TICK_SHIFT  20
+#define CRTN_WHEEL_BITS        6
+#define CRTN_WHEEL_SLOTS       (1 << CRTN_WHEEL_BITS)
+#define CRTN_WHEEL_MASK        (CRTN_WHEEL_SLOTS - 1)
+#define CRTN_WHEEL_LEVELS      4
+
+static struct crtn_wheel_level_t
+{
+  unsigned long long bitmap;
+  crtn_link_t        slots[CRTN_WHEEL_SLOTS];
+} crtn_wheel[CRTN_WHEEL_LEVELS];
+
+// Next tick to process
+static unsigned long long crtn_wheel_tick;
+
+// Number of armed timers
+static size_t crtn_wheel_nb;
+
+#ifdef HAVE_CRTN_MT
+/*
+  Lock of the timer wheel
+*/
+static crtn_lock_t crtn_timer_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif // HAVE_CRTN_MT
+
+
+#define CRTN_TLINK2CCB(l) ((crtn_ccb_t *)((char *)(l) - offsetof(crtn_ccb_t, tlink)))
+
+// Expiration tick of a deadline (rounded up to never expire in advance)
+#define CRTN_WHEEL_EXP(d) \
+  (((unsigned long long)(d) + (1ULL << CRTN_WHEEL_TICK_SHIFT) - 1) >> CRTN_WHEEL_TICK_SHIFT)
+
+// Index of the slot of tick 't' in level 'l'
+#define CRTN_WHEEL_IDX(t, l) \
+  ((unsigned int)(((t) >> ((l) * CRTN_WHEEL_BITS)) & CRTN_WHEEL_MASK))
+
+
+crtn_time_t crtn_timer_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ((crtn_time_t)(ts.tv_sec) * 1000000000LL) + (crtn_time_t)(ts.tv_nsec);
+
+} // crtn_timer_now
+
+
+static void crtn_wheel_add(crtn_ccb_t *ccb)
+{
+  unsigned long long exp = CRTN_WHEEL_EXP(ccb->deadline);
+  unsigned long long delta;
+  unsigned int       level;
+  unsigned int       idx;
+
+  if (exp < crtn_wheel_tick) {
+    // Late timer: processed with the next tick
+    exp = crtn_wheel_tick;
+  }
+
+  delta = exp - crtn_wheel_tick;
+
+  for (level = 0; level < (CRTN_WHEEL_LEVELS - 1); level ++) {
+    if (delta < (1ULL << ((level + 1) * CRTN_WHEEL_BITS))) {
+      break;
+    }
+  }
+
+  // Too far for the wheel
+  if (delta >= (1ULL << (CRTN_WHEEL_LEVELS * CRTN_WHEEL_BITS))) {
+    exp = crtn_wheel_tick + (1ULL << (CRTN_WHEEL_LEVELS * CRTN_WHEEL_BITS)) - 1;
+  }
+
+  idx = CRTN_WHEEL_IDX(exp, level);
+  CRTN_LIST_ADD_TAIL(&(crtn_wheel[level].slots[idx]), &(ccb->tlink));
+  crtn_wheel[level].bitmap |= (1ULL << idx);
+
+} // crtn_wheel_add
+
+
+/*
+  The suspended coroutine is armed along with its timer: the
+  expiration is one of its wakers (cf. CRTN_CLAIM())
+*/
+void crtn_timer_start_at(
+                         crtn_ccb_t  *ccb,
+                         crtn_time_t  deadline
+                        )
+{
+  CRTN_FLAG_CLR(ccb, CRTN_CCB_FLAG_TIMEDOUT);
+
+  CRTN_LOCK(&crtn_timer_lock);
+
+  ccb->deadline = deadline;
+
+  // The wheel is idle: move it to the current time
+  if (!crtn_wheel_nb) {
+    crtn_wheel_tick = (unsigned long long)crtn_timer_now() >> CRTN_WHEEL_TICK_SHIFT;
+  }
+
+  crtn_wheel_add(ccb);
+  crtn_wheel_nb ++;
+
+  CRTN_ARM(ccb);
+
+  CRTN_UNLOCK(&crtn_timer_lock);
+
+} // crtn_timer_start_at
+
+
+/*
+  The coroutine is only armed if the timeout is infinite
+*/
+void crtn_timer_start(
+                      crtn_ccb_t  *ccb,
+                      crtn_time_t  timeout
+                     )
+{
+  if (CRTN_TIME_INFINITE == timeout) {
+    CRTN_ARM(ccb);
+    return;
+  }
+
+  crtn_timer_start_at(ccb, crtn_timer_now() + timeout);
+} // crtn_timer_start
+
+
+void crtn_timer_stop(crtn_ccb_t *ccb)
+{
+  // Only the coroutine starts its timer: the wheel is not
+  // locked if there is none
+  if (CRTN_TIME_INFINITE == __atomic_load_n(&(ccb->deadline), __ATOMIC_RELAXED)) {
+    return;
+  }
+
+  CRTN_LOCK(&crtn_timer_lock);
+
+  if (CRTN_IS_LINKED(&(ccb->tlink))) {
+    CRTN_LIST_DEL(&(ccb->tlink));
+    crtn_wheel_nb --;
+  }
+  ccb->deadline = CRTN_TIME_INFINITE;
+
+  CRTN_UNLOCK(&crtn_timer_lock);
+
+} // crtn_timer_stop
+
+
+int crtn_timer_pending(void)
+{
+  return (__atomic_load_n(&crtn_wheel_nb, __ATOMIC_RELAXED) != 0);
+} // crtn_timer_pending
+
+
+// Link again the timers of a slot into the lower levels
+static void crtn_wheel_cascade(
+                               unsigned int level,
+                               unsigned int idx
+                              )
+{
+  crtn_link_t  slot;
+  crtn_link_t *link;
+
+  // Detach the content of the slot as the timers may be
+  // linked again into the same slot
+  CRTN_LIST_INIT(&slot);
+  CRTN_LIST_SPLICE_TAIL(&slot, &(crtn_wheel[level].slots[idx]));
+  crtn_wheel[level].bitmap &= ~(1ULL << idx);
+
+  while ((link = CRTN_LIST_FRONT(&slot))) {
+    CRTN_LIST_DEL(link);
+    crtn_wheel_add(CRTN_TLINK2CCB(link));
+  }
+
+} // crtn_wheel_cascade
+
+
+/*
+  The timer of a coroutine elapsed: the coroutine is moved into the
+  "expired" list if the timer is the first of its wakers
+*/
+static void crtn_wheel_expire(
+                              crtn_ccb_t  *ccb,
+                              crtn_link_t *expired
+                             )
+{
+  crtn_wheel_nb --;
+  ccb->deadline = CRTN_TIME_INFINITE;
+
+  if (CRTN_CLAIM(ccb)) {
+    CRTN_LIST_ADD_TAIL(expired, &(ccb->tlink));
+  }
+
+} // crtn_wheel_expire
+
+
+void crtn_timer_expire(void)
+{
+  unsigned long long  now_tick;
+  unsigned int        idx;
+  unsigned int        level;
+  crtn_link_t        *slot;
+  crtn_link_t        *link;
+  crtn_link_t         expired;
+  crtn_ccb_t         *ccb;
+
+  now_tick = (unsigned long long)crtn_timer_now() >> CRTN_WHEEL_TICK_SHIFT;
+
+  CRTN_LIST_INIT(&expired);
+
+  CRTN_LOCK(&crtn_timer_lock);
+
+  while (crtn_wheel_nb && (crtn_wheel_tick <= now_tick)) {
+
+    idx = CRTN_WHEEL_IDX(crtn_wheel_tick, 0);
+
+    // Nothing in level 0: skip to its next wrap around
+    if (idx && !(crtn_wheel[0].bitmap)) {
+      crtn_wheel_tick = (crtn_wheel_tick | CRTN_WHEEL_MASK) + 1;
+      if (crtn_wheel_tick > now_tick) {
+        crtn_wheel_tick = now_tick + 1;
+      }
+      continue;
+    }
+
+    // Level 0 wraps around: cascade the upper levels
+    if (0 == idx) {
+      for (level = 1; level < CRTN_WHEEL_LEVELS; level ++) {
+        crtn_wheel_cascade(level, CRTN_WHEEL_IDX(crtn_wheel_tick, level));
+        if (CRTN_WHEEL_IDX(crtn_wheel_tick, level)) {
+          break;
+        }
+      }
+    }
+
+    // All the timers of the slot are elapsed
+    slot = &(crtn_wheel[0].slots[idx]);
+    while ((link = CRTN_LIST_FRONT(slot))) {
+      CRTN_LIST_DEL(link);
+      crtn_wheel_expire(CRTN_TLINK2CCB(link), &expired);
+    }
+    crtn_wheel[0].bitmap &= ~(1ULL << idx);
+
+    crtn_wheel_tick ++;
+  }
+
+  // No more timers: jump to the current time
+  if (!crtn_wheel_nb && (crtn_wheel_tick <= now_tick)) {
+    crtn_wheel_tick = now_tick + 1;
+  }
+
+  CRTN_UNLOCK(&crtn_timer_lock);
+
+  // The coroutines are woken up out of the lock of the wheel as they
+  // are unlinked from the objects they are waiting on
+  while ((link = CRTN_LIST_FRONT(&expired))) {
+    CRTN_LIST_DEL(link);
+    ccb = CRTN_TLINK2CCB(link);
+    CRTN_FLAG_SET(ccb, CRTN_CCB_FLAG_TIMEDOUT);
+    crtn_wait_abort(ccb);
+  }
+
+} // crtn_timer_expire
+
+
+/*
+  Time until which the process can sleep: the tick of the first non
+  empty slot of level 0 or, if it is earlier, the next wrap around of
+  the lowest non empty upper level (cascade)
+*/
+static crtn_time_t crtn_wheel_next(void)
+{
+  unsigned int        level;
+  unsigned int        idx;
+  unsigned int        slot;
+  unsigned long long  bitmap;
+  unsigned long long  tick;
+  unsigned long long  tick0;
+  unsigned long long  mask;
+
+  // Next cascade (the current tick is not processed yet)
+  for (level = 1; level < (CRTN_WHEEL_LEVELS - 1); level ++) {
+    if (crtn_wheel[level].bitmap) {
+      break;
+    }
+  }
+
+  if (crtn_wheel[level].bitmap) {
+    mask = (1ULL << (level * CRTN_WHEEL_BITS)) - 1;
+    tick = (crtn_wheel_tick + mask) & ~mask;
+  } else {
+    tick = ~0ULL;
+  }
+
+  // Next expiration in level 0
+  idx = CRTN_WHEEL_IDX(crtn_wheel_tick, 0);
+
+  while (crtn_wheel[0].bitmap) {
+
+    // First flagged slot from the current index (rotation of the bitmap)
+    bitmap = crtn_wheel[0].bitmap;
+    bitmap = (bitmap >> idx) | (idx ? (bitmap << (CRTN_WHEEL_SLOTS - idx)) : 0);
+    slot = (idx + (unsigned int)__builtin_ctzll(bitmap)) & CRTN_WHEEL_MASK;
+
+    // Lazy update of the bitmap
+    if (CRTN_LIST_EMPTY(&(crtn_wheel[0].slots[slot]))) {
+      crtn_wheel[0].bitmap &= ~(1ULL << slot);
+      continue;
+    }
+
+    tick0 = crtn_wheel_tick + ((slot - idx) & CRTN_WHEEL_MASK);
+    if (tick0 < tick) {
+      tick = tick0;
+    }
+    break;
+  }
+
+  return (crtn_time_t)(tick << CRTN_WHEEL_TICK_SHIFT);
+
+} // crtn_wheel_next
+
+
+crtn_time_t crtn_timer_next(void)
+{
+  crtn_time_t deadline;
+
+  CRTN_LOCK(&crtn_timer_lock);
+
+  if (!crtn_wheel_nb) {
+    deadline = CRTN_TIME_INFINITE;
+  } else {
+    deadline = crtn_wheel_next();
+  }
+
+  CRTN_UNLOCK(&crtn_timer_lock);
+
+  return deadline;
+} // crtn_timer_next
+
+
+void crtn_timer_idle(void)
+{
+  crtn_time_t      deadline;
+  struct timespec  ts;
+
+  if (!crtn_wheel_nb) {
+    return;
+  }
+
+  // Sleep until the next expiration
+  deadline = crtn_wheel_next();
+  ts.tv_sec = (time_t)(deadline / 1000000000LL);
+  ts.tv_nsec = (long)(deadline % 1000000000LL);
+  while (EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, 0)) {
+  }
+
+  crtn_timer_expire();
+
+} // crtn_timer_idle
+
+
+void crtn_lib_timer_init(void)
+{
+  unsigned int level;
+  unsigned int i;
+
+  for (level = 0; level < CRTN_WHEEL_LEVELS; level ++) {
+    for (i = 0; i < CRTN_WHEEL_SLOTS; i ++) {
+      CRTN_LIST_INIT(&(crtn_wheel[level].slots[i]));
+    }
+    crtn_wheel[level].bitmap = 0;
+  }
+
+  crtn_wheel_tick = ((unsigned long long)crtn_timer_now() >> CRTN_WHEEL_TICK_SHIFT) + 1;
+  crtn_wheel_nb = 0;
+
+} // crtn_lib_timer_init
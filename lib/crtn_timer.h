@@ -0,0 +1,68 @@
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+// File        : crtn_timer.h
+// Description : Timers of the blocking services
+// License     :
+//
+//  Copyright (C) 2021 Rachid Koucha <rachid dot koucha at gmail dot com>
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2.1 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to:
+//  the Free Software Foundation, Inc.,
+//  51 Franklin Street, Fifth Floor,
+//  Boston, MA  02110-1301  USA
+//
+//
+// Evolutions  :
+//
+//     17-Oct-2026 agent          - Creation
+//
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+#ifndef CRTN_TIMER_H
+#define CRTN_TIMER_H
+
+#include "crtn.h"
+#include "crtn_ccb.h"
+
+
+/*
+  Internal timeout value: no timer
+*/
+#define CRTN_TIME_INFINITE ((crtn_time_t)-1)
+
+
+extern crtn_time_t crtn_timer_now(void);
+
+extern void crtn_timer_start(
+                             crtn_ccb_t  *ccb,
+                             crtn_time_t  timeout
+                            );
+
+extern void crtn_timer_start_at(
+                                crtn_ccb_t  *ccb,
+                                crtn_time_t  deadline
+                               );
+
+extern void crtn_timer_stop(crtn_ccb_t *ccb);
+
+extern int crtn_timer_pending(void);
+
+extern void crtn_timer_expire(void);
+
+extern crtn_time_t crtn_timer_next(void);
+
+extern void crtn_timer_idle(void);
+
+extern void crtn_lib_timer_init(void);
+
+#endif // CRTN_TIMER_H
@@ -0,0 +1,137 @@
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+// File        : bench_gen.c
+// Description : Benchmark of the generators (stepper coroutine resumed by
+//               crtn_wait())
+// License     :
+//
+//  Copyright (C) 2021 Rachid Koucha <rachid dot koucha at gmail dot com>
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2.1 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to:
+//  the Free Software Foundation, Inc.,
+//  51 Franklin Street, Fifth Floor,
+//  Boston, MA  02110-1301  USA
+//
+//
+// Evolutions  :
+//
+//     17-Oct-2026 agent          - Creation
+//
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+//
+// Usage: bench_gen [nb_terms]
+//
+// A stepper coroutine generates the terms of the fibonacci sequence
+// (modulo 2^64) like tests/fibonacci.c. The main coroutine gets
+// "nb_terms" terms with crtn_wait(). The number of terms per second
+// and the elapsed time per term (i.e. one crtn_wait() and one
+// crtn_yield()) are displayed.
+//
+//   $ ./bench_gen 10000000
+//
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "crtn.h"
+
+
+
+static int fibonacci(void *param)
+{
+  unsigned long long prev = 0;
+  unsigned long long cur = 1;
+  unsigned long long next;
+
+  (void)param;
+
+  crtn_yield(&prev);
+
+  while (1) {
+    crtn_yield(&cur);
+    next = prev + cur;
+    prev = cur;
+    cur = next;
+  }
+
+  return 0;
+
+} // fibonacci
+
+
+int main(int ac, char *av[])
+{
+  crtn_t               cid;
+  crtn_attr_t          attr;
+  long                 nb = 10000000;
+  long                 i;
+  int                  rc;
+  unsigned long long  *term;
+  unsigned long long   sum = 0;
+  struct timespec      t0, t1;
+  double               ns;
+
+  if (ac > 1) {
+    nb = atol(av[1]);
+  }
+  if (nb <= 0) {
+    fprintf(stderr, "Usage: %s [nb_terms]\n", av[0]);
+    return 1;
+  }
+
+  attr = crtn_attr_new();
+  if (!attr) {
+    return 1;
+  }
+
+  rc = crtn_set_attr_type(attr, CRTN_TYPE_STEPPER);
+  if (rc != 0) {
+    fprintf(stderr, "crtn_set_attr_type(): %s\n", strerror(crtn_errno()));
+    return 1;
+  }
+
+  rc = crtn_spawn(&cid, "fibonacci", fibonacci, 0, attr);
+  if (rc != 0) {
+    fprintf(stderr, "crtn_spawn(): %s\n", strerror(crtn_errno()));
+    return 1;
+  }
+
+  crtn_attr_delete(attr);
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+
+  for (i = 0; i < nb; i ++) {
+    rc = crtn_wait(cid, (void **)&term);
+    if (rc != 0) {
+      fprintf(stderr, "crtn_wait(): %s\n", strerror(crtn_errno()));
+      return 1;
+    }
+    sum += *term;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+
+  ns = (double)(t1.tv_sec - t0.tv_sec) * 1e9 + (double)(t1.tv_nsec - t0.tv_nsec);
+
+  printf("%ld terms (checksum %llu): %.1f ns/term, %.2f Mterms/s\n", nb, sum, ns / (double)nb, (double)nb * 1e3 / ns);
+
+  crtn_cancel(cid);
+  crtn_join(cid, 0);
+
+  return 0;
+
+} // main
@@ -0,0 +1,173 @@
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+// File        : bench_yield.c
+// Description : Benchmark of crtn_yield() with a large number of runnable
+//               coroutines
+// License     :
+//
+//  Copyright (C) 2021 Rachid Koucha <rachid dot koucha at gmail dot com>
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2.1 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to:
+//  the Free Software Foundation, Inc.,
+//  51 Franklin Street, Fifth Floor,
+//  Boston, MA  02110-1301  USA
+//
+// Evolutions  :
+//
+//     17-Oct-2026 agent          - Creation
+//
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+//
+// Usage: bench_yield [nb_coroutines [nb_loops]]
+//
+// Each coroutine yields the processor "nb_loops" times. The elapsed
+// time per context switch and, when the hardware counters are
+// available (perf_event_open()), the number of L1 data cache misses
+// per context switch are displayed.
+//
+// Run it with CRTN_MAX set to at least "nb_coroutines + 1":
+//
+//   $ CRTN_MAX=5000 ./bench_yield 4096 1000
+//
+
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <linux/perf_event.h>
+
+#include "crtn.h"
+
+
+
+static int nb_loops = 1000;
+
+
+static int yielder(void *param)
+{
+  int i;
+
+  (void)param;
+
+  for (i = 0; i < nb_loops; i ++) {
+    crtn_yield(0);
+  }
+
+  return 0;
+
+} // yielder
+
+
+// Counter of the L1 data cache read misses (-1 if not available)
+static int l1d_open(void)
+{
+  struct perf_event_attr pe;
+
+  memset(&pe, 0, sizeof(pe));
+  pe.type = PERF_TYPE_HW_CACHE;
+  pe.size = sizeof(pe);
+  pe.config = PERF_COUNT_HW_CACHE_L1D |
+              (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+              (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  pe.disabled = 1;
+  pe.exclude_kernel = 1;
+  pe.exclude_hv = 1;
+
+  return (int)syscall(SYS_perf_event_open, &pe, 0, -1, -1, 0);
+
+} // l1d_open
+
+
+int main(int ac, char *av[])
+{
+  crtn_t          *cid;
+  int              nb = 4096;
+  int              i;
+  int              rc;
+  int              fd;
+  long long        misses = -1;
+  struct timespec  t0, t1;
+  double           ns;
+  double           nb_switches;
+
+  if (ac > 1) {
+    nb = atoi(av[1]);
+  }
+  if (ac > 2) {
+    nb_loops = atoi(av[2]);
+  }
+  if ((nb <= 0) || (nb_loops <= 0)) {
+    fprintf(stderr, "Usage: %s [nb_coroutines [nb_loops]]\n", av[0]);
+    return 1;
+  }
+
+  cid = (crtn_t *)malloc(nb * sizeof(crtn_t));
+  if (!cid) {
+    return 1;
+  }
+
+  for (i = 0; i < nb; i ++) {
+    rc = crtn_spawn(&(cid[i]), "yielder", yielder, 0, 0);
+    if (rc != 0) {
+      fprintf(stderr, "crtn_spawn(#%d): %s\n", i, strerror(crtn_errno()));
+      return 1;
+    }
+  }
+
+  fd = l1d_open();
+  if (fd >= 0) {
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+
+  for (i = 0; i < nb; i ++) {
+    rc = crtn_join(cid[i], 0);
+    if (rc != 0) {
+      fprintf(stderr, "crtn_join(#%d): %s\n", i, strerror(crtn_errno()));
+      return 1;
+    }
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+
+  if (fd >= 0) {
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    if (sizeof(misses) != read(fd, &misses, sizeof(misses))) {
+      misses = -1;
+    }
+    close(fd);
+  }
+
+  ns = (double)(t1.tv_sec - t0.tv_sec) * 1e9 + (double)(t1.tv_nsec - t0.tv_nsec);
+  nb_switches = (double)nb * (double)(nb_loops + 1);
+
+  printf("%d coroutines, %d loops: %.1f ns/switch", nb, nb_loops, ns / nb_switches);
+  if (misses >= 0) {
+    printf(", %.2f L1D misses/switch\n", (double)misses / nb_switches);
+  } else {
+    printf(", L1D misses not available\n");
+  }
+
+  free(cid);
+
+  return 0;
+
+} // main
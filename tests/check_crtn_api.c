@@ -30,6 +30,11 @@
 #include "../config.h"
 #include <errno.h>
 #include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/wait.h>
 
 #include "crtn.h"
 
@@ -453,7 +458,7 @@ static int entry30(void *p)
 
 static int entry31(void *p)
 {
-  int cid = *((int *)p);
+  crtn_t cid = *((crtn_t *)p);
   int status;
   int rc;
 
@@ -483,7 +488,7 @@ static int entry32(void *p)
 
 static int entry_foo6(void *p)
 {
-  int cid = *((int *)p);
+  crtn_t cid = *((crtn_t *)p);
   int rc;
 
   (void)p;
@@ -537,7 +542,7 @@ static crtn_t cid39;
 static int entry38(void *p)
 {
   int rc;
-  int mycid = crtn_self();
+  crtn_t mycid = crtn_self();
   crtn_attr_t attr;
 
   (void)p;
@@ -715,18 +720,11 @@ int *pvalue;
 
   // main runnable (foo6 --> main)
   // foo6 running
-  // foo6 triggers foo5
-  // foo5 runnable (foo6 --> main --> foo5)
-  // foo6 waiting on foo5 (main --> foo5)
-  // main is running (main --> foo5)
-  rc = crtn_yield(0);
-  ck_assert_int_eq(rc, CRTN_SCHED_OTHER);
-
-  // main runnable
-  // foo5 is running (foo5 --> main)
-  // sub is spawned (foo5 --> main --> sub)
+  // foo6 triggers foo5 which runs immediately
+  // foo6 waiting on foo5 (main)
+  // sub is spawned (main --> sub)
   // foo5 is joining sub (main --> sub)
-
+  // main is running (main --> sub)
   rc = crtn_yield(0);
   ck_assert_int_eq(rc, CRTN_SCHED_OTHER);
 
@@ -852,373 +850,1876 @@ int status;
 END_TEST
 
 
+static int entry50(void *p)
+{
+  sigset_t set;
+  int rc;
 
-#ifdef HAVE_CRTN_MBX
-
-
-// The unitary tests are run in separate processes
-// START_TEST is a "static" definition of a function
-START_TEST(test_crtn_mbx_new)
-
-int rc;
-int i;
-crtn_mbx_t mbx_tab[CRTN_MBX_MAX + 1];
-
-  // ------- Overflow of the maximum number of mailboxes
+  (void)p;
 
-  // One coroutine already allocated for Main
-  for (i = 0; i < CRTN_MBX_MAX; i ++) {
-    rc = crtn_mbx_new(&(mbx_tab[i]));
-    ck_assert_int_eq(rc, 0);
-  }
+  // Block SIGUSR1 in this coroutine only
+  sigemptyset(&set);
+  sigaddset(&set, SIGUSR1);
+  rc = sigprocmask(SIG_BLOCK, &set, 0);
+  ck_assert_int_eq(rc, 0);
 
-  // Maximum number of mailboxes reached
-  rc = crtn_mbx_new(&(mbx_tab[i]));
-  ck_assert_int_eq(rc, -1);
-  ck_assert_int_eq(crtn_errno(), EAGAIN);
+  rc = crtn_yield(0);
+  ck_assert_int_eq(rc, CRTN_SCHED_OTHER);
 
-  for (i = 0; i < (CRTN_MBX_MAX - 1); i ++) {
-    rc = crtn_mbx_delete(mbx_tab[i]);
-    ck_assert_int_eq(rc, 0);
-  }
+  // The signal mask is restored
+  rc = sigprocmask(SIG_BLOCK, 0, &set);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_int_eq(sigismember(&set, SIGUSR1), 1);
 
-END_TEST
+  return 30;
+}
 
 
 // The unitary tests are run in separate processes
 // START_TEST is a "static" definition of a function
-START_TEST(test_crtn_mbx_delete)
+START_TEST(test_crtn_sigmask)
 
 int rc;
-crtn_mbx_t mbx;
+crtn_t cid;
+int status;
+crtn_attr_t attr;
+sigset_t set;
 
-  // -------
+  // ------- Coroutine with its own signal mask
+  attr = crtn_attr_new();
+  ck_assert_ptr_ne(attr, NULL);
 
-  rc = crtn_mbx_new(&mbx);
-  ck_assert_int_eq(rc, 0);
-  rc = crtn_mbx_delete(mbx);
+  rc = crtn_set_attr_sigmask(attr, 1);
   ck_assert_int_eq(rc, 0);
 
-END_TEST
-
+  rc = crtn_spawn(&cid, "foo_50", entry50, 0, attr);
+  ck_assert_int_eq(rc, 0);
 
+  rc = crtn_attr_delete(attr);
+  ck_assert_int_eq(rc, 0);
 
+  // foo_50 blocks SIGUSR1 and yields
+  rc = crtn_yield(0);
+  ck_assert_int_eq(rc, CRTN_SCHED_OTHER);
 
-static int entry_post_01(void *p)
-{
-  void *msg;
-  int rc;
-  crtn_mbx_t mbx = *((crtn_mbx_t *)p);
+  // The signal mask of main is unchanged
+  rc = sigprocmask(SIG_BLOCK, 0, &set);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_int_eq(sigismember(&set, SIGUSR1), 0);
 
-  msg = (void *)0;
-  rc = crtn_mbx_get(mbx, &msg);
+  rc = crtn_join(cid, &status);
   ck_assert_int_eq(rc, 0);
-  ck_assert_ptr_ne(msg, 0);
+  ck_assert_int_eq(status, 30);
 
-  rc = crtn_mbx_free(msg);
+  rc = sigprocmask(SIG_BLOCK, 0, &set);
   ck_assert_int_eq(rc, 0);
+  ck_assert_int_eq(sigismember(&set, SIGUSR1), 0);
 
-  return 5;
-}
+END_TEST
 
 
-// The unitary tests are run in separate processes
-// START_TEST is a "static" definition of a function
-START_TEST(test_crtn_mbx_post)
+static int entry51(void *p)
+{
+  char local;
 
-int rc;
-crtn_mbx_t mbx;
-char *msg;
-crtn_t cid, cid1;
-int status;
+  // Return the location of a local variable in the stack
+  *(unsigned long *)p = (unsigned long)&local;
 
-  // -------
+  return 31;
+}
 
-  rc = crtn_mbx_new(&mbx);
-  ck_assert_int_eq(rc, 0);
 
-  msg = crtn_mbx_alloc(30);
-  ck_assert_ptr_ne(msg, 0);
+// The unitary tests are run in separate processes
+// So, each one starts from scratch
+START_TEST(test_crtn_stack_cache)
 
-  rc = crtn_mbx_post(mbx, msg);
-  ck_assert_int_eq(rc, 0);
+  crtn_t cid;
+  crtn_attr_t attr;
+  int rc;
+  int status;
+  unsigned long p1, p2;
+  size_t page_sz;
 
-  rc = crtn_mbx_delete(mbx);
+  // Spawn/join a stackful coroutine
+  rc = crtn_spawn(&cid, "foo_51", entry51, &p1, 0);
   ck_assert_int_eq(rc, 0);
-
-  rc = crtn_mbx_free(msg);
+  rc = crtn_join(cid, &status);
   ck_assert_int_eq(rc, 0);
+  ck_assert_int_eq(status, 31);
 
-
-  // ------- Post in a mbx on which a coroutine is not waiting yet
-  rc = crtn_mbx_new(&mbx);
+  // A new coroutine gets the recycled stack
+  rc = crtn_spawn(&cid, "foo_51", entry51, &p2, 0);
   ck_assert_int_eq(rc, 0);
-
-  rc = crtn_spawn(&cid, "post_01", entry_post_01, &mbx, 0);
+  rc = crtn_join(cid, &status);
   ck_assert_int_eq(rc, 0);
+  ck_assert_int_eq(status, 31);
 
-  msg = crtn_mbx_alloc(30);
-  ck_assert_ptr_ne(msg, 0);
+  ck_assert_uint_eq(p1, p2);
 
-  rc = crtn_mbx_post(mbx, msg);
-  ck_assert_int_eq(rc, 0);
+  // ------- The sizes are rounded up to a multiple of the page size
+  attr = crtn_attr_new();
+  ck_assert_ptr_ne(attr, NULL);
+  page_sz = (size_t)sysconf(_SC_PAGESIZE);
 
-  rc = crtn_join(cid, &status);
+  rc = crtn_set_attr_stack_size(attr, 5 * page_sz - 100);
   ck_assert_int_eq(rc, 0);
-  ck_assert_int_eq(status, 5);
-
-  rc = crtn_mbx_delete(mbx);
+  rc = crtn_spawn(&cid, "foo_51", entry51, &p1, attr);
   ck_assert_int_eq(rc, 0);
-
-
-  // ------- Post in a mbx on which a coroutine is waiting
-  rc = crtn_mbx_new(&mbx);
+  rc = crtn_join(cid, &status);
   ck_assert_int_eq(rc, 0);
 
-  rc = crtn_spawn(&cid, "post_01", entry_post_01, &mbx, 0);
+  // Same size class
+  rc = crtn_set_attr_stack_size(attr, 5 * page_sz);
   ck_assert_int_eq(rc, 0);
-
-  msg = crtn_mbx_alloc(30);
-  ck_assert_ptr_ne(msg, 0);
-
-  // Make the coroutine wait on the mailbox
-  crtn_yield(0);
-
-  rc = crtn_mbx_post(mbx, msg);
+  rc = crtn_spawn(&cid, "foo_51", entry51, &p2, attr);
   ck_assert_int_eq(rc, 0);
-
   rc = crtn_join(cid, &status);
   ck_assert_int_eq(rc, 0);
-  ck_assert_int_eq(status, 5);
+  ck_assert_uint_eq(p1, p2);
 
-  rc = crtn_mbx_delete(mbx);
+  // Next size class
+  rc = crtn_set_attr_stack_size(attr, 6 * page_sz);
   ck_assert_int_eq(rc, 0);
-
-
-  // ------- Post in a mbx on which 2 coroutines are waiting
-  rc = crtn_mbx_new(&mbx);
+  rc = crtn_spawn(&cid, "foo_51", entry51, &p2, attr);
   ck_assert_int_eq(rc, 0);
-
-  rc = crtn_spawn(&cid, "post_01", entry_post_01, &mbx, 0);
+  rc = crtn_join(cid, &status);
   ck_assert_int_eq(rc, 0);
+  ck_assert(p1 != p2);
 
-  rc = crtn_spawn(&cid1, "post_02", entry_post_01, &mbx, 0);
+  rc = crtn_attr_delete(attr);
   ck_assert_int_eq(rc, 0);
 
-  // Make the coroutines wait on the mailbox (the FIFO scheduler
-  // will start the two coroutines before going back here)
-  crtn_yield(0);
+END_TEST
 
-  msg = crtn_mbx_alloc(30);
-  ck_assert_ptr_ne(msg, 0);
 
-  // This puts the coroutines in the runnable state
-  // One will get the message and the other goes back in waiting state
-  rc = crtn_mbx_post(mbx, msg);
-  ck_assert_int_eq(rc, 0);
+// The unitary tests are run in separate processes
+// So, each one starts from scratch
+START_TEST(test_crtn_stale_cid)
 
-  msg = crtn_mbx_alloc(30);
-  ck_assert_ptr_ne(msg, 0);
+  crtn_t cid, cid1;
+  int rc;
+  int status;
 
-  rc = crtn_mbx_post(mbx, msg);
+  rc = crtn_spawn(&cid, "foo", entry, 0, 0);
+  ck_assert_int_eq(rc, 0);
+  rc = crtn_join(cid, &status);
   ck_assert_int_eq(rc, 0);
 
-  // Launch the coroutines
-  crtn_yield(0);
+  // The new coroutine gets another identifier
+  rc = crtn_spawn(&cid1, "foo", entry, 0, 0);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_int_ne(cid, cid1);
 
+  // The stale identifier is rejected
+  rc = crtn_cancel(cid);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), ENOENT);
   rc = crtn_join(cid, &status);
-  ck_assert_int_eq(rc, 0);
-  ck_assert_int_eq(status, 5);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), ENOENT);
 
   rc = crtn_join(cid1, &status);
   ck_assert_int_eq(rc, 0);
-  ck_assert_int_eq(status, 5);
 
-  rc = crtn_mbx_delete(mbx);
-  ck_assert_int_eq(rc, 0);
+END_TEST
 
 
-  // ------- Post one message at a time in a mbx on which 2 coroutines are waiting
-  rc = crtn_mbx_new(&mbx);
-  ck_assert_int_eq(rc, 0);
+static int recurse52(int depth)
+{
+  volatile char buf[256];
 
-  rc = crtn_spawn(&cid, "post_01", entry_post_01, &mbx, 0);
-  ck_assert_int_eq(rc, 0);
+  buf[0] = (char)depth;
+  if (depth > 0) {
+    return recurse52(depth - 1) + buf[0];
+  }
 
-  rc = crtn_spawn(&cid1, "post_02", entry_post_01, &mbx, 0);
-  ck_assert_int_eq(rc, 0);
+  return buf[0];
+}
 
-  // Make the coroutines wait on the mailbox (the FIFO scheduler
-  // will start the two coroutines before going back here)
-  crtn_yield(0);
+static int entry52(void *p)
+{
+  return recurse52(*(int *)p);
+}
 
-  msg = crtn_mbx_alloc(30);
-  ck_assert_ptr_ne(msg, 0);
 
-  // This puts the coroutines in the runnable state
-  // One will get the message and the other goes back in waiting state
-  rc = crtn_mbx_post(mbx, msg);
-  ck_assert_int_eq(rc, 0);
+static crtn_time_t now_ns(void)
+{
+  struct timespec ts;
 
-  msg = crtn_mbx_alloc(30);
-  ck_assert_ptr_ne(msg, 0);
+  clock_gettime(CLOCK_MONOTONIC, &ts);
 
-  rc = crtn_mbx_post(mbx, msg);
-  ck_assert_int_eq(rc, 0);
+  return CRTN_SEC(ts.tv_sec) + ts.tv_nsec;
+}
 
-  rc = crtn_join(cid, &status);
-  ck_assert_int_eq(rc, 0);
-  ck_assert_int_eq(status, 5);
 
-  rc = crtn_join(cid1, &status);
-  ck_assert_int_eq(rc, 0);
-  ck_assert_int_eq(status, 5);
+static int entry_spin(void *p)
+{
+  (void)p;
 
-  rc = crtn_mbx_delete(mbx);
-  ck_assert_int_eq(rc, 0);
+  while (1) {
+    crtn_yield(0);
+  }
 
+  return 0;
+}
 
-END_TEST
+
+static int entry_sleepy(void *p)
+{
+  crtn_time_t t0;
+
+  (void)p;
+
+  // Busy for 10 ms
+  t0 = now_ns();
+  while ((now_ns() - t0) < CRTN_MSEC(10)) {
+    crtn_yield(0);
+  }
+
+  return 14;
+}
 
 
 // The unitary tests are run in separate processes
 // START_TEST is a "static" definition of a function
-START_TEST(test_crtn_mbx_get)
+START_TEST(test_crtn_timedjoin)
 
 int rc;
-crtn_mbx_t mbx;
-char *msg;
 crtn_t cid;
 int status;
+crtn_time_t t0;
 
-  // -------
-
-  rc = crtn_mbx_new(&mbx);
+  // ------- The target coroutine does not finish
+  rc = crtn_spawn(&cid, "spin", entry_spin, 0, 0);
   ck_assert_int_eq(rc, 0);
 
-  msg = crtn_mbx_alloc(30);
-  ck_assert_ptr_ne(msg, 0);
+  t0 = now_ns();
+  rc = crtn_timedjoin(cid, &status, CRTN_MSEC(20));
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), ETIMEDOUT);
+  ck_assert(now_ns() - t0 >= CRTN_MSEC(20));
 
-  rc = crtn_mbx_post(mbx, msg);
+  // The coroutine is still alive
+  rc = crtn_cancel(cid);
   ck_assert_int_eq(rc, 0);
 
-  msg = (char *)0;
-  rc = crtn_mbx_get(mbx, (void **)&msg);
+  rc = crtn_join(cid, &status);
   ck_assert_int_eq(rc, 0);
-  ck_assert_ptr_ne(msg, 0);
+  ck_assert_int_eq(status, CRTN_STATUS_CANCELLED);
 
-  rc = crtn_mbx_delete(mbx);
+  // ------- The target coroutine finishes before the timeout
+  rc = crtn_spawn(&cid, "sleepy", entry_sleepy, 0, 0);
   ck_assert_int_eq(rc, 0);
 
-  rc = crtn_mbx_free(msg);
+  rc = crtn_timedjoin(cid, &status, CRTN_SEC(10));
   ck_assert_int_eq(rc, 0);
+  ck_assert_int_eq(status, 14);
 
+END_TEST
 
-  // ------- Cancel a coroutine waiting on a mailbox
-  rc = crtn_mbx_new(&mbx);
-  ck_assert_int_eq(rc, 0);
 
-  rc = crtn_spawn(&cid, "post_01", entry_post_01, &mbx, 0);
-  ck_assert_int_eq(rc, 0);
+static int sleep_order[8];
+static int sleep_nb;
+static int sleep_spins;
 
-  // Make the coroutines wait on the mailbox (the FIFO scheduler
-  // will start the two coroutines before going back here)
-  crtn_yield(0);
+static int entry_sleeper(void *p)
+{
+  int n = *(int *)p;
+  crtn_time_t t0;
+  int rc;
 
-  // Cancel the waiting coroutine
-  rc = crtn_cancel(cid);
+  t0 = crtn_now();
+  rc = crtn_sleep(CRTN_MSEC(5 * n));
   ck_assert_int_eq(rc, 0);
+  ck_assert(crtn_now() - t0 >= CRTN_MSEC(5 * n));
 
-  rc = crtn_join(cid, &status);
-  ck_assert_int_eq(rc, 0);
-  ck_assert_int_eq(status, CRTN_STATUS_CANCELLED);
+  sleep_order[sleep_nb ++] = n;
 
-  rc = crtn_mbx_delete(mbx);
-  ck_assert_int_eq(rc, 0);
+  return n;
+}
+
+
+static int entry_counter(void *p)
+{
+  (void)p;
+
+  while (1) {
+    sleep_spins ++;
+    crtn_yield(0);
+  }
+
+  return 0;
+}
+
+
+// The unitary tests are run in separate processes
+// START_TEST is a "static" definition of a function
+START_TEST(test_crtn_sleep)
+
+int rc;
+crtn_t cid[8];
+crtn_t spin;
+int param[8];
+int status;
+int i;
+crtn_time_t t0;
+crtn_time_t deadline;
+
+  // ------- Sleep of the main coroutine
+  t0 = crtn_now();
+  ck_assert(t0 > 0);
+  rc = crtn_sleep(CRTN_MSEC(15));
+  ck_assert_int_eq(rc, 0);
+  ck_assert(crtn_now() - t0 >= CRTN_MSEC(15));
+
+  rc = crtn_sleep(0);
+  ck_assert_int_eq(rc, 0);
+
+  // ------- The other coroutines run while the caller sleeps
+  rc = crtn_spawn(&spin, "counter", entry_counter, 0, 0);
+  ck_assert_int_eq(rc, 0);
+
+  sleep_spins = 0;
+  rc = crtn_sleep(CRTN_MSEC(10));
+  ck_assert_int_eq(rc, 0);
+  ck_assert_int_gt(sleep_spins, 0);
+
+  rc = crtn_cancel(spin);
+  ck_assert_int_eq(rc, 0);
+  rc = crtn_join(spin, &status);
+  ck_assert_int_eq(rc, 0);
+
+  // ------- The sleepers wake up in the order of their deadlines
+  sleep_nb = 0;
+  for (i = 0; i < 8; i ++) {
+    param[i] = 8 - i;
+    rc = crtn_spawn(&(cid[i]), "sleeper", entry_sleeper, &(param[i]), 0);
+    ck_assert_int_eq(rc, 0);
+  }
+
+  for (i = 0; i < 8; i ++) {
+    rc = crtn_join(cid[i], &status);
+    ck_assert_int_eq(rc, 0);
+    ck_assert_int_eq(status, 8 - i);
+  }
+
+  ck_assert_int_eq(sleep_nb, 8);
+  for (i = 0; i < 8; i ++) {
+    ck_assert_int_eq(sleep_order[i], i + 1);
+  }
+
+  // ------- Cancellation of a sleeping coroutine
+  param[0] = 200;
+  rc = crtn_spawn(&(cid[0]), "sleeper", entry_sleeper, &(param[0]), 0);
+  ck_assert_int_eq(rc, 0);
+  rc = crtn_yield(0);
+  ck_assert_int_eq(rc, CRTN_SCHED_OTHER);
+  rc = crtn_cancel(cid[0]);
+  ck_assert_int_eq(rc, 0);
+  t0 = crtn_now();
+  rc = crtn_join(cid[0], &status);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_int_eq(status, CRTN_STATUS_CANCELLED);
+  ck_assert(crtn_now() - t0 < CRTN_SEC(1));
+
+  // ------- Absolute deadline (past and future)
+  rc = crtn_sleep_until(crtn_now() - CRTN_SEC(1));
+  ck_assert_int_eq(rc, 0);
+
+  deadline = crtn_now() + CRTN_MSEC(20);
+  rc = crtn_sleep_until(deadline);
+  ck_assert_int_eq(rc, 0);
+  ck_assert(crtn_now() >= deadline);
+
+  // ------- Far timer (beyond the levels of the wheel) along with a near one
+  param[0] = 720000; // 1 hour
+  rc = crtn_spawn(&(cid[0]), "sleeper", entry_sleeper, &(param[0]), 0);
+  ck_assert_int_eq(rc, 0);
+  rc = crtn_yield(0);
+  ck_assert_int_eq(rc, CRTN_SCHED_OTHER);
+  t0 = crtn_now();
+  rc = crtn_sleep(CRTN_MSEC(70));
+  ck_assert_int_eq(rc, 0);
+  ck_assert(crtn_now() - t0 >= CRTN_MSEC(70));
+  ck_assert(crtn_now() - t0 < CRTN_SEC(10));
+  rc = crtn_cancel(cid[0]);
+  ck_assert_int_eq(rc, 0);
+  rc = crtn_join(cid[0], &status);
+  ck_assert_int_eq(rc, 0);
+
+END_TEST
+
+
+// The unitary tests are run in separate processes
+// So, each one starts from scratch
+START_TEST(test_crtn_stack_guard)
+
+  crtn_t cid;
+  crtn_attr_t attr;
+  int rc;
+  int status;
+  int depth;
+  pid_t pid;
+
+  attr = crtn_attr_new();
+  ck_assert_ptr_ne(attr, NULL);
+
+  rc = crtn_set_attr_stack_mode(attr, CRTN_STACK_GUARD);
+  ck_assert_int_eq(rc, 0);
+
+  // ------- Coroutine running in its guarded stack
+  depth = 4;
+  rc = crtn_spawn(&cid, "foo_52", entry52, &depth, attr);
+  ck_assert_int_eq(rc, 0);
+  rc = crtn_join(cid, &status);
+  ck_assert_int_eq(rc, 0);
+
+  // ------- Stack overflow
+  pid = fork();
+  ck_assert_int_ge(pid, 0);
+  if (0 == pid) {
+    depth = 1000000;
+    rc = crtn_spawn(&cid, "foo_52", entry52, &depth, attr);
+    if (0 == rc) {
+      (void)crtn_join(cid, &status);
+    }
+    _exit(0);
+  }
+
+  rc = waitpid(pid, &status, 0);
+  ck_assert_int_eq(rc, pid);
+  ck_assert_int_eq(WIFSIGNALED(status), 1);
+  ck_assert_int_eq(WTERMSIG(status), SIGSEGV);
+
+  rc = crtn_attr_delete(attr);
+  ck_assert_int_eq(rc, 0);
+
+END_TEST
+
+
+static int entry53(void *p)
+{
+  int id = *(int *)p;
+  char buf[1000];
+  int i, j;
+  int rc;
+
+  memset(buf, id, sizeof(buf));
+
+  for (i = 0; i < 10; i ++) {
+
+    // The address of a local variable is not passed as the stack
+    // is overwritten by the other copy-stack coroutines
+    rc = crtn_yield(p);
+    ck_assert_int_eq(rc, CRTN_SCHED_OTHER);
+
+    // The local variables are preserved
+    ck_assert_int_eq(id, *(int *)p);
+    for (j = 0; j < (int)sizeof(buf); j ++) {
+      ck_assert_int_eq(buf[j], id);
+    }
+  }
+
+  return id;
+}
+
+
+// The unitary tests are run in separate processes
+// So, each one starts from scratch
+START_TEST(test_crtn_copystack)
+
+  crtn_t cid[4];
+  crtn_attr_t attr;
+  int rc;
+  int status;
+  int i;
+  int id[4] = { 1, 2, 3, 4 };
+  void *data;
+
+  attr = crtn_attr_new();
+  ck_assert_ptr_ne(attr, NULL);
+
+  rc = crtn_set_attr_type(attr, CRTN_TYPE_COPYSTACK);
+  ck_assert_int_eq(rc, 0);
+
+  // No stack size for the copy-stack coroutines
+  rc = crtn_set_attr_stack_size(attr, CRTN_DEFAULT_STACK_SIZE + 4096);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+
+  // ------- Standalone coroutines sharing the same stack
+  for (i = 0; i < 3; i ++) {
+    rc = crtn_spawn(&(cid[i]), "foo_53", entry53, &(id[i]), attr);
+    ck_assert_int_eq(rc, 0);
+  }
+
+  for (i = 0; i < 3; i ++) {
+    rc = crtn_join(cid[i], &status);
+    ck_assert_int_eq(rc, 0);
+    ck_assert_int_eq(status, id[i]);
+  }
+
+  // ------- Stepper coroutine interleaved with a standalone one
+  rc = crtn_spawn(&(cid[0]), "foo_53", entry53, &(id[0]), attr);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_set_attr_type(attr, CRTN_TYPE_STEPPER);
+  ck_assert_int_eq(rc, 0);
+  rc = crtn_spawn(&(cid[3]), "foo_53", entry53, &(id[3]), attr);
+  ck_assert_int_eq(rc, 0);
+
+  for (i = 0; i < 10; i ++) {
+    rc = crtn_wait(cid[3], &data);
+    ck_assert_int_eq(rc, 0);
+    ck_assert_ptr_eq(data, &(id[3]));
+
+    // The stepper ran without the standalone one: resume the latter
+    rc = crtn_yield(0);
+    ck_assert_int_eq(rc, CRTN_SCHED_OTHER);
+  }
+
+  rc = crtn_wait(cid[3], &data);
+  ck_assert_int_eq(rc, CRTN_DEAD);
+
+  rc = crtn_join(cid[3], &status);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_int_eq(status, id[3]);
+
+  rc = crtn_join(cid[0], &status);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_int_eq(status, id[0]);
+
+  // ------- Cancellation of a suspended coroutine
+  rc = crtn_attr_delete(attr);
+  ck_assert_int_eq(rc, 0);
+  attr = crtn_attr_new();
+  ck_assert_ptr_ne(attr, NULL);
+  rc = crtn_set_attr_type(attr, CRTN_TYPE_COPYSTACK);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_spawn(&(cid[0]), "foo_53", entry53, &(id[0]), attr);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_yield(0);
+  ck_assert_int_eq(rc, CRTN_SCHED_OTHER);
+
+  rc = crtn_cancel(cid[0]);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_join(cid[0], &status);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_int_eq(status, CRTN_STATUS_CANCELLED);
+
+  rc = crtn_attr_delete(attr);
+  ck_assert_int_eq(rc, 0);
+
+  // ------- Stackless and copy-stack are exclusive
+  attr = crtn_attr_new();
+  ck_assert_ptr_ne(attr, NULL);
+
+  rc = crtn_set_attr_type(attr, CRTN_TYPE_STACKLESS | CRTN_TYPE_COPYSTACK);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+
+  rc = crtn_attr_delete(attr);
+  ck_assert_int_eq(rc, 0);
+
+END_TEST
+
+
+// The unitary tests are run in separate processes
+// So, each one starts from scratch
+START_TEST(test_crtn_stack_lazy)
+
+  crtn_t cid;
+  crtn_attr_t attr;
+  int rc;
+  int status;
+  int depth;
+  unsigned long p1, p2;
+
+  attr = crtn_attr_new();
+  ck_assert_ptr_ne(attr, NULL);
+
+  rc = crtn_set_attr_stack_mode(attr, CRTN_STACK_LAZY);
+  ck_assert_int_eq(rc, 0);
+
+  // ------- Deep recursion far beyond the default stack size
+  depth = 2000;
+  rc = crtn_spawn(&cid, "foo_52", entry52, &depth, attr);
+  ck_assert_int_eq(rc, 0);
+  rc = crtn_join(cid, &status);
+  ck_assert_int_eq(rc, 0);
+
+  // ------- The stack is recycled after the release of its pages
+  rc = crtn_spawn(&cid, "foo_51", entry51, &p1, attr);
+  ck_assert_int_eq(rc, 0);
+  rc = crtn_join(cid, &status);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_int_eq(status, 31);
+
+  rc = crtn_spawn(&cid, "foo_51", entry51, &p2, attr);
+  ck_assert_int_eq(rc, 0);
+  rc = crtn_join(cid, &status);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_int_eq(status, 31);
+
+  ck_assert_uint_eq(p1, p2);
+
+  rc = crtn_attr_delete(attr);
+  ck_assert_int_eq(rc, 0);
+
+END_TEST
+
+
+static char prio_trace[32];
+static int prio_idx;
+
+static int entry54(void *p)
+{
+  int i;
+
+  for (i = 0; i < 3; i ++) {
+    prio_trace[prio_idx ++] = *(char *)p;
+    crtn_yield(0);
+  }
+
+  return 0;
+}
+
+
+// The unitary tests are run in separate processes
+// So, each one starts from scratch
+START_TEST(test_crtn_prio)
+
+  static const char names[] = "LlDdHh";
+  static const unsigned int prios[] = {
+    CRTN_PRIO_LOWEST, CRTN_PRIO_LOWEST,
+    CRTN_PRIO_DEFAULT, CRTN_PRIO_DEFAULT,
+    CRTN_PRIO_HIGHEST, CRTN_PRIO_HIGHEST
+  };
+  crtn_t cid[6];
+  crtn_attr_t attr;
+  int rc;
+  int status;
+  int i;
+
+  attr = crtn_attr_new();
+  ck_assert_ptr_ne(attr, NULL);
+
+  // ------- The lowest priority coroutines are spawned first
+  for (i = 0; i < 6; i ++) {
+    rc = crtn_set_attr_prio(attr, prios[i]);
+    ck_assert_int_eq(rc, 0);
+    rc = crtn_spawn(&(cid[i]), "foo_54", entry54, (void *)&(names[i]), attr);
+    ck_assert_int_eq(rc, 0);
+  }
+
+  rc = crtn_attr_delete(attr);
+  ck_assert_int_eq(rc, 0);
+
+  // ------- The highest priority coroutines run first, round-robin
+  //         inside each priority level (the main coroutine has the
+  //         default priority)
+  for (i = 5; i >= 0; i --) {
+    rc = crtn_join(cid[i], &status);
+    ck_assert_int_eq(rc, 0);
+    ck_assert_int_eq(status, 0);
+  }
+
+  prio_trace[prio_idx] = '\0';
+  ck_assert_str_eq(prio_trace, "HhHhHhDdDdDdLlLlLl");
+
+END_TEST
+
+
+struct edf_param {
+  char        name;
+  crtn_time_t deadline;
+};
+
+static int entry55(void *p)
+{
+  struct edf_param *param = (struct edf_param *)p;
+  int i;
+  int rc;
+
+  for (i = 0; i < 3; i ++) {
+    prio_trace[prio_idx ++] = param->name;
+
+    // Deadline of the next unit of work
+    param->deadline += CRTN_SEC(2);
+    rc = crtn_set_deadline(crtn_self(), param->deadline);
+    ck_assert_int_eq(rc, 0);
+    crtn_yield(0);
+  }
+
+  return 0;
+}
+
+
+// The unitary tests are run in separate processes
+// So, each one starts from scratch
+START_TEST(test_crtn_deadline)
+
+  static const char names[] = "ABCD";
+  crtn_t cid[4];
+  struct edf_param param[2];
+  crtn_time_t now;
+  int rc;
+  int status;
+  int i;
+
+  now = crtn_now();
+
+  // ------- The earliest deadline runs first whatever the spawning
+  //         order and the runnable coroutines without deadline run
+  //         afterwards
+  for (i = 0; i < 4; i ++) {
+    rc = crtn_spawn(&(cid[i]), "foo_54", entry54, (void *)&(names[i]), 0);
+    ck_assert_int_eq(rc, 0);
+  }
+
+  rc = crtn_set_deadline(cid[2], now + CRTN_SEC(1));
+  ck_assert_int_eq(rc, 0);
+  rc = crtn_set_deadline(cid[0], now + CRTN_SEC(3));
+  ck_assert_int_eq(rc, 0);
+  rc = crtn_set_deadline(cid[1], now + CRTN_SEC(2));
+  ck_assert_int_eq(rc, 0);
+
+  // Enter and leave the deadline scheduling class
+  rc = crtn_set_deadline(cid[3], now);
+  ck_assert_int_eq(rc, 0);
+  rc = crtn_set_deadline(cid[3], -1);
+  ck_assert_int_eq(rc, 0);
+
+  for (i = 3; i >= 0; i --) {
+    rc = crtn_join(cid[i], &status);
+    ck_assert_int_eq(rc, 0);
+    ck_assert_int_eq(status, 0);
+  }
+
+  prio_trace[prio_idx] = '\0';
+  ck_assert_str_eq(prio_trace, "CCCBBBAAADDD");
+
+  // ------- The deadlines are updated upon each unit of work
+  prio_idx = 0;
+
+  param[0].name = 'X';
+  param[0].deadline = now + CRTN_SEC(1);
+  param[1].name = 'Y';
+  param[1].deadline = now + CRTN_SEC(2);
+
+  for (i = 0; i < 2; i ++) {
+    rc = crtn_spawn(&(cid[i]), "foo_55", entry55, &(param[i]), 0);
+    ck_assert_int_eq(rc, 0);
+    rc = crtn_set_deadline(cid[i], param[i].deadline);
+    ck_assert_int_eq(rc, 0);
+  }
+
+  for (i = 0; i < 2; i ++) {
+    rc = crtn_join(cid[i], &status);
+    ck_assert_int_eq(rc, 0);
+    ck_assert_int_eq(status, 0);
+  }
+
+  prio_trace[prio_idx] = '\0';
+  ck_assert_str_eq(prio_trace, "XYXYXY");
+
+END_TEST
+
+
+static int entry56(void *p)
+{
+  int *v;
+  int rc;
+
+  (void)p;
+
+  // Pass back the incremented values until a NULL pointer
+  while ((v = (int *)crtn_yield_data())) {
+    (*v) ++;
+    rc = crtn_yield_to(CRTN_CID_MAIN, v);
+    ck_assert_int_eq(rc, CRTN_SCHED_OTHER);
+  }
+
+  return 0;
+}
+
+
+static int entry57(void *p)
+{
+  int *nb = (int *)p;
+
+  while (1) {
+    (*nb) ++;
+    crtn_yield(0);
+  }
+
+  return 0;
+}
+
+
+// The unitary tests are run in separate processes
+// So, each one starts from scratch
+START_TEST(test_crtn_yield_to)
+
+  crtn_t cid, cid1;
+  int rc;
+  int status;
+  int i;
+  int v;
+  int nb;
+
+  // ------- Some coroutine is runnable but never resumed
+  nb = 0;
+  rc = crtn_spawn(&cid1, "foo_57", entry57, &nb, 0);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_spawn(&cid, "foo_56", entry56, 0, 0);
+  ck_assert_int_eq(rc, 0);
+
+  // ------- Ping-pong with the data
+  v = 0;
+  for (i = 0; i < 1000; i ++) {
+    rc = crtn_yield_to(cid, &v);
+    ck_assert_int_eq(rc, CRTN_SCHED_OTHER);
+    ck_assert_ptr_eq(crtn_yield_data(), &v);
+    ck_assert_int_eq(v, i + 1);
+  }
+
+  ck_assert_int_eq(nb, 0);
+
+  // ------- End of the partner
+  rc = crtn_yield_to(cid, 0);
+  ck_assert_int_eq(rc, CRTN_SCHED_OTHER);
+  rc = crtn_join(cid, &status);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_int_eq(status, 0);
+
+  // ------- The other coroutine is resumed by the regular scheduling
+  ck_assert_int_eq(nb, 0);
+  rc = crtn_yield(0);
+  ck_assert_int_eq(rc, CRTN_SCHED_OTHER);
+  ck_assert_int_eq(nb, 1);
+
+  rc = crtn_cancel(cid1);
+  ck_assert_int_eq(rc, 0);
+  rc = crtn_join(cid1, &status);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_int_eq(status, CRTN_STATUS_CANCELLED);
+
+END_TEST
+
+
+struct gen_value {
+  int v;
+  int twice;
+};
+
+static char gen_big[CRTN_GEN_VALUE_SZ + 1];
+
+static int entry58(void *p)
+{
+  struct gen_value val;
+  int *in;
+
+  (void)p;
+
+  in = (int *)crtn_gen_input();
+
+  // Local values are copied into the inline buffer
+  while (in && (*in >= 0)) {
+    val.v = *in;
+    val.twice = 2 * (*in);
+    in = (int *)crtn_gen_yield(&val, sizeof(val));
+  }
+
+  // Big values are passed by address
+  if (in) {
+    in = (int *)crtn_gen_yield(gen_big, sizeof(gen_big));
+    ck_assert_ptr_eq(in, NULL);
+  }
+
+  return 58;
+}
+
+
+static int entry58_input(void *p)
+{
+  (void)p;
+
+  crtn_yield(0);
+
+  // Not a generator: no input is passed
+  return (crtn_gen_input() ? 1 : 0);
+}
+
+
+// The unitary tests are run in separate processes
+// So, each one starts from scratch
+START_TEST(test_crtn_gen)
+
+  crtn_t cid;
+  crtn_attr_t attr;
+  int rc;
+  int status;
+  int i;
+  struct gen_value *out, *prev;
+  void *p;
+
+  attr = crtn_attr_new();
+  ck_assert_ptr_ne(attr, NULL);
+  rc = crtn_set_attr_type(attr, CRTN_TYPE_STEPPER | CRTN_TYPE_COPYSTACK);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_spawn(&cid, "foo_58", entry58, 0, attr);
+  ck_assert_int_eq(rc, 0);
+
+  // ------- Values in both directions
+  prev = NULL;
+  for (i = 0; i < 100; i ++) {
+    rc = crtn_gen_next(cid, &i, (void **)&out);
+    ck_assert_int_eq(rc, 0);
+    ck_assert_int_eq(out->v, i);
+    ck_assert_int_eq(out->twice, 2 * i);
+
+    // Always the same buffer
+    if (prev) {
+      ck_assert_ptr_eq(out, prev);
+    }
+    prev = out;
+  }
+
+  // ------- Value bigger than the inline buffer
+  i = -1;
+  rc = crtn_gen_next(cid, &i, &p);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_ptr_eq(p, gen_big);
+
+  // ------- End of the generator
+  rc = crtn_gen_next(cid, 0, &p);
+  ck_assert_int_eq(rc, CRTN_DEAD);
+  ck_assert_ptr_eq(p, NULL);
+
+  rc = crtn_join(cid, &status);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_int_eq(status, 58);
+
+  // ------- The input is not passed to a coroutine which is not a generator
+  rc = crtn_spawn(&cid, "foo_58_input", entry58_input, 0, 0);
+  ck_assert_int_eq(rc, 0);
+  rc = crtn_gen_next(cid, &i, &p);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+  rc = crtn_join(cid, &status);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_int_eq(status, 0);
+
+  rc = crtn_attr_delete(attr);
+  ck_assert_int_eq(rc, 0);
+
+END_TEST
+
+
+
+#ifdef HAVE_CRTN_MBX
+
+
+// The unitary tests are run in separate processes
+// START_TEST is a "static" definition of a function
+START_TEST(test_crtn_mbx_new)
+
+int rc;
+int i;
+crtn_mbx_t mbx_tab[CRTN_MBX_MAX + 1];
+
+  // ------- Overflow of the maximum number of mailboxes
+
+  // One coroutine already allocated for Main
+  for (i = 0; i < CRTN_MBX_MAX; i ++) {
+    rc = crtn_mbx_new(&(mbx_tab[i]));
+    ck_assert_int_eq(rc, 0);
+  }
+
+  // Maximum number of mailboxes reached
+  rc = crtn_mbx_new(&(mbx_tab[i]));
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EAGAIN);
+
+  for (i = 0; i < (CRTN_MBX_MAX - 1); i ++) {
+    rc = crtn_mbx_delete(mbx_tab[i]);
+    ck_assert_int_eq(rc, 0);
+  }
+
+END_TEST
+
+
+// The unitary tests are run in separate processes
+// START_TEST is a "static" definition of a function
+START_TEST(test_crtn_mbx_delete)
+
+int rc;
+crtn_mbx_t mbx;
+
+  // -------
+
+  rc = crtn_mbx_new(&mbx);
+  ck_assert_int_eq(rc, 0);
+  rc = crtn_mbx_delete(mbx);
+  ck_assert_int_eq(rc, 0);
+
+END_TEST
+
+
+
+
+static int entry_post_01(void *p)
+{
+  void *msg;
+  int rc;
+  crtn_mbx_t mbx = *((crtn_mbx_t *)p);
+
+  msg = (void *)0;
+  rc = crtn_mbx_get(mbx, &msg);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_ptr_ne(msg, 0);
+
+  rc = crtn_mbx_free(msg);
+  ck_assert_int_eq(rc, 0);
+
+  return 5;
+}
+
+
+// The unitary tests are run in separate processes
+// START_TEST is a "static" definition of a function
+START_TEST(test_crtn_mbx_post)
+
+int rc;
+crtn_mbx_t mbx;
+char *msg;
+crtn_t cid, cid1;
+int status;
+
+  // -------
+
+  rc = crtn_mbx_new(&mbx);
+  ck_assert_int_eq(rc, 0);
+
+  msg = crtn_mbx_alloc(30);
+  ck_assert_ptr_ne(msg, 0);
+
+  rc = crtn_mbx_post(mbx, msg);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_mbx_delete(mbx);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_mbx_free(msg);
+  ck_assert_int_eq(rc, 0);
+
+
+  // ------- Post in a mbx on which a coroutine is not waiting yet
+  rc = crtn_mbx_new(&mbx);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_spawn(&cid, "post_01", entry_post_01, &mbx, 0);
+  ck_assert_int_eq(rc, 0);
+
+  msg = crtn_mbx_alloc(30);
+  ck_assert_ptr_ne(msg, 0);
+
+  rc = crtn_mbx_post(mbx, msg);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_join(cid, &status);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_int_eq(status, 5);
+
+  rc = crtn_mbx_delete(mbx);
+  ck_assert_int_eq(rc, 0);
+
+
+  // ------- Post in a mbx on which a coroutine is waiting
+  rc = crtn_mbx_new(&mbx);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_spawn(&cid, "post_01", entry_post_01, &mbx, 0);
+  ck_assert_int_eq(rc, 0);
+
+  msg = crtn_mbx_alloc(30);
+  ck_assert_ptr_ne(msg, 0);
+
+  // Make the coroutine wait on the mailbox
+  crtn_yield(0);
+
+  rc = crtn_mbx_post(mbx, msg);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_join(cid, &status);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_int_eq(status, 5);
+
+  rc = crtn_mbx_delete(mbx);
+  ck_assert_int_eq(rc, 0);
+
+
+  // ------- Post in a mbx on which 2 coroutines are waiting
+  rc = crtn_mbx_new(&mbx);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_spawn(&cid, "post_01", entry_post_01, &mbx, 0);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_spawn(&cid1, "post_02", entry_post_01, &mbx, 0);
+  ck_assert_int_eq(rc, 0);
+
+  // Make the coroutines wait on the mailbox (the FIFO scheduler
+  // will start the two coroutines before going back here)
+  crtn_yield(0);
+
+  msg = crtn_mbx_alloc(30);
+  ck_assert_ptr_ne(msg, 0);
+
+  // This puts the coroutines in the runnable state
+  // One will get the message and the other goes back in waiting state
+  rc = crtn_mbx_post(mbx, msg);
+  ck_assert_int_eq(rc, 0);
+
+  msg = crtn_mbx_alloc(30);
+  ck_assert_ptr_ne(msg, 0);
+
+  rc = crtn_mbx_post(mbx, msg);
+  ck_assert_int_eq(rc, 0);
+
+  // Launch the coroutines
+  crtn_yield(0);
+
+  rc = crtn_join(cid, &status);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_int_eq(status, 5);
+
+  rc = crtn_join(cid1, &status);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_int_eq(status, 5);
+
+  rc = crtn_mbx_delete(mbx);
+  ck_assert_int_eq(rc, 0);
+
+
+  // ------- Post one message at a time in a mbx on which 2 coroutines are waiting
+  rc = crtn_mbx_new(&mbx);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_spawn(&cid, "post_01", entry_post_01, &mbx, 0);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_spawn(&cid1, "post_02", entry_post_01, &mbx, 0);
+  ck_assert_int_eq(rc, 0);
+
+  // Make the coroutines wait on the mailbox (the FIFO scheduler
+  // will start the two coroutines before going back here)
+  crtn_yield(0);
+
+  msg = crtn_mbx_alloc(30);
+  ck_assert_ptr_ne(msg, 0);
+
+  // This puts the coroutines in the runnable state
+  // One will get the message and the other goes back in waiting state
+  rc = crtn_mbx_post(mbx, msg);
+  ck_assert_int_eq(rc, 0);
+
+  msg = crtn_mbx_alloc(30);
+  ck_assert_ptr_ne(msg, 0);
+
+  rc = crtn_mbx_post(mbx, msg);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_join(cid, &status);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_int_eq(status, 5);
+
+  rc = crtn_join(cid1, &status);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_int_eq(status, 5);
+
+  rc = crtn_mbx_delete(mbx);
+  ck_assert_int_eq(rc, 0);
+
+
+END_TEST
+
+
+// The unitary tests are run in separate processes
+// START_TEST is a "static" definition of a function
+START_TEST(test_crtn_mbx_get)
+
+int rc;
+crtn_mbx_t mbx;
+char *msg;
+crtn_t cid;
+int status;
+
+  // -------
+
+  rc = crtn_mbx_new(&mbx);
+  ck_assert_int_eq(rc, 0);
+
+  msg = crtn_mbx_alloc(30);
+  ck_assert_ptr_ne(msg, 0);
+
+  rc = crtn_mbx_post(mbx, msg);
+  ck_assert_int_eq(rc, 0);
+
+  msg = (char *)0;
+  rc = crtn_mbx_get(mbx, (void **)&msg);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_ptr_ne(msg, 0);
+
+  rc = crtn_mbx_delete(mbx);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_mbx_free(msg);
+  ck_assert_int_eq(rc, 0);
+
+
+  // ------- Cancel a coroutine waiting on a mailbox
+  rc = crtn_mbx_new(&mbx);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_spawn(&cid, "post_01", entry_post_01, &mbx, 0);
+  ck_assert_int_eq(rc, 0);
+
+  // Make the coroutines wait on the mailbox (the FIFO scheduler
+  // will start the two coroutines before going back here)
+  crtn_yield(0);
+
+  // Cancel the waiting coroutine
+  rc = crtn_cancel(cid);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_join(cid, &status);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_int_eq(status, CRTN_STATUS_CANCELLED);
+
+  rc = crtn_mbx_delete(mbx);
+  ck_assert_int_eq(rc, 0);
+
+END_TEST
+
+
+
+// The unitary tests are run in separate processes
+// START_TEST is a "static" definition of a function
+START_TEST(test_crtn_mbx_tryget)
+
+int rc;
+crtn_mbx_t mbx;
+char *msg;
+
+  // -------
+
+  rc = crtn_mbx_new(&mbx);
+  ck_assert_int_eq(rc, 0);
+
+  msg = (char *)0;
+  rc = crtn_mbx_tryget(mbx, (void **)&msg);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EAGAIN);
+  ck_assert_ptr_eq(msg, 0);
+
+  msg = crtn_mbx_alloc(30);
+  ck_assert_ptr_ne(msg, 0);
+
+  rc = crtn_mbx_post(mbx, msg);
+  ck_assert_int_eq(rc, 0);
+
+  msg = (char *)0;
+  rc = crtn_mbx_tryget(mbx, (void **)&msg);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_ptr_ne(msg, 0);
+
+  rc = crtn_mbx_delete(mbx);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_mbx_free(msg);
+  ck_assert_int_eq(rc, 0);
+
+END_TEST
+
+
+
+// The unitary tests are run in separate processes
+// START_TEST is a "static" definition of a function
+START_TEST(test_crtn_mbx_format)
+
+int rc;
+crtn_mbx_t mbx;
+char buffer[50];
+char *msg;
+size_t msg_size;
+
+  // -------
+
+  rc = crtn_mbx_new(&mbx);
+  ck_assert_int_eq(rc, 0);
+
+  msg = (char *)0;
+  rc = crtn_mbx_tryget(mbx, (void **)&msg);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EAGAIN);
+  ck_assert_ptr_eq(msg, 0);
+
+  msg_size = 0;
+  msg = crtn_mbx_format(buffer, sizeof(buffer), &msg_size);
+  ck_assert_ptr_ne(msg, 0);
+  ck_assert_size_gt(msg_size, 0);
+
+#define MESSAGE "Message"
+snprintf(msg, msg_size, "%s", MESSAGE);
+
+  rc = crtn_mbx_post(mbx, msg);
+  ck_assert_int_eq(rc, 0);
+
+  msg = (char *)0;
+  rc = crtn_mbx_tryget(mbx, (void **)&msg);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_ptr_ne(msg, 0);
+
+  rc = strcmp(msg, MESSAGE);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_mbx_delete(mbx);
+  ck_assert_int_eq(rc, 0);
+
+END_TEST
+
+
+static int mbx_order[3];
+static int mbx_nb_rcv;
+
+static int entry_get_order(void *p)
+{
+  crtn_mbx_t mbx = *((crtn_mbx_t *)p);
+  void *msg;
+  int rc;
+
+  rc = crtn_mbx_get(mbx, &msg);
+  ck_assert_int_eq(rc, 0);
+
+  mbx_order[mbx_nb_rcv ++] = *((int *)msg);
+
+  rc = crtn_mbx_free(msg);
+  ck_assert_int_eq(rc, 0);
+
+  return 0;
+}
+
+
+// The unitary tests are run in separate processes
+// START_TEST is a "static" definition of a function
+START_TEST(test_crtn_mbx_handoff)
+
+int rc;
+crtn_mbx_t mbx;
+int *msg;
+crtn_t cid[3];
+int status;
+int i;
+
+  // ------- One post wakes up only the oldest waiting coroutine
+  rc = crtn_mbx_new(&mbx);
+  ck_assert_int_eq(rc, 0);
+
+  for (i = 0; i < 3; i ++) {
+    rc = crtn_spawn(&(cid[i]), "get_order", entry_get_order, &mbx, 0);
+    ck_assert_int_eq(rc, 0);
+  }
+
+  // Make the coroutines wait on the mailbox
+  crtn_yield(0);
+
+  for (i = 0; i < 3; i ++) {
+
+    msg = (int *)crtn_mbx_alloc(sizeof(int));
+    ck_assert_ptr_ne(msg, 0);
+    *msg = i;
+
+    rc = crtn_mbx_post(mbx, msg);
+    ck_assert_int_eq(rc, 0);
+
+    // Only one coroutine received the message
+    crtn_yield(0);
+    ck_assert_int_eq(mbx_nb_rcv, i + 1);
+  }
+
+  for (i = 0; i < 3; i ++) {
+    rc = crtn_join(cid[i], &status);
+    ck_assert_int_eq(rc, 0);
+    ck_assert_int_eq(status, 0);
+    ck_assert_int_eq(mbx_order[i], i);
+  }
+
+  // ------- The message handed off to a cancelled coroutine is
+  //         delivered to the next waiting coroutine
+  mbx_nb_rcv = 0;
+
+  for (i = 0; i < 2; i ++) {
+    rc = crtn_spawn(&(cid[i]), "get_order", entry_get_order, &mbx, 0);
+    ck_assert_int_eq(rc, 0);
+  }
+
+  crtn_yield(0);
+
+  msg = (int *)crtn_mbx_alloc(sizeof(int));
+  ck_assert_ptr_ne(msg, 0);
+  *msg = 12;
+
+  rc = crtn_mbx_post(mbx, msg);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_cancel(cid[0]);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_join(cid[0], &status);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_int_eq(status, CRTN_STATUS_CANCELLED);
+
+  rc = crtn_join(cid[1], &status);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_int_eq(status, 0);
+  ck_assert_int_eq(mbx_nb_rcv, 1);
+  ck_assert_int_eq(mbx_order[0], 12);
+
+  // ------- Without waiting coroutine, the message is
+  //         put back into the mailbox
+  rc = crtn_spawn(&(cid[0]), "get_order", entry_get_order, &mbx, 0);
+  ck_assert_int_eq(rc, 0);
+
+  crtn_yield(0);
+
+  msg = (int *)crtn_mbx_alloc(sizeof(int));
+  ck_assert_ptr_ne(msg, 0);
+
+  rc = crtn_mbx_post(mbx, msg);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_cancel(cid[0]);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_join(cid[0], &status);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_int_eq(status, CRTN_STATUS_CANCELLED);
+
+  rc = crtn_mbx_tryget(mbx, (void **)&msg);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_mbx_free(msg);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_mbx_delete(mbx);
+  ck_assert_int_eq(rc, 0);
 
 END_TEST
 
 
+static int entry_bounded_sender(void *p)
+{
+  crtn_mbx_t mbx = *((crtn_mbx_t *)p);
+  int *msg;
+  int rc;
+  int i;
+
+  for (i = 0; i < 10; i ++) {
+    msg = (int *)crtn_mbx_alloc(sizeof(int));
+    ck_assert_ptr_ne(msg, 0);
+    *msg = i;
+
+    // Suspended when the mailbox is full
+    rc = crtn_mbx_post(mbx, msg);
+    ck_assert_int_eq(rc, 0);
+  }
+
+  return i;
+}
+
 
 // The unitary tests are run in separate processes
 // START_TEST is a "static" definition of a function
-START_TEST(test_crtn_mbx_tryget)
+START_TEST(test_crtn_mbx_bounded)
 
 int rc;
 crtn_mbx_t mbx;
-char *msg;
+int *msg;
+crtn_t cid;
+int status;
+int i;
 
-  // -------
+  rc = crtn_mbx_new_bounded(&mbx, 2);
+  ck_assert_int_eq(rc, 0);
 
-  rc = crtn_mbx_new(&mbx);
+  rc = crtn_spawn(&cid, "bounded_sender", entry_bounded_sender, &mbx, 0);
   ck_assert_int_eq(rc, 0);
 
-  msg = (char *)0;
+  // The sender fills the mailbox and is suspended
+  crtn_yield(0);
+
+  msg = (int *)crtn_mbx_alloc(sizeof(int));
+  ck_assert_ptr_ne(msg, 0);
+  rc = crtn_mbx_trypost(mbx, msg);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EAGAIN);
+  rc = crtn_mbx_free(msg);
+  ck_assert_int_eq(rc, 0);
+
+  // The messages are received in order and the mailbox
+  // never contains more than 2 messages
+  for (i = 0; i < 10; i ++) {
+    rc = crtn_mbx_get(mbx, (void **)&msg);
+    ck_assert_int_eq(rc, 0);
+    ck_assert_int_eq(*msg, i);
+    rc = crtn_mbx_free(msg);
+    ck_assert_int_eq(rc, 0);
+
+    crtn_yield(0);
+  }
+
+  rc = crtn_join(cid, &status);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_int_eq(status, 10);
+
+  // ------- Cancel a sender waiting for room
+  rc = crtn_spawn(&cid, "bounded_sender", entry_bounded_sender, &mbx, 0);
+  ck_assert_int_eq(rc, 0);
+
+  crtn_yield(0);
+
+  rc = crtn_cancel(cid);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_join(cid, &status);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_int_eq(status, CRTN_STATUS_CANCELLED);
+
+  for (i = 0; i < 2; i ++) {
+    rc = crtn_mbx_tryget(mbx, (void **)&msg);
+    ck_assert_int_eq(rc, 0);
+    ck_assert_int_eq(*msg, i);
+    rc = crtn_mbx_free(msg);
+    ck_assert_int_eq(rc, 0);
+  }
+
   rc = crtn_mbx_tryget(mbx, (void **)&msg);
   ck_assert_int_eq(rc, -1);
   ck_assert_int_eq(crtn_errno(), EAGAIN);
-  ck_assert_ptr_eq(msg, 0);
 
-  msg = crtn_mbx_alloc(30);
-  ck_assert_ptr_ne(msg, 0);
+  // ------- Cancel a receiver handed off a message while the
+  //         mailbox became full: the message is put back
+  //         beyond the capacity
+  rc = crtn_spawn(&cid, "get_order", entry_get_order, &mbx, 0);
+  ck_assert_int_eq(rc, 0);
 
-  rc = crtn_mbx_post(mbx, msg);
+  crtn_yield(0);
+
+  for (i = 0; i < 3; i ++) {
+    msg = (int *)crtn_mbx_alloc(sizeof(int));
+    ck_assert_ptr_ne(msg, 0);
+    *msg = 20 + i;
+    rc = crtn_mbx_post(mbx, msg);
+    ck_assert_int_eq(rc, 0);
+  }
+
+  rc = crtn_cancel(cid);
   ck_assert_int_eq(rc, 0);
 
-  msg = (char *)0;
+  rc = crtn_join(cid, &status);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_int_eq(status, CRTN_STATUS_CANCELLED);
+
+  // The senders are refused until the number of
+  // messages is below the capacity
+  for (i = 0; i < 3; i ++) {
+
+    msg = (int *)crtn_mbx_alloc(sizeof(int));
+    ck_assert_ptr_ne(msg, 0);
+    *msg = 30;
+    rc = crtn_mbx_trypost(mbx, msg);
+    if (i < 2) {
+      ck_assert_int_eq(rc, -1);
+      ck_assert_int_eq(crtn_errno(), EAGAIN);
+      rc = crtn_mbx_free(msg);
+      ck_assert_int_eq(rc, 0);
+    } else {
+      ck_assert_int_eq(rc, 0);
+    }
+
+    rc = crtn_mbx_tryget(mbx, (void **)&msg);
+    ck_assert_int_eq(rc, 0);
+    ck_assert_int_eq(*msg, 20 + i);
+    rc = crtn_mbx_free(msg);
+    ck_assert_int_eq(rc, 0);
+  }
+
   rc = crtn_mbx_tryget(mbx, (void **)&msg);
   ck_assert_int_eq(rc, 0);
-  ck_assert_ptr_ne(msg, 0);
+  ck_assert_int_eq(*msg, 30);
+  rc = crtn_mbx_free(msg);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_mbx_delete(mbx);
+  ck_assert_int_eq(rc, 0);
+
+END_TEST
+
+
+static int entry_batch_receiver(void *p)
+{
+  crtn_mbx_t mbx = *((crtn_mbx_t *)p);
+  void *msgs[4];
+  int nb = 0;
+  int rc;
+  int i;
+
+  while (nb < 10) {
+
+    // The messages posted meanwhile are received at once
+    rc = crtn_mbx_get_n(mbx, msgs, 4);
+    ck_assert_int_gt(rc, 0);
+    ck_assert_int_le(rc, 4);
+
+    for (i = 0; i < rc; i ++) {
+      ck_assert_int_eq(*((int *)(msgs[i])), nb);
+      nb ++;
+      crtn_mbx_free(msgs[i]);
+    }
+  }
+
+  return nb;
+}
+
+
+// The unitary tests are run in separate processes
+// START_TEST is a "static" definition of a function
+START_TEST(test_crtn_mbx_batch)
+
+int rc;
+crtn_mbx_t mbx;
+void *msgs[10];
+crtn_t cid;
+int status;
+int i;
+
+  rc = crtn_mbx_new(&mbx);
+  ck_assert_int_eq(rc, 0);
+
+  for (i = 0; i < 10; i ++) {
+    msgs[i] = crtn_mbx_alloc(sizeof(int));
+    ck_assert_ptr_ne(msgs[i], 0);
+    *((int *)(msgs[i])) = i;
+  }
+
+  // Nobody waits: all the messages are queued
+  rc = crtn_mbx_post_n(mbx, msgs, 3);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_mbx_get_n(mbx, msgs, 10);
+  ck_assert_int_eq(rc, 3);
+  for (i = 0; i < 3; i ++) {
+    ck_assert_int_eq(*((int *)(msgs[i])), i);
+  }
+
+  // The receiver waits on the mailbox: the first message
+  // is handed off, the other ones are queued
+  rc = crtn_spawn(&cid, "batch_receiver", entry_batch_receiver, &mbx, 0);
+  ck_assert_int_eq(rc, 0);
+
+  crtn_yield(0);
+
+  rc = crtn_mbx_post_n(mbx, msgs, 10);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_join(cid, &status);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_int_eq(status, 10);
+
+  // ------- Bounded mailbox: the sender is suspended
+  //         until there is room for the whole batch
+  rc = crtn_mbx_delete(mbx);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_mbx_new_bounded(&mbx, 3);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_spawn(&cid, "batch_receiver", entry_batch_receiver, &mbx, 0);
+  ck_assert_int_eq(rc, 0);
+
+  for (i = 0; i < 10; i ++) {
+    msgs[i] = crtn_mbx_alloc(sizeof(int));
+    ck_assert_ptr_ne(msgs[i], 0);
+    *((int *)(msgs[i])) = i;
+  }
+
+  rc = crtn_mbx_post_n(mbx, msgs, 10);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_join(cid, &status);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_int_eq(status, 10);
+
+  rc = crtn_mbx_delete(mbx);
+  ck_assert_int_eq(rc, 0);
+
+  // ------- Bounded mailbox: the batch makes room
+  //         for the suspended sender
+  rc = crtn_mbx_new_bounded(&mbx, 2);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_spawn(&cid, "bounded_sender", entry_bounded_sender, &mbx, 0);
+  ck_assert_int_eq(rc, 0);
+
+  // The sender is suspended on its third message until
+  // the batches make room in the mailbox
+  crtn_yield(0);
+
+  i = 0;
+  while (i < 10) {
+    // At most the handed off message and the
+    // content of the mailbox
+    rc = crtn_mbx_get_n(mbx, msgs, 10);
+    ck_assert_int_gt(rc, 0);
+    ck_assert_int_le(rc, 3);
+    for (status = 0; status < rc; status ++) {
+      ck_assert_int_eq(*((int *)(msgs[status])), i);
+      crtn_mbx_free(msgs[status]);
+      i ++;
+    }
+  }
+
+  rc = crtn_join(cid, &status);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_int_eq(status, 10);
 
   rc = crtn_mbx_delete(mbx);
   ck_assert_int_eq(rc, 0);
 
+END_TEST
+
+
+// The unitary tests are run in separate processes
+// START_TEST is a "static" definition of a function
+START_TEST(test_crtn_mbx_alloc)
+
+int rc;
+char *msg, *msg1, *msg2;
+
+  // ------- The freed messages are recycled in their size class
+  msg = crtn_mbx_alloc(30);
+  ck_assert_ptr_ne(msg, 0);
+  ck_assert_int_eq((unsigned long)msg & (__alignof__(long double) - 1), 0);
+  memset(msg, 'a', 30);
+
+  rc = crtn_mbx_free(msg);
+  ck_assert_int_eq(rc, 0);
+
+  msg1 = crtn_mbx_alloc(20);
+  ck_assert_ptr_eq(msg1, msg);
+
+  msg2 = crtn_mbx_alloc(32);
+  ck_assert_ptr_ne(msg2, 0);
+  ck_assert_ptr_ne(msg2, msg1);
+
+  rc = crtn_mbx_free(msg1);
+  ck_assert_int_eq(rc, 0);
+  rc = crtn_mbx_free(msg2);
+  ck_assert_int_eq(rc, 0);
+
+  // Different size class
+  msg1 = crtn_mbx_alloc(100);
+  ck_assert_ptr_ne(msg1, 0);
+  ck_assert_ptr_ne(msg1, msg2);
+  rc = crtn_mbx_free(msg1);
+  ck_assert_int_eq(rc, 0);
+
+  // ------- Big messages
+  msg = crtn_mbx_alloc(100000);
+  ck_assert_ptr_ne(msg, 0);
+  memset(msg, 'a', 100000);
   rc = crtn_mbx_free(msg);
   ck_assert_int_eq(rc, 0);
 
 END_TEST
 
 
+static int entry_late_post(void *p)
+{
+  crtn_mbx_t mbx = *((crtn_mbx_t *)p);
+  crtn_time_t t0;
+  void *msg;
+  int rc;
+
+  t0 = now_ns();
+  while ((now_ns() - t0) < CRTN_MSEC(10)) {
+    crtn_yield(0);
+  }
+
+  msg = crtn_mbx_alloc(10);
+  ck_assert_ptr_ne(msg, 0);
+  rc = crtn_mbx_post(mbx, msg);
+  ck_assert_int_eq(rc, 0);
+
+  return 0;
+}
+
 
 // The unitary tests are run in separate processes
 // START_TEST is a "static" definition of a function
-START_TEST(test_crtn_mbx_format)
+START_TEST(test_crtn_mbx_timedget)
 
 int rc;
 crtn_mbx_t mbx;
-char buffer[50];
-char *msg;
-size_t msg_size;
-
-  // -------
+void *msg;
+crtn_t cid;
+crtn_time_t t0;
 
   rc = crtn_mbx_new(&mbx);
   ck_assert_int_eq(rc, 0);
 
-  msg = (char *)0;
-  rc = crtn_mbx_tryget(mbx, (void **)&msg);
+  // ------- No other coroutine: the library sleeps until the deadline
+  t0 = now_ns();
+  rc = crtn_mbx_timedget(mbx, &msg, CRTN_MSEC(20));
   ck_assert_int_eq(rc, -1);
-  ck_assert_int_eq(crtn_errno(), EAGAIN);
-  ck_assert_ptr_eq(msg, 0);
+  ck_assert_int_eq(crtn_errno(), ETIMEDOUT);
+  ck_assert(now_ns() - t0 >= CRTN_MSEC(20));
 
-  msg_size = 0;
-  msg = crtn_mbx_format(buffer, sizeof(buffer), &msg_size);
+  // ------- The message arrives before the timeout
+  rc = crtn_spawn(&cid, "late_post", entry_late_post, &mbx, 0);
+  ck_assert_int_eq(rc, 0);
+
+  msg = 0;
+  rc = crtn_mbx_timedget(mbx, &msg, CRTN_SEC(10));
+  ck_assert_int_eq(rc, 0);
   ck_assert_ptr_ne(msg, 0);
-  ck_assert_size_gt(msg_size, 0);
+  crtn_mbx_free(msg);
 
-#define MESSAGE "Message"
-snprintf(msg, msg_size, "%s", MESSAGE);
+  rc = crtn_join(cid, 0);
+  ck_assert_int_eq(rc, 0);
 
-  rc = crtn_mbx_post(mbx, msg);
+  // ------- The message arrives after the timeout
+  rc = crtn_spawn(&cid, "late_post", entry_late_post, &mbx, 0);
   ck_assert_int_eq(rc, 0);
 
-  msg = (char *)0;
-  rc = crtn_mbx_tryget(mbx, (void **)&msg);
+  rc = crtn_mbx_timedget(mbx, &msg, CRTN_MSEC(1));
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), ETIMEDOUT);
+
+  rc = crtn_join(cid, 0);
   ck_assert_int_eq(rc, 0);
-  ck_assert_ptr_ne(msg, 0);
 
-  rc = strcmp(msg, MESSAGE);
+  // The message is in the mailbox
+  rc = crtn_mbx_tryget(mbx, &msg);
   ck_assert_int_eq(rc, 0);
+  crtn_mbx_free(msg);
 
   rc = crtn_mbx_delete(mbx);
   ck_assert_int_eq(rc, 0);
@@ -1411,10 +2912,443 @@ crtn_sem_t sem;
 END_TEST
 
 
+static crtn_t sem_cid[3];
+static int sem_order[3];
+static int sem_nb_p;
+
+static int entry_sem_order(void *p)
+{
+  int rc;
+  int i;
+  crtn_sem_t sem = *((crtn_sem_t *)p);
+
+  rc = crtn_sem_p(sem);
+  ck_assert_int_eq(rc, 0);
+
+  // Record the rank of the coroutine
+  for (i = 0; i < 3; i ++) {
+    if (crtn_self() == sem_cid[i]) {
+      sem_order[sem_nb_p ++] = i;
+      break;
+    }
+  }
+
+  return 0;
+}
+
+
+// The unitary tests are run in separate processes
+// START_TEST is a "static" definition of a function
+START_TEST(test_crtn_sem_handoff)
+
+int rc;
+crtn_sem_t sem;
+int status;
+int i;
+
+  // ------- One V wakes up only the oldest waiting coroutine
+  rc = crtn_sem_new(&sem, 0);
+  ck_assert_int_eq(rc, 0);
+
+  for (i = 0; i < 3; i ++) {
+    rc = crtn_spawn(&(sem_cid[i]), "sem_order", entry_sem_order, &sem, 0);
+    ck_assert_int_eq(rc, 0);
+  }
+
+  // Make the coroutines wait on the semaphore
+  crtn_yield(0);
+
+  for (i = 0; i < 3; i ++) {
+
+    rc = crtn_sem_v(sem);
+    ck_assert_int_eq(rc, 0);
+
+    // Only one coroutine got the semaphore
+    crtn_yield(0);
+    ck_assert_int_eq(sem_nb_p, i + 1);
+  }
+
+  for (i = 0; i < 3; i ++) {
+    rc = crtn_join(sem_cid[i], &status);
+    ck_assert_int_eq(rc, 0);
+    ck_assert_int_eq(status, 0);
+    ck_assert_int_eq(sem_order[i], i);
+  }
+
+  // ------- The token handed off to a cancelled coroutine is
+  //         passed to the next waiting coroutine
+  sem_nb_p = 0;
+
+  for (i = 0; i < 2; i ++) {
+    rc = crtn_spawn(&(sem_cid[i]), "sem_order", entry_sem_order, &sem, 0);
+    ck_assert_int_eq(rc, 0);
+  }
+
+  crtn_yield(0);
+
+  rc = crtn_sem_v(sem);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_cancel(sem_cid[0]);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_join(sem_cid[0], &status);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_int_eq(status, CRTN_STATUS_CANCELLED);
+
+  rc = crtn_join(sem_cid[1], &status);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_int_eq(status, 0);
+  ck_assert_int_eq(sem_nb_p, 1);
+  ck_assert_int_eq(sem_order[0], 1);
+
+  // ------- Without waiting coroutine, the token is given
+  //         back to the semaphore
+  rc = crtn_spawn(&(sem_cid[0]), "sem_order", entry_sem_order, &sem, 0);
+  ck_assert_int_eq(rc, 0);
+
+  crtn_yield(0);
+
+  rc = crtn_sem_v(sem);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_cancel(sem_cid[0]);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_join(sem_cid[0], &status);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_int_eq(status, CRTN_STATUS_CANCELLED);
+
+  // Does not block
+  rc = crtn_sem_p(sem);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_sem_delete(sem);
+  ck_assert_int_eq(rc, 0);
+
+END_TEST
+
+
+static int entry_late_v(void *p)
+{
+  crtn_sem_t sem = *((crtn_sem_t *)p);
+  crtn_time_t t0;
+  int rc;
+
+  t0 = now_ns();
+  while ((now_ns() - t0) < CRTN_MSEC(10)) {
+    crtn_yield(0);
+  }
+
+  rc = crtn_sem_v(sem);
+  ck_assert_int_eq(rc, 0);
+
+  return 0;
+}
+
+
+// The unitary tests are run in separate processes
+// START_TEST is a "static" definition of a function
+START_TEST(test_crtn_sem_timedp)
+
+int rc;
+crtn_sem_t sem;
+crtn_t cid;
+crtn_time_t t0;
+
+  rc = crtn_sem_new(&sem, 0);
+  ck_assert_int_eq(rc, 0);
+
+  // ------- No other coroutine: the library sleeps until the deadline
+  t0 = now_ns();
+  rc = crtn_sem_timedp(sem, CRTN_MSEC(20));
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), ETIMEDOUT);
+  ck_assert(now_ns() - t0 >= CRTN_MSEC(20));
+
+  // ------- The semaphore is released before the timeout
+  rc = crtn_spawn(&cid, "late_v", entry_late_v, &sem, 0);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_sem_timedp(sem, CRTN_SEC(10));
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_join(cid, 0);
+  ck_assert_int_eq(rc, 0);
+
+  // ------- The semaphore is released after the timeout
+  rc = crtn_spawn(&cid, "late_v", entry_late_v, &sem, 0);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_sem_timedp(sem, CRTN_MSEC(1));
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), ETIMEDOUT);
+
+  rc = crtn_join(cid, 0);
+  ck_assert_int_eq(rc, 0);
+
+  // The token is in the semaphore
+  rc = crtn_sem_timedp(sem, 0);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_sem_delete(sem);
+  ck_assert_int_eq(rc, 0);
+
+END_TEST
+
+
 #endif // HAVE_CRTN_SEM
 
 
 
+#ifdef HAVE_CRTN_IO
+
+static int io_pipe[2];
+static int io_events;
+
+static int entry_io_reader(void *p)
+{
+  char c;
+
+  (void)p;
+
+  io_events = crtn_wait_fd(io_pipe[0], CRTN_IO_IN, -1);
+  if (io_events > 0) {
+    ck_assert_int_eq(read(io_pipe[0], &c, 1), 1);
+    return c;
+  }
+
+  return -1;
+}
+
+
+static int entry_io_writer(void *p)
+{
+  (void)p;
+
+  crtn_sleep(CRTN_MSEC(10));
+  ck_assert_int_eq(write(io_pipe[1], "w", 1), 1);
+
+  return 0;
+}
+
+
+// The unitary tests are run in separate processes
+// START_TEST is a "static" definition of a function
+START_TEST(test_crtn_wait_fd)
+
+int rc;
+crtn_t cid;
+int status;
+int i;
+char c;
+crtn_time_t t0;
+
+  rc = pipe(io_pipe);
+  ck_assert_int_eq(rc, 0);
+
+  // ------- Only the waiting coroutine is suspended
+  io_events = 0;
+  rc = crtn_spawn(&cid, "reader", entry_io_reader, 0, 0);
+  ck_assert_int_eq(rc, 0);
+
+  for (i = 0; i < 200; i ++) {
+    rc = crtn_yield(0);
+    ck_assert_int_ne(rc, -1);
+  }
+  ck_assert_int_eq(io_events, 0);
+
+  ck_assert_int_eq(write(io_pipe[1], "a", 1), 1);
+  rc = crtn_join(cid, &status);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_int_eq(status, 'a');
+  ck_assert_int_eq(io_events, CRTN_IO_IN);
+
+  // ------- No runnable coroutine: sleep in the reactor until the event
+  rc = crtn_spawn(&cid, "writer", entry_io_writer, 0, 0);
+  ck_assert_int_eq(rc, 0);
+  t0 = crtn_now();
+  rc = crtn_wait_fd(io_pipe[0], CRTN_IO_IN, CRTN_SEC(5));
+  ck_assert_int_eq(rc, CRTN_IO_IN);
+  ck_assert(crtn_now() - t0 >= CRTN_MSEC(10));
+  ck_assert(crtn_now() - t0 < CRTN_SEC(5));
+  ck_assert_int_eq(read(io_pipe[0], &c, 1), 1);
+  ck_assert_int_eq(c, 'w');
+  rc = crtn_join(cid, &status);
+  ck_assert_int_eq(rc, 0);
+
+  // ------- Timeout
+  t0 = crtn_now();
+  rc = crtn_wait_fd(io_pipe[0], CRTN_IO_IN, CRTN_MSEC(20));
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), ETIMEDOUT);
+  ck_assert(crtn_now() - t0 >= CRTN_MSEC(20));
+
+  // ------- Null timeout
+  rc = crtn_wait_fd(io_pipe[0], CRTN_IO_IN, 0);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), ETIMEDOUT);
+
+  rc = crtn_wait_fd(io_pipe[1], CRTN_IO_OUT, 0);
+  ck_assert_int_eq(rc, CRTN_IO_OUT);
+
+  // ------- Cancellation of a waiting coroutine releases the file descriptor
+  rc = crtn_spawn(&cid, "reader", entry_io_reader, 0, 0);
+  ck_assert_int_eq(rc, 0);
+  rc = crtn_yield(0);
+  ck_assert_int_eq(rc, CRTN_SCHED_OTHER);
+  rc = crtn_cancel(cid);
+  ck_assert_int_eq(rc, 0);
+  rc = crtn_join(cid, &status);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_int_eq(status, CRTN_STATUS_CANCELLED);
+
+  rc = crtn_wait_fd(io_pipe[1], CRTN_IO_OUT, CRTN_SEC(1));
+  ck_assert_int_eq(rc, CRTN_IO_OUT);
+
+  // ------- Hang up
+  close(io_pipe[1]);
+  rc = crtn_wait_fd(io_pipe[0], CRTN_IO_IN, -1);
+  ck_assert(rc & CRTN_IO_HUP);
+
+  close(io_pipe[0]);
+
+END_TEST
+
+
+#define IO_BLOCK 4096
+#define IO_NB    8
+
+static int io_fd;
+
+static int entry_io_pread(void *p)
+{
+  int n = *(int *)p;
+  char buf[IO_BLOCK];
+  int i;
+
+  ck_assert_int_eq(crtn_pread(io_fd, buf, IO_BLOCK, n * IO_BLOCK), IO_BLOCK);
+  for (i = 0; i < IO_BLOCK; i ++) {
+    ck_assert_int_eq(buf[i], 'a' + n);
+  }
+
+  return n;
+}
+
+
+static int entry_io_read(void *p)
+{
+  char buf[16];
+  ssize_t rc;
+
+  (void)p;
+
+  rc = crtn_read(io_pipe[0], buf, sizeof(buf));
+
+  return (int)rc;
+}
+
+
+// The unitary tests are run in separate processes
+// START_TEST is a "static" definition of a function
+START_TEST(test_crtn_read)
+
+ssize_t rc;
+crtn_t cid[IO_NB];
+int param[IO_NB];
+int status;
+int i;
+char buf[IO_BLOCK];
+FILE *f;
+
+  f = tmpfile();
+  ck_assert_ptr_ne(f, NULL);
+  io_fd = fileno(f);
+
+  // ------- Regular file
+  rc = crtn_write(io_fd, "hello world", 11);
+  ck_assert_int_eq(rc, 11);
+  rc = crtn_pread(io_fd, buf, 5, 6);
+  ck_assert_int_eq(rc, 5);
+  ck_assert(!memcmp(buf, "world", 5));
+  ck_assert_int_eq(lseek(io_fd, 0, SEEK_SET), 0);
+  rc = crtn_read(io_fd, buf, sizeof(buf));
+  ck_assert_int_eq(rc, 11);
+  ck_assert(!memcmp(buf, "hello world", 11));
+  rc = crtn_read(io_fd, buf, sizeof(buf));
+  ck_assert_int_eq(rc, 0);
+
+  // ------- Concurrent reads of the blocks of a file
+  for (i = 0; i < IO_NB; i ++) {
+    memset(buf, 'a' + i, IO_BLOCK);
+    rc = crtn_pwrite(io_fd, buf, IO_BLOCK, i * IO_BLOCK);
+    ck_assert_int_eq(rc, IO_BLOCK);
+  }
+
+  for (i = 0; i < IO_NB; i ++) {
+    param[i] = IO_NB - 1 - i;
+    rc = crtn_spawn(&(cid[i]), "pread", entry_io_pread, &(param[i]), 0);
+    ck_assert_int_eq(rc, 0);
+  }
+  for (i = 0; i < IO_NB; i ++) {
+    rc = crtn_join(cid[i], &status);
+    ck_assert_int_eq(rc, 0);
+    ck_assert_int_eq(status, IO_NB - 1 - i);
+  }
+
+  fclose(f);
+
+  // ------- Pipe: only the reading coroutine is suspended
+  rc = pipe(io_pipe);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_spawn(&(cid[0]), "read", entry_io_read, 0, 0);
+  ck_assert_int_eq(rc, 0);
+  for (i = 0; i < 100; i ++) {
+    rc = crtn_yield(0);
+    ck_assert_int_ne(rc, -1);
+  }
+  rc = crtn_write(io_pipe[1], "abc", 3);
+  ck_assert_int_eq(rc, 3);
+  rc = crtn_join(cid[0], &status);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_int_eq(status, 3);
+
+  // ------- Cancellation of a coroutine suspended in a read
+  rc = crtn_spawn(&(cid[0]), "read", entry_io_read, 0, 0);
+  ck_assert_int_eq(rc, 0);
+  rc = crtn_yield(0);
+  ck_assert_int_eq(rc, CRTN_SCHED_OTHER);
+  rc = crtn_cancel(cid[0]);
+  ck_assert_int_eq(rc, 0);
+  // The cancellation is in progress until the read is aborted
+  rc = crtn_cancel(cid[0]);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EBUSY);
+  rc = crtn_join(cid[0], &status);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_int_eq(status, CRTN_STATUS_CANCELLED);
+
+  // The data are not consumed by the cancelled read
+  rc = crtn_write(io_pipe[1], "xy", 2);
+  ck_assert_int_eq(rc, 2);
+  rc = crtn_read(io_pipe[0], buf, sizeof(buf));
+  ck_assert_int_eq(rc, 2);
+  ck_assert(!memcmp(buf, "xy", 2));
+
+  // ------- End of file
+  close(io_pipe[1]);
+  rc = crtn_read(io_pipe[0], buf, sizeof(buf));
+  ck_assert_int_eq(rc, 0);
+  close(io_pipe[0]);
+
+END_TEST
+
+
+#endif // HAVE_CRTN_IO
+
+
+
 TCase *crtn_api_tests(void)
 {
 TCase *tc_api;
@@ -1432,6 +3366,18 @@ TCase *tc_api;
   tcase_add_test(tc_api, test_crtn_wait);
   tcase_add_test(tc_api, test_crtn_cancel);
   tcase_add_test(tc_api, test_crtn_join);
+  tcase_add_test(tc_api, test_crtn_sigmask);
+  tcase_add_test(tc_api, test_crtn_stack_cache);
+  tcase_add_test(tc_api, test_crtn_stale_cid);
+  tcase_add_test(tc_api, test_crtn_timedjoin);
+  tcase_add_test(tc_api, test_crtn_sleep);
+  tcase_add_test(tc_api, test_crtn_stack_guard);
+  tcase_add_test(tc_api, test_crtn_stack_lazy);
+  tcase_add_test(tc_api, test_crtn_prio);
+  tcase_add_test(tc_api, test_crtn_deadline);
+  tcase_add_test(tc_api, test_crtn_yield_to);
+  tcase_add_test(tc_api, test_crtn_gen);
+  tcase_add_test(tc_api, test_crtn_copystack);
 
 #ifdef HAVE_CRTN_MBX
   tcase_add_test(tc_api, test_crtn_mbx_new);
@@ -1440,6 +3386,11 @@ TCase *tc_api;
   tcase_add_test(tc_api, test_crtn_mbx_get);
   tcase_add_test(tc_api, test_crtn_mbx_tryget);
   tcase_add_test(tc_api, test_crtn_mbx_format);
+  tcase_add_test(tc_api, test_crtn_mbx_handoff);
+  tcase_add_test(tc_api, test_crtn_mbx_bounded);
+  tcase_add_test(tc_api, test_crtn_mbx_batch);
+  tcase_add_test(tc_api, test_crtn_mbx_alloc);
+  tcase_add_test(tc_api, test_crtn_mbx_timedget);
 #endif // HAVE_CRTN_MBX
 
 #ifdef HAVE_CRTN_SEM
@@ -1447,7 +3398,14 @@ TCase *tc_api;
   tcase_add_test(tc_api, test_crtn_sem_delete);
   tcase_add_test(tc_api, test_crtn_sem_p);
   tcase_add_test(tc_api, test_crtn_sem_v);
+  tcase_add_test(tc_api, test_crtn_sem_handoff);
+  tcase_add_test(tc_api, test_crtn_sem_timedp);
 #endif // HAVE_CRTN_SEM
 
+#ifdef HAVE_CRTN_IO
+  tcase_add_test(tc_api, test_crtn_wait_fd);
+  tcase_add_test(tc_api, test_crtn_read);
+#endif // HAVE_CRTN_IO
+
   return tc_api;
 } // crtn_api_tests
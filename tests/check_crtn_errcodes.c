@@ -29,6 +29,8 @@
 
 #include "../config.h"
 #include <errno.h>
+#include <stdio.h>
+#include <unistd.h>
 
 #include "crtn.h"
 
@@ -122,6 +124,149 @@ int status;
   ck_assert_int_eq(rc, 0);
   ck_assert_int_eq(status, -1);
 
+  rc = crtn_timedjoin(56000, 0, 0);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), ENOENT);
+
+  rc = crtn_spawn(&cid, "foo", dummy_entry1, 0, 0);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_timedjoin(cid, &status, -1);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+
+  // Null timeout and the coroutine is not finished
+  rc = crtn_timedjoin(cid, &status, 0);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), ETIMEDOUT);
+
+  rc = crtn_join(cid, &status);
+  ck_assert_int_eq(rc, 0);
+
+END_TEST
+
+
+// The unitary tests are run in separate processes
+// START_TEST is a "static" definition of a function
+START_TEST(test_crtn_sleep)
+
+int rc;
+
+  rc = crtn_sleep(-1);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+
+  rc = crtn_sleep_until(-1);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+
+END_TEST
+
+
+
+static int dummy_entry_nop(void *p)
+{
+  (void)p;
+
+  return 0;
+}
+
+
+// The unitary tests are run in separate processes
+// START_TEST is a "static" definition of a function
+START_TEST(test_crtn_yield_to)
+
+int rc;
+crtn_t cid;
+crtn_attr_t attr;
+
+  rc = crtn_yield_to(56000, 0);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), ENOENT);
+
+  rc = crtn_yield_to(CRTN_CID_MAIN, 0);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+
+  // ------- The target is a stepper
+  attr = crtn_attr_new();
+  ck_assert_ptr_ne(attr, NULL);
+  rc = crtn_set_attr_type(attr, CRTN_TYPE_STEPPER);
+  ck_assert_int_eq(rc, 0);
+  rc = crtn_spawn(&cid, "dummy", dummy_entry_nop, 0, attr);
+  ck_assert_int_eq(rc, 0);
+  rc = crtn_attr_delete(attr);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_yield_to(cid, 0);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EPERM);
+
+  rc = crtn_cancel(cid);
+  ck_assert_int_eq(rc, 0);
+  rc = crtn_join(cid, 0);
+  ck_assert_int_eq(rc, 0);
+
+  // ------- The target is not runnable
+  rc = crtn_spawn(&cid, "dummy", dummy_entry_nop, 0, 0);
+  ck_assert_int_eq(rc, 0);
+  rc = crtn_yield(0);
+  ck_assert_int_eq(rc, CRTN_SCHED_OTHER);
+
+  rc = crtn_yield_to(cid, 0);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EPERM);
+
+  rc = crtn_join(cid, 0);
+  ck_assert_int_eq(rc, 0);
+
+END_TEST
+
+
+// The unitary tests are run in separate processes
+// START_TEST is a "static" definition of a function
+START_TEST(test_crtn_gen_next)
+
+int rc;
+crtn_t cid;
+void *out;
+
+  rc = crtn_gen_next(56000, 0, &out);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), ENOENT);
+
+  rc = crtn_gen_next(CRTN_CID_MAIN, 0, &out);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+
+  // ------- Not a stepper
+  rc = crtn_spawn(&cid, "dummy", dummy_entry_nop, 0, 0);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_gen_next(cid, 0, &out);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+
+  rc = crtn_join(cid, 0);
+  ck_assert_int_eq(rc, 0);
+
+END_TEST
+
+
+// The unitary tests are run in separate processes
+// START_TEST is a "static" definition of a function
+START_TEST(test_crtn_set_deadline)
+
+int rc;
+
+  rc = crtn_set_deadline(56000, 0);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), ENOENT);
+
+  // A negative deadline is not an error
+  rc = crtn_set_deadline(CRTN_CID_MAIN, -1);
+  ck_assert_int_eq(rc, 0);
+
 END_TEST
 
 
@@ -293,6 +438,26 @@ crtn_attr_t attr;
   ck_assert_int_eq(rc, -1);
   ck_assert_int_eq(crtn_errno(), EINVAL);
 
+  rc = crtn_set_attr_sigmask(0, 1);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+
+  rc = crtn_set_attr_stack_mode(0, CRTN_STACK_GUARD);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+
+  rc = crtn_set_attr_stack_mode(attr, 0xFFFFFFFF);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+
+  rc = crtn_set_attr_prio(0, CRTN_PRIO_HIGHEST);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+
+  rc = crtn_set_attr_prio(attr, CRTN_PRIO_LOWEST + 1);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+
   rc = crtn_set_attr_type(attr, CRTN_TYPE_STACKLESS);
   ck_assert_int_eq(rc, 0);
 
@@ -313,11 +478,20 @@ END_TEST
 START_TEST(test_crtn_mbx_new)
 
 int rc;
+crtn_mbx_t id;
 
   rc = crtn_mbx_new(0);
   ck_assert_int_eq(rc, -1);
   ck_assert_int_eq(crtn_errno(), EINVAL);
 
+  rc = crtn_mbx_new_bounded(0, 1);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+
+  rc = crtn_mbx_new_bounded(&id, 0);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+
 END_TEST
 
 
@@ -326,6 +500,7 @@ END_TEST
 START_TEST(test_crtn_mbx_delete)
 
 int rc;
+crtn_mbx_t id;
 
   rc = crtn_mbx_delete(-1);
   ck_assert_int_eq(rc, -1);
@@ -335,6 +510,15 @@ int rc;
   ck_assert_int_eq(rc, -1);
   ck_assert_int_eq(crtn_errno(), EINVAL);
 
+  // Double deletion
+  rc = crtn_mbx_new(&id);
+  ck_assert_int_eq(rc, 0);
+  rc = crtn_mbx_delete(id);
+  ck_assert_int_eq(rc, 0);
+  rc = crtn_mbx_delete(id);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+
 END_TEST
 
 
@@ -359,6 +543,106 @@ int rc;
 END_TEST
 
 
+// The unitary tests are run in separate processes
+// START_TEST is a "static" definition of a function
+START_TEST(test_crtn_mbx_trypost)
+
+int rc;
+crtn_mbx_t id;
+void *msg;
+
+  rc = crtn_mbx_trypost(-1, 0);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+
+  rc = crtn_mbx_trypost(CRTN_MBX_MAX, 0);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+
+  rc = crtn_mbx_trypost(0, 0);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+
+  // Full mailbox
+  rc = crtn_mbx_new_bounded(&id, 1);
+  ck_assert_int_eq(rc, 0);
+  msg = crtn_mbx_alloc(10);
+  ck_assert_ptr_ne(msg, 0);
+  rc = crtn_mbx_trypost(id, msg);
+  ck_assert_int_eq(rc, 0);
+  msg = crtn_mbx_alloc(10);
+  ck_assert_ptr_ne(msg, 0);
+  rc = crtn_mbx_trypost(id, msg);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EAGAIN);
+
+END_TEST
+
+// The unitary tests are run in separate processes
+// START_TEST is a "static" definition of a function
+START_TEST(test_crtn_mbx_post_n)
+
+int rc;
+crtn_mbx_t id;
+void *msgs[2];
+
+  rc = crtn_mbx_post_n(-1, 0, 0);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+
+  rc = crtn_mbx_post_n(CRTN_MBX_MAX, 0, 0);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+
+  rc = crtn_mbx_new(&id);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_mbx_post_n(id, 0, 1);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+
+  // NULL message in the array
+  msgs[0] = crtn_mbx_alloc(10);
+  ck_assert_ptr_ne(msgs[0], 0);
+  msgs[1] = 0;
+  rc = crtn_mbx_post_n(id, msgs, 2);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+
+END_TEST
+
+
+// The unitary tests are run in separate processes
+// START_TEST is a "static" definition of a function
+START_TEST(test_crtn_mbx_get_n)
+
+int rc;
+crtn_mbx_t id;
+void *msgs[2];
+
+  rc = crtn_mbx_get_n(-1, 0, 0);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+
+  rc = crtn_mbx_get_n(CRTN_MBX_MAX, 0, 0);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+
+  rc = crtn_mbx_new(&id);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_mbx_get_n(id, 0, 1);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+
+  rc = crtn_mbx_get_n(id, msgs, 0);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+
+END_TEST
+
+
+
 // The unitary tests are run in separate processes
 // START_TEST is a "static" definition of a function
 START_TEST(test_crtn_mbx_get)
@@ -401,6 +685,41 @@ int rc;
 END_TEST
 
 
+// The unitary tests are run in separate processes
+// START_TEST is a "static" definition of a function
+START_TEST(test_crtn_mbx_timedget)
+
+int rc;
+crtn_mbx_t id;
+void *msg;
+
+  rc = crtn_mbx_timedget(-1, 0, 0);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+
+  rc = crtn_mbx_timedget(CRTN_MBX_MAX, 0, 0);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+
+  rc = crtn_mbx_new(&id);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_mbx_timedget(id, 0, 0);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+
+  rc = crtn_mbx_timedget(id, &msg, -1);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+
+  // Empty mailbox and null timeout
+  rc = crtn_mbx_timedget(id, &msg, 0);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), ETIMEDOUT);
+
+END_TEST
+
+
 // The unitary tests are run in separate processes
 // START_TEST is a "static" definition of a function
 START_TEST(test_crtn_mbx_free)
@@ -463,6 +782,7 @@ END_TEST
 START_TEST(test_crtn_sem_delete)
 
 int rc;
+crtn_sem_t id;
 
   rc = crtn_sem_delete(-1);
   ck_assert_int_eq(rc, -1);
@@ -472,6 +792,15 @@ int rc;
   ck_assert_int_eq(rc, -1);
   ck_assert_int_eq(crtn_errno(), EINVAL);
 
+  // Double deletion
+  rc = crtn_sem_new(&id, 0);
+  ck_assert_int_eq(rc, 0);
+  rc = crtn_sem_delete(id);
+  ck_assert_int_eq(rc, 0);
+  rc = crtn_sem_delete(id);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+
 END_TEST
 
 
@@ -509,9 +838,146 @@ int rc;
 END_TEST
 
 
+// The unitary tests are run in separate processes
+// START_TEST is a "static" definition of a function
+START_TEST(test_crtn_sem_timedp)
+
+int rc;
+crtn_sem_t id;
+
+  rc = crtn_sem_timedp(-1, 0);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+
+  rc = crtn_sem_timedp(CRTN_SEM_MAX, 0);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+
+  rc = crtn_sem_new(&id, 0);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_sem_timedp(id, -1);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+
+  // Null counter and null timeout
+  rc = crtn_sem_timedp(id, 0);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), ETIMEDOUT);
+
+END_TEST
+
+
 #endif // HAVE_CRTN_MBX
 
 
+
+#ifdef HAVE_CRTN_IO
+
+static int fd_waiter(void *p)
+{
+  return crtn_wait_fd(*(int *)p, CRTN_IO_IN, -1);
+}
+
+// The unitary tests are run in separate processes
+// START_TEST is a "static" definition of a function
+START_TEST(test_crtn_wait_fd)
+
+int rc;
+int fd[2];
+crtn_t cid;
+int status;
+FILE *f;
+
+  rc = crtn_wait_fd(-1, CRTN_IO_IN, -1);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+
+  rc = crtn_wait_fd(0, 0, -1);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+
+  rc = crtn_wait_fd(0, CRTN_IO_HUP, -1);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+
+  rc = crtn_wait_fd(999, CRTN_IO_IN, -1);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EBADF);
+
+  rc = crtn_wait_fd(999, CRTN_IO_IN, 0);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EBADF);
+
+  // Regular file
+  f = tmpfile();
+  ck_assert_ptr_ne(f, NULL);
+  rc = crtn_wait_fd(fileno(f), CRTN_IO_IN, -1);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EPERM);
+  fclose(f);
+
+  // Two coroutines on the same file descriptor
+  rc = pipe(fd);
+  ck_assert_int_eq(rc, 0);
+  rc = crtn_spawn(&cid, "waiter", fd_waiter, &(fd[0]), 0);
+  ck_assert_int_eq(rc, 0);
+  rc = crtn_yield(0);
+  ck_assert_int_eq(rc, CRTN_SCHED_OTHER);
+  rc = crtn_wait_fd(fd[0], CRTN_IO_IN, -1);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EBUSY);
+  ck_assert_int_eq(write(fd[1], "x", 1), 1);
+  rc = crtn_join(cid, &status);
+  ck_assert_int_eq(rc, 0);
+  ck_assert_int_eq(status, CRTN_IO_IN);
+
+  close(fd[0]);
+  close(fd[1]);
+
+END_TEST
+
+
+// The unitary tests are run in separate processes
+// START_TEST is a "static" definition of a function
+START_TEST(test_crtn_read)
+
+ssize_t rc;
+int fd[2];
+char buf[8];
+
+  rc = crtn_read(-1, buf, sizeof(buf));
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EBADF);
+
+  rc = crtn_write(-1, buf, sizeof(buf));
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EBADF);
+
+  rc = crtn_read(999, buf, sizeof(buf));
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EBADF);
+
+  rc = pipe(fd);
+  ck_assert_int_eq(rc, 0);
+
+  rc = crtn_pread(fd[0], buf, sizeof(buf), -1);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+
+  rc = crtn_pwrite(fd[1], buf, sizeof(buf), -1);
+  ck_assert_int_eq(rc, -1);
+  ck_assert_int_eq(crtn_errno(), EINVAL);
+
+  close(fd[0]);
+  close(fd[1]);
+
+END_TEST
+
+
+#endif // HAVE_CRTN_IO
+
+
 TCase *crtn_errcodes_tests(void)
 {
 TCase *tc_err_code;
@@ -526,6 +992,10 @@ TCase *tc_err_code;
   tcase_add_checked_fixture(tc_err_code, crtn_setup_checked_fixture, 0);
   tcase_add_test(tc_err_code, test_crtn_spawn);
   tcase_add_test(tc_err_code, test_crtn_join);
+  tcase_add_test(tc_err_code, test_crtn_sleep);
+  tcase_add_test(tc_err_code, test_crtn_set_deadline);
+  tcase_add_test(tc_err_code, test_crtn_yield_to);
+  tcase_add_test(tc_err_code, test_crtn_gen_next);
   tcase_add_test(tc_err_code, test_crtn_wait);
   tcase_add_test(tc_err_code, test_crtn_cancel);
   tcase_add_test(tc_err_code, test_crtn_attr);
@@ -534,8 +1004,12 @@ TCase *tc_err_code;
   tcase_add_test(tc_err_code, test_crtn_mbx_new);
   tcase_add_test(tc_err_code, test_crtn_mbx_delete);
   tcase_add_test(tc_err_code, test_crtn_mbx_post);
+  tcase_add_test(tc_err_code, test_crtn_mbx_trypost);
+  tcase_add_test(tc_err_code, test_crtn_mbx_post_n);
+  tcase_add_test(tc_err_code, test_crtn_mbx_get_n);
   tcase_add_test(tc_err_code, test_crtn_mbx_get);
   tcase_add_test(tc_err_code, test_crtn_mbx_tryget);
+  tcase_add_test(tc_err_code, test_crtn_mbx_timedget);
   tcase_add_test(tc_err_code, test_crtn_mbx_free);
   tcase_add_test(tc_err_code, test_crtn_mbx_format);
 #endif // HAVE_CRTN_MBX
@@ -545,7 +1019,13 @@ TCase *tc_err_code;
   tcase_add_test(tc_err_code, test_crtn_sem_delete);
   tcase_add_test(tc_err_code, test_crtn_sem_v);
   tcase_add_test(tc_err_code, test_crtn_sem_p);
+  tcase_add_test(tc_err_code, test_crtn_sem_timedp);
 #endif // HAVE_CRTN_SEM
 
+#ifdef HAVE_CRTN_IO
+  tcase_add_test(tc_err_code, test_crtn_wait_fd);
+  tcase_add_test(tc_err_code, test_crtn_read);
+#endif // HAVE_CRTN_IO
+
   return tc_err_code;
 } // crtn_errcodes_tests
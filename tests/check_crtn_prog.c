@@ -141,7 +141,7 @@ START_TEST(test_crtn_fibonacci)
     ck_assert_exited(status, CRTN_STATUS_CANCELLED);
   }
 
-  // ------- Environment variable too big to trigger a malloc() error
+  // ------- Huge environment variable: the table of coroutines grows on demand
   snprintf(max_long, sizeof(max_long), "%ld", LONG_MAX - 1);
   rc = setenv("CRTN_MAX", max_long, 1);
   ck_assert_int_eq(rc, 0);
@@ -156,13 +156,30 @@ START_TEST(test_crtn_fibonacci)
   ck_assert_int_eq(rc, 0);
   rc = waitpid(pid, &status, 0);
   ck_assert_int_eq(rc, pid);
-  // The programs will crash as the table of coroutines is not allocated
-  // The coverage data is available as we installed a signal handler on
-  // SIGSEGV to exit gracefully with exit code 7
-  ck_assert_exited(status, 7);
+  // The programs returns the status of the cancelled coroutine
+  ck_assert_exited(status, CRTN_STATUS_CANCELLED);
   rc = unsetenv("CRTN_MAX");
   ck_assert_int_eq(rc, 0);
 
+  // ------- No stack cache
+  rc = setenv("CRTN_STACK_CACHE", "0", 1);
+  ck_assert_int_eq(rc, 0);
+
+  av[0] = pathname;
+  av[1] = (char *)0;
+  rc = ck_exec_prog(av);
+  ck_assert_int_gt(rc, 0);
+  pid = rc;
+  sleep(2);
+  rc = kill(pid, SIGINT);
+  ck_assert_int_eq(rc, 0);
+  rc = waitpid(pid, &status, 0);
+  ck_assert_int_eq(rc, pid);
+  // The programs returns the status of the cancelled coroutine
+  ck_assert_exited(status, CRTN_STATUS_CANCELLED);
+  rc = unsetenv("CRTN_STACK_CACHE");
+  ck_assert_int_eq(rc, 0);
+
 #ifdef HAVE_CRTN_MBX
   // ------- Environment variables too big to trigger a malloc error
   rc = setenv("CRTN_MBX_MAX", max_long, 1);
@@ -182,6 +199,25 @@ START_TEST(test_crtn_fibonacci)
   ck_assert_exited(status, CRTN_STATUS_CANCELLED);
   rc = unsetenv("CRTN_MBX_MAX");
   ck_assert_int_eq(rc, 0);
+
+  // ------- Preallocation too big for the size of the slabs
+  rc = setenv("CRTN_MBX_PREALLOC", max_long, 1);
+  ck_assert_int_eq(rc, 0);
+
+  av[0] = pathname;
+  av[1] = (char *)0;
+  rc = ck_exec_prog(av);
+  ck_assert_int_gt(rc, 0);
+  pid = rc;
+  sleep(2);
+  rc = kill(pid, SIGINT);
+  ck_assert_int_eq(rc, 0);
+  rc = waitpid(pid, &status, 0);
+  ck_assert_int_eq(rc, pid);
+  // The programs returns the status of the cancelled coroutine
+  ck_assert_exited(status, CRTN_STATUS_CANCELLED);
+  rc = unsetenv("CRTN_MBX_PREALLOC");
+  ck_assert_int_eq(rc, 0);
 #endif // HAVE_CRTN_MBX
 
 
@@ -210,6 +246,92 @@ START_TEST(test_crtn_fibonacci)
 END_TEST
 
 
+#if defined(HAVE_CRTN_MT) && defined(HAVE_CRTN_MBX) && defined(HAVE_CRTN_SEM)
+START_TEST(test_crtn_mt)
+
+  int rc;
+  char *av[30];
+  char pathname[256];
+  pid_t pid;
+  int status;
+
+  snprintf(pathname, sizeof(pathname), "%s/tests/mt", CRTN_BUILD_DIR);
+
+  // ------- Several threads (whatever the number of processors)
+  rc = setenv("CRTN_WORKERS", "4", 1);
+  ck_assert_int_eq(rc, 0);
+  rc = setenv("CRTN_MAX", "64", 1);
+  ck_assert_int_eq(rc, 0);
+
+  av[0] = pathname;
+  av[1] = "16";
+  av[2] = "2000";
+  av[3] = (char *)0;
+  rc = ck_exec_prog(av);
+  ck_assert_int_gt(rc, 0);
+  pid = rc;
+  rc = waitpid(pid, &status, 0);
+  ck_assert_int_eq(rc, pid);
+  // The program checks that all the messages have been received
+  ck_assert_exited(status, 0);
+
+  // ------- One thread
+  rc = setenv("CRTN_WORKERS", "1", 1);
+  ck_assert_int_eq(rc, 0);
+
+  rc = ck_exec_prog(av);
+  ck_assert_int_gt(rc, 0);
+  pid = rc;
+  rc = waitpid(pid, &status, 0);
+  ck_assert_int_eq(rc, pid);
+  ck_assert_exited(status, 0);
+
+  rc = unsetenv("CRTN_WORKERS");
+  ck_assert_int_eq(rc, 0);
+  rc = unsetenv("CRTN_MAX");
+  ck_assert_int_eq(rc, 0);
+
+END_TEST
+#endif // HAVE_CRTN_MT && HAVE_CRTN_MBX && HAVE_CRTN_SEM
+
+
+#ifdef HAVE_CRTN_IO
+START_TEST(test_crtn_io)
+
+  int rc;
+  char *av[30];
+  char pathname[256];
+  pid_t pid;
+  int status;
+
+  snprintf(pathname, sizeof(pathname), "%s/tests/io", CRTN_BUILD_DIR);
+
+  // ------- Submission queue full and completion queue overflow
+  rc = setenv("CRTN_IO_RING", "1", 1);
+  ck_assert_int_eq(rc, 0);
+  rc = setenv("CRTN_MAX", "1024", 1);
+  ck_assert_int_eq(rc, 0);
+
+  av[0] = pathname;
+  av[1] = "500";
+  av[2] = (char *)0;
+  rc = ck_exec_prog(av);
+  ck_assert_int_gt(rc, 0);
+  pid = rc;
+  rc = waitpid(pid, &status, 0);
+  ck_assert_int_eq(rc, pid);
+  // The program checks that all the reads succeeded
+  ck_assert_exited(status, 0);
+
+  rc = unsetenv("CRTN_IO_RING");
+  ck_assert_int_eq(rc, 0);
+  rc = unsetenv("CRTN_MAX");
+  ck_assert_int_eq(rc, 0);
+
+END_TEST
+#endif // HAVE_CRTN_IO
+
+
 
 TCase *crtn_prog_tests(void)
 {
@@ -224,6 +346,12 @@ TCase *tc_prog;
   tcase_add_unchecked_fixture(tc_prog, crtn_setup_unchecked_fixture, 0);
   tcase_add_checked_fixture(tc_prog, crtn_setup_checked_fixture, 0);
   tcase_add_test(tc_prog, test_crtn_fibonacci);
+#if defined(HAVE_CRTN_MT) && defined(HAVE_CRTN_MBX) && defined(HAVE_CRTN_SEM)
+  tcase_add_test(tc_prog, test_crtn_mt);
+#endif // HAVE_CRTN_MT && HAVE_CRTN_MBX && HAVE_CRTN_SEM
+#ifdef HAVE_CRTN_IO
+  tcase_add_test(tc_prog, test_crtn_io);
+#endif // HAVE_CRTN_IO
 
   return tc_prog;
 } // crtn_prog_tests
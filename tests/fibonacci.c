@@ -140,7 +140,7 @@ int main(void)
     rc = crtn_wait(cid, (void **)&seq);
     if (rc != 0) {
       errno = crtn_errno();
-      fprintf(stderr, "crtn_wait(%d): error '%m' (%d)\n", cid, errno);
+      fprintf(stderr, "crtn_wait(%lld): error '%m' (%d)\n", cid, errno);
       return 1;
     }
     printf("seq[%u]=%llu\n", i, *seq);
@@ -155,14 +155,14 @@ int main(void)
   rc = crtn_cancel(cid);
   if (rc != 0) {
     errno = crtn_errno();
-    fprintf(stderr, "crtn_cancel(%d): error '%m' (%d)\n", cid, errno);
+    fprintf(stderr, "crtn_cancel(%lld): error '%m' (%d)\n", cid, errno);
     return 1;
   }
 
   rc = crtn_join(cid, &status);
   if (rc != 0) {
     errno = crtn_errno();
-    fprintf(stderr, "crtn_join(%d): error '%m' (%d)\n", cid, errno);
+    fprintf(stderr, "crtn_join(%lld): error '%m' (%d)\n", cid, errno);
     return 1;
   }
 
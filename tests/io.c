@@ -0,0 +1,153 @@
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+// File        : io.c
+// Description : Program exercising the io_uring based operations
+// License     :
+//
+//  Copyright (C) 2021 Rachid Koucha <rachid dot koucha at gmail dot com>
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2.1 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to:
+//  the Free Software Foundation, Inc.,
+//  51 Franklin Street, Fifth Floor,
+//  Boston, MA  02110-1301  USA
+//
+//
+// Evolutions  :
+//
+//     17-Oct-2026 agent          - Creation
+//
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+//
+// Usage: io [nb_crtns]
+//
+// "nb_crtns" coroutines read concurrently: the even ones read a pipe
+// which is written once all of them are suspended, the odd ones read
+// a regular file. With a small ring (cf. CRTN_IO_RING), the submission
+// queue is full and the completion queue overflows. The program exits
+// with 0 if all the reads succeeded.
+//
+//   $ CRTN_IO_RING=1 CRTN_MAX=1024 ./io 500
+//
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "crtn.h"
+
+
+#define NB_CRTNS_MAX 1000
+
+static int file_fd;
+
+static int pipes[NB_CRTNS_MAX][2];
+
+static char data[] = "0123456789";
+
+
+
+static int reader(void *p)
+{
+  long    i = (long)p;
+  char    buf[sizeof(data)];
+  ssize_t rc;
+
+  if (i % 2) {
+    rc = crtn_pread(file_fd, buf, sizeof(buf), 0);
+  } else {
+    rc = crtn_read(pipes[i][0], buf, sizeof(buf));
+  }
+
+  if (rc != (ssize_t)sizeof(buf)) {
+    fprintf(stderr, "Reader#%ld: %zd bytes (%s)\n", i, rc, (rc < 0 ? strerror(crtn_errno()) : ""));
+    return 1;
+  }
+
+  if (memcmp(buf, data, sizeof(buf))) {
+    fprintf(stderr, "Reader#%ld: bad data\n", i);
+    return 1;
+  }
+
+  return 0;
+
+} // reader
+
+
+int main(int ac, char *av[])
+{
+  crtn_t cid[NB_CRTNS_MAX];
+  long   nb_crtns = 500;
+  long   i;
+  int    status;
+  int    rc = 0;
+  char   tmp[] = "/tmp/crtn_io_XXXXXX";
+
+  if (ac > 1) {
+    nb_crtns = atol(av[1]);
+  }
+  if ((nb_crtns <= 0) || (nb_crtns > NB_CRTNS_MAX)) {
+    fprintf(stderr, "Usage: %s [nb_crtns]\n", av[0]);
+    return 1;
+  }
+
+  file_fd = mkstemp(tmp);
+  if (file_fd < 0) {
+    perror("mkstemp()");
+    return 1;
+  }
+  unlink(tmp);
+  if (write(file_fd, data, sizeof(data)) != (ssize_t)sizeof(data)) {
+    perror("write()");
+    return 1;
+  }
+
+  for (i = 0; i < nb_crtns; i ++) {
+    if (0 == (i % 2) && (0 != pipe(pipes[i]))) {
+      perror("pipe()");
+      return 1;
+    }
+    if (0 != crtn_spawn(&(cid[i]), "reader", reader, (void *)i, 0)) {
+      fprintf(stderr, "crtn_spawn(): %s\n", strerror(crtn_errno()));
+      return 1;
+    }
+  }
+
+  // Let the readers submit their operations
+  for (i = 0; i < 10; i ++) {
+    crtn_yield(0);
+  }
+
+  for (i = 0; i < nb_crtns; i += 2) {
+    if (write(pipes[i][1], data, sizeof(data)) != (ssize_t)sizeof(data)) {
+      perror("write()");
+      return 1;
+    }
+  }
+
+  for (i = 0; i < nb_crtns; i ++) {
+    if ((0 != crtn_join(cid[i], &status)) || (0 != status)) {
+      rc = 1;
+    }
+  }
+
+  if (0 == rc) {
+    printf("%ld reads done\n", nb_crtns);
+  }
+
+  return rc;
+
+} // main
@@ -0,0 +1,316 @@
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+// File        : mt.c
+// Description : Program exercising the multithreaded runtime
+// License     :
+//
+//  Copyright (C) 2021 Rachid Koucha <rachid dot koucha at gmail dot com>
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2.1 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to:
+//  the Free Software Foundation, Inc.,
+//  51 Franklin Street, Fifth Floor,
+//  Boston, MA  02110-1301  USA
+//
+//
+// Evolutions  :
+//
+//     17-Oct-2026 agent          - Creation
+//
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+
+//
+// Usage: mt [nb_pairs] [nb_msgs]
+//
+// "nb_pairs" producers post "nb_msgs" messages each into a bounded
+// mailbox from which "nb_pairs" consumers get them. Each message is
+// accounted in a counter protected by a semaphore. The coroutines
+// yield and sleep from time to time to migrate between the threads
+// (cf. CRTN_WORKERS). The program exits with 0 if all the messages
+// have been received and accounted.
+//
+// Beforehand, a stepper is cancelled by a coroutine running on another
+// thread while it runs a step on behalf of crtn_wait().
+//
+//   $ CRTN_WORKERS=4 CRTN_MAX=64 ./mt 16 10000
+//
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include "crtn.h"
+
+
+#define NB_PAIRS_MAX 256
+
+static long nb_msgs = 10000;
+
+static crtn_mbx_t mbx;
+
+static crtn_sem_t lock;
+
+static unsigned long long counter;
+
+static int step_running;
+
+static int step_cancelled;
+
+
+
+static int producer(void *p)
+{
+  long  i;
+  long *msg;
+
+  (void)p;
+
+  for (i = 0; i < nb_msgs; i ++) {
+
+    msg = (long *)crtn_mbx_alloc(sizeof(long));
+    if (!msg) {
+      fprintf(stderr, "crtn_mbx_alloc(): %s\n", strerror(crtn_errno()));
+      return -1;
+    }
+
+    *msg = i;
+
+    if (0 != crtn_mbx_post(mbx, msg)) {
+      fprintf(stderr, "crtn_mbx_post(): %s\n", strerror(crtn_errno()));
+      return -1;
+    }
+
+    if (0 == (i % 64)) {
+      crtn_yield(0);
+    }
+  }
+
+  return 0;
+
+} // producer
+
+
+static int consumer(void *p)
+{
+  long  i;
+  long *msg;
+  long  sum = 0;
+
+  (void)p;
+
+  for (i = 0; i < nb_msgs; i ++) {
+
+    if (0 != crtn_mbx_get(mbx, (void **)&msg)) {
+      fprintf(stderr, "crtn_mbx_get(): %s\n", strerror(crtn_errno()));
+      return -1;
+    }
+
+    sum += *msg;
+    crtn_mbx_free(msg);
+
+    // Counter updated in a critical section
+    if (0 != crtn_sem_p(lock)) {
+      fprintf(stderr, "crtn_sem_p(): %s\n", strerror(crtn_errno()));
+      return -1;
+    }
+    counter ++;
+    if (0 == (i % 1000)) {
+      crtn_sleep(CRTN_USEC(100));
+    }
+    crtn_sem_v(lock);
+  }
+
+  // Sum of the indexes got by this consumer (modulo 2^31 - 1
+  // to keep a positive status)
+  return (int)(sum % 2147483647L);
+
+} // consumer
+
+
+static int stepper(void *p)
+{
+  struct timespec ts, now;
+
+  (void)p;
+
+  __atomic_store_n(&step_running, 1, __ATOMIC_RELEASE);
+
+  // Wait (at most 500 ms) for the cancellation from another thread
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  do {
+    clock_gettime(CLOCK_MONOTONIC, &now);
+  } while (!__atomic_load_n(&step_cancelled, __ATOMIC_ACQUIRE) &&
+           (((now.tv_sec - ts.tv_sec) * 1000000000L + (now.tv_nsec - ts.tv_nsec)) < 500000000L));
+
+  // End of the step
+  crtn_yield((void *)1);
+
+  for (;;) {
+    crtn_yield((void *)2);
+  }
+
+  return 0;
+
+} // stepper
+
+
+static int canceller(void *cid)
+{
+  int rc;
+
+  while (!__atomic_load_n(&step_running, __ATOMIC_ACQUIRE)) {
+    crtn_yield(0);
+  }
+
+  rc = crtn_cancel(*(crtn_t *)cid);
+  if (rc != 0) {
+    fprintf(stderr, "crtn_cancel(): %s\n", strerror(crtn_errno()));
+    return -1;
+  }
+
+  __atomic_store_n(&step_cancelled, 1, __ATOMIC_RELEASE);
+
+  return 0;
+
+} // canceller
+
+
+static int stepper_cancel(void)
+{
+  crtn_t       step;
+  crtn_t       canc;
+  crtn_attr_t  attr;
+  int          rc;
+  int          status;
+  void        *data;
+
+  attr = crtn_attr_new();
+  if (!attr ||
+      (0 != crtn_set_attr_type(attr, CRTN_TYPE_STEPPER)) ||
+      (0 != crtn_spawn(&step, "stepper", stepper, 0, attr)) ||
+      (0 != crtn_spawn(&canc, "canceller", canceller, &step, 0))) {
+    fprintf(stderr, "crtn_spawn(): %s\n", strerror(crtn_errno()));
+    return -1;
+  }
+  crtn_attr_delete(attr);
+
+  // The step completes even if the stepper is cancelled meanwhile
+  rc = crtn_wait(step, &data);
+  if ((0 != rc) || (data != (void *)1)) {
+    fprintf(stderr, "crtn_wait() returned %d (data %p)\n", rc, data);
+    return -1;
+  }
+
+  // The stepper runs its termination routine
+  if (__atomic_load_n(&step_cancelled, __ATOMIC_ACQUIRE)) {
+    rc = crtn_wait(step, &data);
+    if ((-1 != rc) || (EPERM != crtn_errno())) {
+      fprintf(stderr, "crtn_wait() on a cancelled stepper returned %d\n", rc);
+      return -1;
+    }
+  }
+
+  if ((0 != crtn_join(canc, &status)) || (0 != status)) {
+    fprintf(stderr, "Canceller failed\n");
+    return -1;
+  }
+
+  if ((0 != crtn_join(step, &status)) || (CRTN_STATUS_CANCELLED != status)) {
+    fprintf(stderr, "Stepper not cancelled\n");
+    return -1;
+  }
+
+  return 0;
+
+} // stepper_cancel
+
+
+int main(int ac, char *av[])
+{
+  crtn_t    prod[NB_PAIRS_MAX];
+  crtn_t    cons[NB_PAIRS_MAX];
+  long      nb_pairs = 8;
+  long      i;
+  int       status;
+  long long sum;
+  long long expected;
+
+  if (ac > 1) {
+    nb_pairs = atol(av[1]);
+  }
+  if (ac > 2) {
+    nb_msgs = atol(av[2]);
+  }
+  if ((nb_pairs <= 0) || (nb_pairs > NB_PAIRS_MAX) || (nb_msgs <= 0)) {
+    fprintf(stderr, "Usage: %s [nb_pairs] [nb_msgs]\n", av[0]);
+    return 1;
+  }
+
+  if (0 != stepper_cancel()) {
+    return 1;
+  }
+
+  if (0 != crtn_mbx_new_bounded(&mbx, 32)) {
+    fprintf(stderr, "crtn_mbx_new_bounded(): %s\n", strerror(crtn_errno()));
+    return 1;
+  }
+
+  if (0 != crtn_sem_new(&lock, 1)) {
+    fprintf(stderr, "crtn_sem_new(): %s\n", strerror(crtn_errno()));
+    return 1;
+  }
+
+  for (i = 0; i < nb_pairs; i ++) {
+    if (0 != crtn_spawn(&(cons[i]), "consumer", consumer, 0, 0) ||
+        0 != crtn_spawn(&(prod[i]), "producer", producer, 0, 0)) {
+      fprintf(stderr, "crtn_spawn(): %s\n", strerror(crtn_errno()));
+      return 1;
+    }
+  }
+
+  sum = 0;
+  for (i = 0; i < nb_pairs; i ++) {
+    if (0 != crtn_join(prod[i], &status) || (0 != status)) {
+      fprintf(stderr, "Producer#%ld failed\n", i);
+      return 1;
+    }
+    if (0 != crtn_join(cons[i], &status) || (status < 0)) {
+      fprintf(stderr, "Consumer#%ld failed\n", i);
+      return 1;
+    }
+    sum += status;
+  }
+
+  crtn_sem_delete(lock);
+  crtn_mbx_delete(mbx);
+
+  if (counter != (unsigned long long)(nb_pairs * nb_msgs)) {
+    fprintf(stderr, "Counter is %llu instead of %ld\n", counter, nb_pairs * nb_msgs);
+    return 1;
+  }
+
+  // The consumers may not get the same messages but all the messages
+  // are got: this is checked when the per consumer sums are not reduced
+  expected = (long long)nb_pairs * ((long long)nb_msgs * (nb_msgs - 1) / 2);
+  if ((expected < 2147483647LL) && (sum != expected)) {
+    fprintf(stderr, "Sum is %lld instead of %lld\n", sum, expected);
+    return 1;
+  }
+
+  printf("%ld messages received\n", nb_pairs * nb_msgs);
+
+  return 0;
+
+} // main
@@ -10,11 +10,11 @@ int entry(void *p)
   (void)p;
 
   while (1) {
-    printf("Coroutine#%d is running\n", crtn_self());
+    printf("Coroutine#%lld is running\n", crtn_self());
     crtn_yield(0);
   }
 
-  return crtn_self();
+  return (int)crtn_self();
 
 } // entry
 
@@ -32,19 +32,19 @@ int main(void)
   for (i = 0; i < 3; i ++) {
     snprintf(name, CRTN_NAME_SZ, "crtn_%02d", i);
     rc = crtn_spawn(&(cid[i]), name, entry, 0, 0);
-    printf("crtn_%02d, rc = %d, cid=%d\n", i, rc, cid[i]);
+    printf("crtn_%02d, rc = %d, cid=%lld\n", i, rc, cid[i]);
   }
 
   printf("Spawned the coroutines\n");
 
   for (i = 0; i < 3; i ++) {
     rc = crtn_cancel(cid[i]);
-    printf("Cancelled coroutine#%d, rc = %d\n", cid[i], rc);
+    printf("Cancelled coroutine#%lld, rc = %d\n", cid[i], rc);
   }
 
   for (i = 0; i < 3; i ++) {
     rc = crtn_join(cid[i], &status);
-    printf("Joined coroutine#%d, rc = %d, status = %d\n", cid[i], rc, status);
+    printf("Joined coroutine#%lld, rc = %d, status = %d\n", cid[i], rc, status);
   }
 
   printf("Joined the coroutines\n");
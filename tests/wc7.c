@@ -24,11 +24,13 @@
 // Evolutions  :
 //
 //     22-Mar-2021 R. Koucha      - Creation
+//     17-Oct-2026 agent          - Consumers blocked on semaphores
 //
 // -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
 
 #include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <ctype.h>
 #include <assert.h>
 #include <sys/select.h>
@@ -115,29 +117,55 @@ struct timeval to;
   } // End while
 } // nb_read
 
-static int read_buffer(void)
+// Number of characters in the buffer (posted by fill_buffer())
+static crtn_sem_t sem_data;
+
+// Only one coroutine at a time reads a token (word, spaces, newlines)
+static crtn_sem_t sem_token;
+
+static void sem_op(int (*op)(crtn_sem_t), crtn_sem_t sem)
 {
-  if (r_offset == w_offset) {
-    crtn_yield(0);
+  int rc;
+
+  rc = op(sem);
+  if (rc != 0) {
+    fprintf(stderr, "Semaphore error %d\n", crtn_errno());
+    exit(1);
   }
+} // sem_op
+
+#define begin_token() sem_op(crtn_sem_p, sem_token)
+#define end_token()   sem_op(crtn_sem_v, sem_token)
+
+static int read_buffer(void)
+{
+  // The filling coroutine may be suspended while waiting for input:
+  // wait for the data
+  sem_op(crtn_sem_p, sem_data);
 
   cnts.nb_chars ++;
   return buffer[r_offset ++];
 } // read_buffer
 
-#define unread_buffer(c) do {           \
-                  assert(r_offset > 0); \
-                  -- r_offset;          \
-                  cnts.nb_chars --;     \
+#define unread_buffer(c) do {                   \
+                  assert(r_offset > 0);         \
+                  -- r_offset;                  \
+                  cnts.nb_chars --;             \
+                  sem_op(crtn_sem_v, sem_data); \
                 } while(0)
 
+static void post_buffer(int nb)
+{
+  while (nb --) {
+    sem_op(crtn_sem_v, sem_data);
+  }
+} // post_buffer
+
 static int fill_buffer(void)
 {
   int rc;
-  unsigned long to;
   size_t size;
 
-  to = 0;
   while(1) {
 
     do {
@@ -154,8 +182,7 @@ static int fill_buffer(void)
       // There is still some space behind the write pointer, tries to fill
       // it with additional input data
       if (size) {
-        rc = nb_read(0, &(buffer[w_offset]), size, to);
-        to = 0;
+        rc = nb_read(0, &(buffer[w_offset]), size, 0);
       } else {
         // The wrtie pointer is at the end of the buffer and there
         // are still remaining data to read
@@ -169,6 +196,7 @@ static int fill_buffer(void)
         // Error
         buffer[w_offset] = EOF; // Trigger the end of the coroutines  
         w_offset ++;
+        post_buffer(1);
         crtn_yield(0);
         return -1;
       }
@@ -182,7 +210,8 @@ static int fill_buffer(void)
         } else {
 
           // Buffer empty, wait for more input data
-          to = 250;  // Polling 250 ms
+          // (the other coroutines are blocked on the semaphore meanwhile)
+          crtn_sleep(CRTN_MSEC(250));  // Polling 250 ms
         }
       }
       break;
@@ -191,6 +220,7 @@ static int fill_buffer(void)
         // EOF
         buffer[w_offset] = EOF; // Trigger the end of the coroutines  
         w_offset ++;
+        post_buffer(1);
         crtn_yield(0);
         return 0;
       }
@@ -199,6 +229,7 @@ static int fill_buffer(void)
       default: {
         // New data
         w_offset += rc;
+        post_buffer(rc);
         crtn_yield(0);
       }
       break;
@@ -216,12 +247,14 @@ static int get_spaces(void *p)
 
   do {
 
+    begin_token();
     c = read_buffer();
     while(isspace(c) && (c != '\n') && (c != EOF)) {
       cnts.nb_spaces ++;
       c = read_buffer();
     }
     unread_buffer(c);
+    end_token();
 
     if (c == EOF) {
       break;
@@ -244,13 +277,18 @@ static int get_word(void *p)
 
   do {
 
-    count = cnts.nb_chars;
+    // The other coroutines may read their tokens meanwhile
+    // ==> Count the characters of the current word only
+    begin_token();
+    count = 0;
     c = read_buffer();
     while(!isspace(c) && (c != EOF)) {
+      count ++;
       c = read_buffer();
     }
     unread_buffer(c);
-    if (cnts.nb_chars > count) {
+    end_token();
+    if (count) {
       cnts.nb_words ++;
     }
 
@@ -275,12 +313,14 @@ static int get_lines(void *p)
 
   do {
 
+    begin_token();
     c = read_buffer();
     while((c == '\n') && (c != EOF)) {
       cnts.nb_lines ++;
       c = read_buffer();
     }
     unread_buffer(c);
+    end_token();
 
     if (c == EOF) {
       break;
@@ -302,6 +342,18 @@ int main(void)
   int status;
   int exit_code;
 
+  rc = crtn_sem_new(&sem_data, 0);
+  if (rc != 0) {
+    fprintf(stderr, "Error %d\n", crtn_errno());
+    return 1;
+  }
+
+  rc = crtn_sem_new(&sem_token, 1);
+  if (rc != 0) {
+    fprintf(stderr, "Error %d\n", crtn_errno());
+    return 1;
+  }
+
   rc = crtn_spawn(&cid_word, "word", get_word, 0, 0);
   if (rc != 0) {
     errno = crtn_errno();
@@ -352,6 +404,9 @@ int main(void)
     exit_code = 1;
   }
 
+  (void)crtn_sem_delete(sem_token);
+  (void)crtn_sem_delete(sem_data);
+
   printf("Lines: %zu / Words: %zu / Spaces: %zu / Characters: %zu\n"
          ,
          cnts.nb_lines, cnts.nb_words, cnts.nb_spaces, cnts.nb_chars